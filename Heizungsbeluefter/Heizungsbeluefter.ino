@@ -8,6 +8,8 @@
  * Hardware:
  *   - ESP32-C6 Dev Module
  *   - Relay Module connected to GPIO8
+ *   - Push button on GPIO9 (BOOT button on the DevKit)
+ *   (defaults; other boards store a hardware profile, see hw_profile.h)
  * 
  * Setup Instructions:
  *   1. Select Board: "ESP32C6 Dev Module"
@@ -21,11 +23,26 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
-#include "esp_log.h"
+#define APP_LOG_MODULE_LEVEL    MAIN_LOG_LEVEL
+#include "app_log.h"
 #include "esp_check.h"
 
+#include "timer_wheel.h"
+#include "hw_profile.h"
 #include "relay.h"
+#include "relay_settings.h"
+#include "time_sync.h"
+#include "schedule.h"
+#include "scenes.h"
+#include "status_led.h"
+#include "current_sense.h"
+#include "button.h"
+#include "console.h"
+#include "soak.h"
+#include "app_event.h"
 #include "zigbee_handler.h"
+#include "event_trace.h"
+#include "perf_trace.h"
 
 /* =============================================================================
  * Private Constants
@@ -37,26 +54,49 @@ static const char *TAG = "MAIN";
  * Private Function Declarations
  * ============================================================================= */
 
-static void on_zigbee_on_off_command(bool on);
+static void on_zigbee_on_off_command(const app_event_t *event, void *ctx);
+static int console_serial_read(void);
+static void console_serial_write(const char *text, size_t len);
 
 /* =============================================================================
  * Private Function Implementations
  * ============================================================================= */
 
 /**
- * @brief Callback for Zigbee On/Off commands
+ * @brief Subscriber for Zigbee On/Off commands
  * 
  * This function is called when an On/Off command is received from the
  * Zigbee network. It controls the relay to switch the fan.
  * 
- * @param on true = turn fan ON, false = turn fan OFF
+ * @param event APP_EVENT_ZB_ON_OFF_CMD, event->relay.on is the new state
+ * @param ctx Unused
  */
-static void on_zigbee_on_off_command(bool on)
+static void on_zigbee_on_off_command(const app_event_t *event, void *ctx)
 {
-    ESP_LOGI(TAG, "Zigbee command received: %s", on ? "ON" : "OFF");
+    PERF_TRACE_SCOPE("on_zigbee_on_off_command");
+    (void)ctx;
     
-    /* Set the relay state */
-    relay_set(on);
+    bool on = event->relay.on;
+    APP_LOGI("Zigbee command received: %s", on ? "ON" : "OFF");
+    
+    /* Set the relay state; the attribute already holds it */
+    relay_set_from(on, APP_EVENT_SRC_ZIGBEE);
+}
+
+/**
+ * @brief Console input: next character from Serial, -1 if none (never waits)
+ */
+static int console_serial_read(void)
+{
+    return Serial.read();
+}
+
+/**
+ * @brief Console output to Serial
+ */
+static void console_serial_write(const char *text, size_t len)
+{
+    Serial.write((const uint8_t *)text, len);
 }
 
 /* =============================================================================
@@ -70,69 +110,143 @@ void setup()
     // Wait a bit for serial to stabilize
     delay(1000);
 
-    ESP_LOGI(TAG, "========================================");
-    ESP_LOGI(TAG, "ESP32-C6 Zigbee Fan Switch Starting...");
-    ESP_LOGI(TAG, "========================================");
+    APP_LOGI("========================================");
+    APP_LOGI("ESP32-C6 Zigbee Fan Switch Starting...");
+    APP_LOGI("========================================");
+    
+    /* Record the reset and show the history if the last run crashed */
+    event_trace_init();
+    
+    /* Start the timeline capture (no-op unless built with PERF_TRACE_ENABLE=1) */
+    perf_trace_restart();
+    
+    /* Delayed actions of all modules (relay lockout, schedule, time sync) */
+    ESP_ERROR_CHECK(timer_wheel_init());
     
     /* -------------------------------------------------------------------------
      * Step 1: Initialize NVS (Non-Volatile Storage)
      * ------------------------------------------------------------------------- */
-    ESP_LOGI(TAG, "Initializing NVS...");
+    APP_LOGI("Initializing NVS...");
     
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_LOGW(TAG, "NVS partition needs to be erased");
+        APP_LOGW("NVS partition needs to be erased");
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
     
-    ESP_LOGI(TAG, "NVS initialized successfully");
+    APP_LOGI("NVS initialized successfully");
+    
+    /* Board pins from NVS, before any driver touches a GPIO */
+    ESP_ERROR_CHECK(hw_profile_init());
+    const hw_profile_t *profile = hw_profile_get();
     
     /* -------------------------------------------------------------------------
      * Step 2: Initialize Relay GPIO
      * ------------------------------------------------------------------------- */
-    ESP_LOGI(TAG, "Initializing relay...");
+    APP_LOGI("Initializing relay...");
     
     ret = relay_init();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize relay: %s", esp_err_to_name(ret));
+        APP_LOGE("Failed to initialize relay: %s", esp_err_to_name(ret));
         return;
     }
     
-    ESP_LOGI(TAG, "Relay initialized - GPIO%d, initial state: OFF", RELAY_GPIO_PIN);
+    APP_LOGI("Relay initialized - GPIO%u, initial state: OFF", profile->output_pins[0]);
+    
+    /* Identify, network and relay state; the board works without the LED */
+    ret = status_led_init();
+    if (ret != ESP_OK) {
+        APP_LOGW("Status LED not available: %s", esp_err_to_name(ret));
+    }
+    
+    /* Short-cycle protection from NVS, before the endpoint copies it */
+    ret = relay_settings_init();
+    if (ret != ESP_OK) {
+        APP_LOGW("Relay settings not available: %s", esp_err_to_name(ret));
+    }
+    
+    /* Wall clock across resets and the weekly schedule from NVS */
+    time_sync_init();
+    ret = schedule_init();
+    if (ret != ESP_OK) {
+        APP_LOGW("Schedule not available: %s", esp_err_to_name(ret));
+    }
+    
+    /* Scene table, handed to the stack once it runs */
+    ret = scenes_init();
+    if (ret != ESP_OK) {
+        APP_LOGW("Scenes not available: %s", esp_err_to_name(ret));
+    }
+    
+    /* Optional fan current sensor, energy counter from NVS */
+    ret = current_sense_init();
+    if (ret != ESP_OK) {
+        APP_LOGW("Current measurement not available: %s", esp_err_to_name(ret));
+    }
     
     /* -------------------------------------------------------------------------
      * Step 3: Initialize Zigbee Stack
      * ------------------------------------------------------------------------- */
-    ESP_LOGI(TAG, "Initializing Zigbee...");
+    APP_LOGI("Initializing Zigbee...");
     
     ret = zigbee_handler_init();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize Zigbee: %s", esp_err_to_name(ret));
+        APP_LOGE("Failed to initialize Zigbee: %s", esp_err_to_name(ret));
         return;
     }
     
     /* -------------------------------------------------------------------------
-     * Step 4: Register Relay Control Callback
+     * Step 4: Subscribe Relay Control to Zigbee Commands
      * ------------------------------------------------------------------------- */
-    zigbee_handler_register_on_off_callback(on_zigbee_on_off_command);
-    
-    ESP_LOGI(TAG, "----------------------------------------");
-    ESP_LOGI(TAG, "Initialization complete!");
-    ESP_LOGI(TAG, "Hardware Configuration:");
-    ESP_LOGI(TAG, "  - Relay GPIO: %d", RELAY_GPIO_PIN);
-    ESP_LOGI(TAG, "  - Active Level: %s", RELAY_ACTIVE_LEVEL ? "HIGH" : "LOW");
-    ESP_LOGI(TAG, "Zigbee Configuration:");
-    ESP_LOGI(TAG, "  - Endpoint: %d", ZIGBEE_ENDPOINT);
-    ESP_LOGI(TAG, "  - Device Type: End Device");
-    ESP_LOGI(TAG, "----------------------------------------");
-    ESP_LOGI(TAG, "Starting Zigbee network steering...");
-    ESP_LOGI(TAG, "Put your Zigbee coordinator in pairing mode!");
-    ESP_LOGI(TAG, "----------------------------------------");
+    ret = app_event_subscribe(APP_EVENT_MASK(APP_EVENT_ZB_ON_OFF_CMD), on_zigbee_on_off_command, NULL);
+    if (ret != ESP_OK) {
+        APP_LOGE("Failed to subscribe relay control: %s", esp_err_to_name(ret));
+        return;
+    }
+    
+    /* -------------------------------------------------------------------------
+     * Step 5: Initialize Push Button
+     * ------------------------------------------------------------------------- */
+    ret = button_init();
+    if (ret != ESP_OK) {
+        /* The fan stays controllable over Zigbee */
+        APP_LOGE("Failed to initialize button: %s", esp_err_to_name(ret));
+    }
+    
+    APP_LOGI("----------------------------------------");
+    APP_LOGI("Initialization complete!");
+    APP_LOGI("Hardware Configuration:");
+    APP_LOGI("  - Profile: %s", hw_profile_source() == HW_PROFILE_SOURCE_NVS ? "stored" : "default");
+    for (uint8_t i = 0; i < profile->output_count; i++) {
+        APP_LOGI("  - Relay GPIO: %u, active %s", profile->output_pins[i],
+                 (profile->output_active_high & (1U << i)) ? "HIGH" : "LOW");
+    }
+    APP_LOGI("  - Button GPIO: %u", profile->button_pin);
+    APP_LOGI("  - Status LED GPIO: %u", profile->led_pin);
+    APP_LOGI("Zigbee Configuration:");
+    APP_LOGI("  - Endpoint: %d", ZIGBEE_ENDPOINT);
+    APP_LOGI("  - Device Type: End Device");
+    APP_LOGI("----------------------------------------");
+    APP_LOGI("Starting Zigbee network steering...");
+    APP_LOGI("Put your Zigbee coordinator in pairing mode!");
+    APP_LOGI("----------------------------------------");
+    
+    /* loop() never runs, the console reads Serial from its own task */
+    ret = console_init(console_serial_read, console_serial_write);
+    if (ret != ESP_OK) {
+        APP_LOGW("Console not available: %s", esp_err_to_name(ret));
+    }
+    
+    /* Random input and invariant checks (no-op unless built with SOAK_ENABLE=1) */
+    ret = soak_start();
+    if (ret != ESP_OK) {
+        APP_LOGW("Soak test not available: %s", esp_err_to_name(ret));
+    }
     
     /* -------------------------------------------------------------------------
-     * Step 5: Start Zigbee Stack
+     * Step 6: Start Zigbee Stack
      * 
      * This calls esp_zb_start() and esp_zb_stack_main_loop().
      * Since esp_zb_stack_main_loop() is blocking, setup() will NEVER return.
@@ -144,4 +258,5 @@ void setup()
 void loop()
 {
     // This code is unreachable because zigbee_handler_start() blocks.
+    // Serial input is handled by the console task (console.h).
 }
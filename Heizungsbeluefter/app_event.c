@@ -0,0 +1,90 @@
+/**
+ * @file app_event.c
+ * @brief Relay and attribute event bus implementation
+ */
+
+#include "app_event.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
+#include "metrics.h"
+#define APP_LOG_MODULE_LEVEL    EVENT_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "EVENT";
+
+typedef struct {
+    uint32_t mask;
+    app_event_handler_t handler;
+    void *ctx;
+} app_event_subscriber_t;
+
+static app_event_subscriber_t s_subscribers[APP_EVENT_MAX_SUBSCRIBERS];
+
+/** Number of valid entries, written after the entry itself */
+static volatile uint8_t s_subscriber_count = 0;
+
+static app_event_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t app_event_subscribe(uint32_t mask, app_event_handler_t handler, void *ctx)
+{
+    if (!handler || (mask & APP_EVENT_MASK_ALL) == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t count = s_subscriber_count;
+    if (count >= APP_EVENT_MAX_SUBSCRIBERS) {
+        APP_LOGE("Subscriber table full (%d)", APP_EVENT_MAX_SUBSCRIBERS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_subscribers[count].mask = mask;
+    s_subscribers[count].handler = handler;
+    s_subscribers[count].ctx = ctx;
+    s_subscriber_count = count + 1;
+
+    APP_LOGD("Subscriber %u: mask 0x%02lx", count, (unsigned long)mask);
+    return ESP_OK;
+}
+
+void app_event_publish(const app_event_t *event)
+{
+    uint32_t bit = APP_EVENT_MASK(event->type);
+    uint8_t count = s_subscriber_count;
+    uint32_t delivered = 0;
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (uint8_t i = 0; i < count; i++) {
+        if (s_subscribers[i].mask & bit) {
+            s_subscribers[i].handler(event, s_subscribers[i].ctx);
+            delivered++;
+        }
+    }
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    metrics_record(METRIC_EVENT_DISPATCH_CYCLES, cycles);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.published++;
+    s_stats.delivered += delivered;
+    s_stats.last_cycles = cycles;
+    if (cycles > s_stats.max_cycles) {
+        s_stats.max_cycles = cycles;
+    }
+    s_stats.total_cycles += cycles;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+void app_event_get_stats(app_event_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
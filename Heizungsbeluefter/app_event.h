@@ -0,0 +1,152 @@
+/**
+ * @file app_event.h
+ * @brief Relay and attribute event bus for ESP32-C6 Zigbee Fan Switch
+ *
+ * A small publish/subscribe bus that decouples the relay from its consumers
+ * (Zigbee reporting, persistence, metrics, local UI). Subscribers live in a
+ * fixed table filled during setup(); publishing allocates nothing and calls
+ * the matching handlers synchronously, in the publisher's task.
+ *
+ * Rules for handlers:
+ *   - Keep them short and never block for long: they run on the publisher's
+ *     stack, possibly in the Zigbee task.
+ *   - They may publish further events (e.g. call relay_set()); nesting is
+ *     bounded by the handlers themselves.
+ *   - Publishing from ISRs is not supported; defer to a task first.
+ *
+ * Dispatch cost is measured on every publish, see app_event_get_stats().
+ */
+
+#ifndef APP_EVENT_H
+#define APP_EVENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Maximum number of subscribers */
+#define APP_EVENT_MAX_SUBSCRIBERS   16
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Event types
+ */
+typedef enum {
+    APP_EVENT_RELAY_CHANGED = 0,    /**< Relay output switched, see relay */
+    APP_EVENT_ZB_ON_OFF_CMD,        /**< On/Off attribute changed by the network, see relay */
+    APP_EVENT_ZB_ATTR_WRITTEN,      /**< Any attribute changed by the network, see zcl */
+    APP_EVENT_RELAY_DESIRED,        /**< Desired state changed without switching (transition
+                                         deferred or cancelled), see relay; timestamp_us is 0 */
+    APP_EVENT_ZB_JOINED,            /**< Device is (again) part of a network, no payload */
+    APP_EVENT_TIME_CHANGED,         /**< Wall clock set or corrected, see time */
+    APP_EVENT_ZB_LEFT,              /**< Device removed from the network, no payload */
+    APP_EVENT_TYPE_COUNT,
+} app_event_type_t;
+
+/** @brief Subscription mask bit of an event type */
+#define APP_EVENT_MASK(type)        (1UL << (type))
+
+/** @brief Subscription mask for all event types */
+#define APP_EVENT_MASK_ALL          ((1UL << APP_EVENT_TYPE_COUNT) - 1)
+
+/**
+ * @brief Origin of a change
+ */
+typedef enum {
+    APP_EVENT_SRC_LOCAL = 0,        /**< Firmware-internal (relay_set(), relay_toggle()) */
+    APP_EVENT_SRC_ZIGBEE,           /**< Zigbee network command */
+    APP_EVENT_SRC_SCHEDULE,         /**< On-device weekly schedule */
+    APP_EVENT_SRC_CONSOLE,          /**< Serial console command */
+} app_event_source_t;
+
+/**
+ * @brief Event payload (passed by pointer, valid only during the handler call)
+ */
+typedef struct {
+    uint8_t type;                   /**< app_event_type_t */
+    uint8_t source;                 /**< app_event_source_t */
+    union {
+        struct {
+            bool on;                /**< New relay / attribute state */
+            uint32_t timestamp_us;  /**< Low 32 bits of esp_timer_get_time() at the GPIO write */
+        } relay;
+        struct {
+            uint16_t cluster;       /**< Cluster ID */
+            uint16_t attr_id;       /**< Attribute ID */
+            uint8_t attr_type;      /**< esp_zb_zcl_attr_type_t */
+            const void *value;      /**< New value (owned by the stack, validated, read with zcl_codec.h) */
+        } zcl;
+        struct {
+            uint8_t status;         /**< time_sync_status_t */
+            int32_t step_s;         /**< Correction applied to the clock */
+        } time;
+    };
+} app_event_t;
+
+/**
+ * @brief Event handler
+ *
+ * @param event Published event
+ * @param ctx Context pointer given to app_event_subscribe()
+ */
+typedef void (*app_event_handler_t)(const app_event_t *event, void *ctx);
+
+/**
+ * @brief Dispatch statistics
+ */
+typedef struct {
+    uint32_t published;             /**< Events published */
+    uint32_t delivered;             /**< Handler invocations */
+    uint32_t last_cycles;           /**< CPU cycles of the last dispatch */
+    uint32_t max_cycles;            /**< Slowest dispatch so far */
+    uint64_t total_cycles;          /**< Sum over all dispatches */
+} app_event_stats_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Subscribe a handler to a set of event types
+ *
+ * Call during setup(), before events are published.
+ *
+ * @param mask APP_EVENT_MASK() bits of the wanted types
+ * @param handler Handler function
+ * @param ctx Passed back to the handler
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_NO_MEM if the table is full
+ */
+esp_err_t app_event_subscribe(uint32_t mask, app_event_handler_t handler, void *ctx);
+
+/**
+ * @brief Deliver an event to all matching subscribers
+ *
+ * Handlers are called in subscription order.
+ *
+ * @param event Event to publish
+ */
+void app_event_publish(const app_event_t *event);
+
+/**
+ * @brief Get a copy of the dispatch statistics
+ *
+ * @param[out] stats Destination
+ */
+void app_event_get_stats(app_event_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_EVENT_H */
@@ -0,0 +1,184 @@
+/**
+ * @file app_log.h
+ * @brief Per-module compile-time logging facade for ESP32-C6 Zigbee Fan Switch
+ *
+ * ESP_LOGx calls that are filtered at runtime still keep their format strings
+ * in flash and still evaluate their arguments. The APP_LOGx macros instead
+ * compare against a per-module threshold in the preprocessor: log statements
+ * below the threshold expand to nothing, so neither the string literals nor
+ * the argument expressions end up in the binary.
+ *
+ * Usage (in a .c/.ino file only, never in a header):
+ *
+ *   #define APP_LOG_MODULE_LEVEL    RELAY_LOG_LEVEL
+ *   #include "app_log.h"
+ *
+ *   static const char *TAG = "RELAY";
+ *   ...
+ *   APP_LOGI("Relay set to %s", on ? "ON" : "OFF");
+ *
+ * Thresholds are overridden at build time, e.g. in build_opt.h:
+ *   -DAPP_LOG_LEVEL_DEFAULT=APP_LOG_WARN -DZIGBEE_LOG_LEVEL=APP_LOG_DEBUG
+ *
+ * Messages that pass the build-time threshold still go through ESP_LOGx, so
+ * the runtime log level (and the Arduino "Core Debug Level") apply on top.
+ */
+
+#ifndef APP_LOG_H
+#define APP_LOG_H
+
+#include "esp_log.h"
+
+/* =============================================================================
+ * Levels
+ * ============================================================================= */
+
+#define APP_LOG_NONE        0
+#define APP_LOG_ERROR       1
+#define APP_LOG_WARN        2
+#define APP_LOG_INFO        3
+#define APP_LOG_DEBUG       4
+#define APP_LOG_VERBOSE     5
+
+/** @brief Threshold for modules without an explicit setting */
+#ifndef APP_LOG_LEVEL_DEFAULT
+#define APP_LOG_LEVEL_DEFAULT   APP_LOG_INFO
+#endif
+
+/* =============================================================================
+ * Per-module Thresholds
+ * ============================================================================= */
+
+#ifndef MAIN_LOG_LEVEL
+#define MAIN_LOG_LEVEL          APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef RELAY_LOG_LEVEL
+#define RELAY_LOG_LEVEL         APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef ZIGBEE_LOG_LEVEL
+#define ZIGBEE_LOG_LEVEL        APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef ZB_EP_LOG_LEVEL
+#define ZB_EP_LOG_LEVEL         APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef TELEMETRY_LOG_LEVEL
+#define TELEMETRY_LOG_LEVEL     APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef DIAG_LOG_LEVEL
+#define DIAG_LOG_LEVEL          APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef TRACE_LOG_LEVEL
+#define TRACE_LOG_LEVEL         APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef PERF_TRACE_LOG_LEVEL
+#define PERF_TRACE_LOG_LEVEL    APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef EVENT_LOG_LEVEL
+#define EVENT_LOG_LEVEL         APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef BUTTON_LOG_LEVEL
+#define BUTTON_LOG_LEVEL        APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef TIME_LOG_LEVEL
+#define TIME_LOG_LEVEL          APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef TIMER_LOG_LEVEL
+#define TIMER_LOG_LEVEL         APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef SCHEDULE_LOG_LEVEL
+#define SCHEDULE_LOG_LEVEL      APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef CURRENT_LOG_LEVEL
+#define CURRENT_LOG_LEVEL       APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef SCENES_LOG_LEVEL
+#define SCENES_LOG_LEVEL        APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef STATUS_LED_LOG_LEVEL
+#define STATUS_LED_LOG_LEVEL    APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef HW_PROFILE_LOG_LEVEL
+#define HW_PROFILE_LOG_LEVEL    APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef CONSOLE_LOG_LEVEL
+#define CONSOLE_LOG_LEVEL       APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef NETWORK_LOG_LEVEL
+#define NETWORK_LOG_LEVEL       APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef CAPTURE_LOG_LEVEL
+#define CAPTURE_LOG_LEVEL       APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef SOAK_LOG_LEVEL
+#define SOAK_LOG_LEVEL          APP_LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef METRICS_LOG_LEVEL
+#define METRICS_LOG_LEVEL       APP_LOG_LEVEL_DEFAULT
+#endif
+
+/* =============================================================================
+ * Logging Macros
+ * ============================================================================= */
+
+#ifndef APP_LOG_MODULE_LEVEL
+#error "Define APP_LOG_MODULE_LEVEL before including app_log.h"
+#endif
+
+/* Disabled levels still reference TAG so that it does not trigger unused warnings */
+#define APP_LOG_DISABLED_()     ((void)TAG)
+
+#if APP_LOG_MODULE_LEVEL >= APP_LOG_ERROR
+#define APP_LOGE(format, ...)   ESP_LOGE(TAG, format, ##__VA_ARGS__)
+#else
+#define APP_LOGE(format, ...)   APP_LOG_DISABLED_()
+#endif
+
+#if APP_LOG_MODULE_LEVEL >= APP_LOG_WARN
+#define APP_LOGW(format, ...)   ESP_LOGW(TAG, format, ##__VA_ARGS__)
+#else
+#define APP_LOGW(format, ...)   APP_LOG_DISABLED_()
+#endif
+
+#if APP_LOG_MODULE_LEVEL >= APP_LOG_INFO
+#define APP_LOGI(format, ...)   ESP_LOGI(TAG, format, ##__VA_ARGS__)
+#else
+#define APP_LOGI(format, ...)   APP_LOG_DISABLED_()
+#endif
+
+#if APP_LOG_MODULE_LEVEL >= APP_LOG_DEBUG
+#define APP_LOGD(format, ...)   ESP_LOGD(TAG, format, ##__VA_ARGS__)
+#else
+#define APP_LOGD(format, ...)   APP_LOG_DISABLED_()
+#endif
+
+#if APP_LOG_MODULE_LEVEL >= APP_LOG_VERBOSE
+#define APP_LOGV(format, ...)   ESP_LOGV(TAG, format, ##__VA_ARGS__)
+#else
+#define APP_LOGV(format, ...)   APP_LOG_DISABLED_()
+#endif
+
+/** @brief true if the module compiles the given level in (for guarding extra work) */
+#define APP_LOG_ENABLED(level)  (APP_LOG_MODULE_LEVEL >= (level))
+
+#endif /* APP_LOG_H */
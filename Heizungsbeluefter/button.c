@@ -0,0 +1,303 @@
+/**
+ * @file button.c
+ * @brief Push-button input implementation
+ *
+ * The GPIO and timer ISRs only sample the pin and hand the press duration to
+ * the button task; relay, Zigbee and logging calls all happen in the task.
+ */
+
+#include "button.h"
+#include "relay.h"
+#include "app_event.h"
+#include "network.h"
+#include "event_trace.h"
+#include "perf_trace.h"
+#include "hw_profile.h"
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#define APP_LOG_MODULE_LEVEL    BUTTON_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "BUTTON";
+
+/** Above the Zigbee task, so a press is handled even while the stack is busy */
+#define BUTTON_TASK_PRIORITY    10
+#define BUTTON_TASK_STACK       3072
+
+/** Debounce timer resolution (1 tick = 1 us) */
+#define BUTTON_TIMER_HZ         1000000
+
+static gptimer_handle_t s_timer = NULL;
+static TaskHandle_t s_task = NULL;
+
+/** Pin and active level from the hardware profile, fixed in button_init() */
+static gpio_num_t s_pin = (gpio_num_t)BUTTON_GPIO_PIN;
+static int s_active_level = BUTTON_ACTIVE_LEVEL;
+
+/* Owned by the timer ISR */
+static bool s_pressed = false;
+static int64_t s_press_us = 0;
+
+/** Time of the last debounced release, read by the task */
+static volatile uint32_t s_release_us = 0;
+
+/** Set by the task before a toggle, consumed by the relay event handler */
+static bool s_latency_pending = false;
+
+static button_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void button_gpio_isr(void *arg);
+static bool button_timer_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata,
+                             void *ctx);
+static void button_start_debounce(void);
+static button_action_t button_classify(uint32_t held_ms);
+static void button_on_relay_changed(const app_event_t *event, void *ctx);
+static void button_task(void *arg);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/** Mask the pin and let the timer sample it once it has settled */
+static void IRAM_ATTR button_start_debounce(void)
+{
+    gpio_intr_disable(s_pin);
+    gptimer_set_raw_count(s_timer, 0);
+    gptimer_start(s_timer);
+}
+
+static void IRAM_ATTR button_gpio_isr(void *arg)
+{
+    (void)arg;
+    button_start_debounce();
+}
+
+/**
+ * @brief Debounce timer expired: sample the pin and report releases
+ */
+static bool IRAM_ATTR button_timer_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata,
+                                       void *ctx)
+{
+    (void)edata;
+    (void)ctx;
+    BaseType_t woken = pdFALSE;
+
+    gptimer_stop(timer);
+
+    bool pressed = gpio_get_level(s_pin) == s_active_level;
+    if (pressed != s_pressed) {
+        int64_t now = esp_timer_get_time();
+        s_pressed = pressed;
+        if (pressed) {
+            s_press_us = now;
+        } else {
+            s_release_us = (uint32_t)now;
+            uint32_t held_ms = (uint32_t)((now - s_press_us) / 1000);
+            xTaskNotifyFromISR(s_task, held_ms, eSetValueWithOverwrite, &woken);
+        }
+    }
+
+    gpio_intr_enable(s_pin);
+
+    /* An edge while the interrupt was masked would otherwise be lost */
+    if ((gpio_get_level(s_pin) == s_active_level) != s_pressed) {
+        button_start_debounce();
+    }
+
+    return woken == pdTRUE;
+}
+
+static button_action_t button_classify(uint32_t held_ms)
+{
+    if (held_ms >= BUTTON_VERY_LONG_MS) {
+        return BUTTON_ACTION_FACTORY_RESET;
+    }
+    if (held_ms >= BUTTON_LONG_MS) {
+        return BUTTON_ACTION_STEERING;
+    }
+    if (held_ms <= BUTTON_SHORT_MAX_MS) {
+        return BUTTON_ACTION_TOGGLE;
+    }
+    return BUTTON_ACTION_NONE;
+}
+
+/**
+ * @brief Measure the toggle latency at the relay GPIO write
+ *
+ * Runs synchronously inside relay_toggle(), in the button task.
+ */
+static void button_on_relay_changed(const app_event_t *event, void *ctx)
+{
+    (void)ctx;
+
+    if (!s_latency_pending) {
+        return;
+    }
+    s_latency_pending = false;
+
+    uint32_t latency_us = event->relay.timestamp_us - s_release_us;
+    metrics_record(METRIC_BUTTON_LATENCY_US, latency_us);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.last_latency_us = latency_us;
+    if (latency_us > s_stats.max_latency_us) {
+        s_stats.max_latency_us = latency_us;
+    }
+    if (latency_us > BUTTON_LATENCY_TARGET_US) {
+        s_stats.slow_toggles++;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void button_task(void *arg)
+{
+    (void)arg;
+    uint32_t held_ms;
+
+    for (;;) {
+        xTaskNotifyWait(0, 0, &held_ms, portMAX_DELAY);
+
+        button_action_t action = button_classify(held_ms);
+        event_trace_log(EVT_BUTTON, action, held_ms / 10 > 0xFFFF ? 0xFFFF : held_ms / 10);
+
+        switch (action) {
+            case BUTTON_ACTION_TOGGLE: {
+                PERF_TRACE_SCOPE("button_toggle");
+                s_latency_pending = true;
+                relay_toggle();
+                s_latency_pending = false;
+
+                portENTER_CRITICAL(&s_stats_lock);
+                s_stats.short_presses++;
+                uint32_t latency_us = s_stats.last_latency_us;
+                portEXIT_CRITICAL(&s_stats_lock);
+
+                if (latency_us > BUTTON_LATENCY_TARGET_US) {
+                    APP_LOGW("Toggle took %lu us (target %d us)",
+                             (unsigned long)latency_us, BUTTON_LATENCY_TARGET_US);
+                } else {
+                    APP_LOGD("Toggle latency %lu us", (unsigned long)latency_us);
+                }
+                break;
+            }
+
+            case BUTTON_ACTION_STEERING:
+                APP_LOGI("Long press (%lu ms): network steering", (unsigned long)held_ms);
+                portENTER_CRITICAL(&s_stats_lock);
+                s_stats.long_presses++;
+                portEXIT_CRITICAL(&s_stats_lock);
+                network_start_steering();
+                break;
+
+            case BUTTON_ACTION_FACTORY_RESET:
+                APP_LOGW("Very long press (%lu ms): factory reset", (unsigned long)held_ms);
+                portENTER_CRITICAL(&s_stats_lock);
+                s_stats.very_long_presses++;
+                portEXIT_CRITICAL(&s_stats_lock);
+                network_factory_reset();
+                break;
+
+            default:
+                APP_LOGI("Press of %lu ms ignored", (unsigned long)held_ms);
+                portENTER_CRITICAL(&s_stats_lock);
+                s_stats.ignored_presses++;
+                portEXIT_CRITICAL(&s_stats_lock);
+                break;
+        }
+    }
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t button_init(void)
+{
+    const hw_profile_t *profile = hw_profile_get();
+
+    if (profile->button_pin == HW_PROFILE_PIN_NONE) {
+        APP_LOGI("No button in the hardware profile");
+        return ESP_OK;
+    }
+    s_pin = (gpio_num_t)profile->button_pin;
+    s_active_level = profile->button_active_level;
+
+    APP_LOGI("Initializing button on GPIO%d", s_pin);
+
+    ESP_RETURN_ON_ERROR(app_event_subscribe(APP_EVENT_MASK(APP_EVENT_RELAY_CHANGED),
+                                            button_on_relay_changed, NULL),
+                        TAG, "Failed to subscribe to relay events");
+
+    /* One-shot debounce timer */
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = BUTTON_TIMER_HZ,
+    };
+    ESP_RETURN_ON_ERROR(gptimer_new_timer(&timer_config, &s_timer), TAG, "Failed to create timer");
+
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = button_timer_isr,
+    };
+    ESP_RETURN_ON_ERROR(gptimer_register_event_callbacks(s_timer, &callbacks, NULL),
+                        TAG, "Failed to register timer callback");
+
+    gptimer_alarm_config_t alarm_config = {
+        .alarm_count = (uint64_t)BUTTON_DEBOUNCE_MS * (BUTTON_TIMER_HZ / 1000),
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = false,
+    };
+    ESP_RETURN_ON_ERROR(gptimer_set_alarm_action(s_timer, &alarm_config), TAG, "Failed to set alarm");
+    ESP_RETURN_ON_ERROR(gptimer_enable(s_timer), TAG, "Failed to enable timer");
+
+    BaseType_t created = xTaskCreate(button_task, "button", BUTTON_TASK_STACK, NULL,
+                                     BUTTON_TASK_PRIORITY, &s_task);
+    ESP_RETURN_ON_FALSE(created == pdPASS, ESP_ERR_NO_MEM, TAG, "Failed to create task");
+
+    /* Input with pull towards the released level, interrupt on both edges */
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << s_pin),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = s_active_level ? GPIO_PULLUP_DISABLE : GPIO_PULLUP_ENABLE,
+        .pull_down_en = s_active_level ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    ESP_RETURN_ON_ERROR(gpio_config(&io_conf), TAG, "Failed to configure GPIO%d", s_pin);
+
+    /* A button held during boot does not count as a press */
+    s_pressed = gpio_get_level(s_pin) == s_active_level;
+
+    /* The ISR service may already be installed by the Arduino core */
+    esp_err_t ret = gpio_install_isr_service(0);
+    ESP_RETURN_ON_FALSE(ret == ESP_OK || ret == ESP_ERR_INVALID_STATE, ret, TAG,
+                        "Failed to install GPIO ISR service");
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(s_pin, button_gpio_isr, NULL),
+                        TAG, "Failed to add GPIO ISR");
+
+    APP_LOGI("Button ready: short < %d ms toggle, >= %d ms steering, >= %d ms factory reset",
+             BUTTON_SHORT_MAX_MS, BUTTON_LONG_MS, BUTTON_VERY_LONG_MS);
+
+    return ESP_OK;
+}
+
+void button_get_stats(button_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
@@ -0,0 +1,110 @@
+/**
+ * @file button.h
+ * @brief Push-button input for ESP32-C6 Zigbee Fan Switch
+ *
+ * A push button at the heater overrides the fan locally:
+ *   - Short press (< 1 s):        toggle the relay
+ *   - Long press (3 s .. 10 s):   start network steering
+ *   - Very long press (>= 10 s):  factory reset (leave network, erase zb_storage)
+ * Presses between 1 s and 3 s are ignored. Actions run on release.
+ *
+ * Debouncing is interrupt driven: the first edge disables the GPIO interrupt
+ * and arms a one-shot hardware timer (GPTimer). When the timer fires, the
+ * level is sampled and the interrupt re-enabled, so there is no polling.
+ * Actions run in a dedicated high-priority task.
+ *
+ * Hardware Configuration:
+ *   - GPIO9 (BOOT button on the ESP32-C6 DevKit), active low with pull-up
+ *   - GPIO9 is a strapping pin: holding it during reset enters download mode
+ *
+ * The latency from the debounced release to the relay GPIO write is measured
+ * for every short press, see button_get_stats().
+ */
+
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Default GPIO pin of the button (used without a stored hardware profile) */
+#define BUTTON_GPIO_PIN             9
+
+/** @brief Default level while pressed (0 = active low, internal pull-up enabled) */
+#define BUTTON_ACTIVE_LEVEL         0
+
+/** @brief Debounce time after an edge */
+#define BUTTON_DEBOUNCE_MS          20
+
+/** @brief Longest press counted as short press */
+#define BUTTON_SHORT_MAX_MS         1000
+
+/** @brief Shortest long press (network steering) */
+#define BUTTON_LONG_MS              3000
+
+/** @brief Shortest very long press (factory reset) */
+#define BUTTON_VERY_LONG_MS         10000
+
+/** @brief Latency target from debounced release to relay switch */
+#define BUTTON_LATENCY_TARGET_US    1000
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Button actions (also stored in the event trace)
+ */
+typedef enum {
+    BUTTON_ACTION_NONE = 0,
+    BUTTON_ACTION_TOGGLE,
+    BUTTON_ACTION_STEERING,
+    BUTTON_ACTION_FACTORY_RESET,
+} button_action_t;
+
+/**
+ * @brief Press counters and toggle latency
+ */
+typedef struct {
+    uint32_t short_presses;
+    uint32_t long_presses;
+    uint32_t very_long_presses;
+    uint32_t ignored_presses;       /**< Between short and long */
+    uint32_t last_latency_us;       /**< Debounced release to relay GPIO write */
+    uint32_t max_latency_us;
+    uint32_t slow_toggles;          /**< Toggles above BUTTON_LATENCY_TARGET_US */
+} button_stats_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Configure the button GPIO, debounce timer and action task
+ *
+ * Call after relay_init() and zigbee_handler_init().
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t button_init(void);
+
+/**
+ * @brief Get a copy of the button statistics
+ *
+ * @param[out] stats Destination
+ */
+void button_get_stats(button_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BUTTON_H */
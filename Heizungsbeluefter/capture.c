@@ -0,0 +1,216 @@
+/**
+ * @file capture.c
+ * @brief Zigbee frame capture implementation
+ *
+ * The hooks write a slot inside a short critical section; the dump copies
+ * one slot at a time the same way and formats it outside, so the Zigbee
+ * task never waits for the log.
+ */
+
+#include "capture.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include <stddef.h>
+#include <string.h>
+#define APP_LOG_MODULE_LEVEL    CAPTURE_LOG_LEVEL
+#include "app_log.h"
+
+static const char *TAG = "CAPTURE";
+
+#if CAPTURE_ENABLE
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+/** Confirm hook: the confirm has no profile, cluster and link quality */
+#define CAPTURE_UNKNOWN_ID      0xFFFF
+
+/**
+ * @brief One captured frame
+ */
+typedef struct {
+    uint64_t timestamp_us;      /* esp_timer_get_time(), does not wrap */
+    uint16_t src_addr;
+    uint16_t dst_addr;          /* Short or group address, see dst_addr_mode */
+    uint16_t profile_id;
+    uint16_t cluster_id;
+    uint16_t length;            /* Payload length before cutting */
+    uint8_t direction;          /* capture_dir_t */
+    uint8_t status;             /* Confirm status, 0 for received frames */
+    uint8_t dst_addr_mode;      /* esp_zb_aps_address_mode_t */
+    uint8_t src_endpoint;
+    uint8_t dst_endpoint;
+    uint8_t lqi;
+    int8_t rssi;
+    uint8_t data[CAPTURE_DATA_MAX];
+} capture_frame_t;
+
+static const char s_digits[] = "0123456789abcdef";
+
+static capture_frame_t s_frames[CAPTURE_FRAMES];
+static uint8_t s_head = 0;              /* Next slot to write */
+static capture_stats_t s_stats;
+static portMUX_TYPE s_capture_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void capture_record(capture_frame_t *frame, const uint8_t *data, esp_cpu_cycle_count_t start);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/** Store a frame whose header fields are set, count the cost from @p start */
+static void capture_record(capture_frame_t *frame, const uint8_t *data, esp_cpu_cycle_count_t start)
+{
+    size_t cut = frame->length > CAPTURE_DATA_MAX ? CAPTURE_DATA_MAX : frame->length;
+
+    portENTER_CRITICAL(&s_capture_lock);
+    capture_frame_t *slot = &s_frames[s_head];
+    memcpy(slot, frame, offsetof(capture_frame_t, data));
+    /* Timestamp inside the lock, so the ring is in time order */
+    slot->timestamp_us = (uint64_t)esp_timer_get_time();
+    if (data && cut > 0) {
+        memcpy(slot->data, data, cut);
+    } else {
+        slot->length = 0;
+    }
+    s_head = (uint8_t)((s_head + 1) % CAPTURE_FRAMES);
+    if (s_stats.frames >= CAPTURE_FRAMES) {
+        s_stats.overwritten++;
+    }
+    s_stats.frames++;
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    s_stats.record_cycles += cycles;
+    if (cycles > s_stats.record_cycles_max) {
+        s_stats.record_cycles_max = cycles;
+    }
+    portEXIT_CRITICAL(&s_capture_lock);
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+void capture_on_aps_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    capture_frame_t frame = {
+        .src_addr = ind->src_short_addr,
+        .dst_addr = ind->dst_short_addr,
+        .profile_id = ind->profile_id,
+        .cluster_id = ind->cluster_id,
+        .length = ind->asdu_length > UINT16_MAX ? UINT16_MAX : (uint16_t)ind->asdu_length,
+        .direction = CAPTURE_DIR_RX,
+        .status = ind->status,
+        .dst_addr_mode = ind->dst_addr_mode,
+        .src_endpoint = ind->src_endpoint,
+        .dst_endpoint = ind->dst_endpoint,
+        .lqi = ind->lqi,
+        .rssi = ind->rssi,
+    };
+
+    capture_record(&frame, ind->asdu, start);
+}
+
+void capture_on_aps_confirm(const esp_zb_apsde_data_confirm_t *confirm)
+{
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    capture_frame_t frame = {
+        .src_addr = esp_zb_get_short_address(),
+        .dst_addr = confirm->dst_addr.addr_short,
+        .profile_id = CAPTURE_UNKNOWN_ID,
+        .cluster_id = CAPTURE_UNKNOWN_ID,
+        .length = confirm->asdu_length > UINT16_MAX ? UINT16_MAX : (uint16_t)confirm->asdu_length,
+        .direction = CAPTURE_DIR_TX,
+        .status = confirm->status,
+        .dst_addr_mode = confirm->dst_addr_mode,
+        .src_endpoint = confirm->src_endpoint,
+        .dst_endpoint = confirm->dst_endpoint,
+    };
+
+    capture_record(&frame, confirm->asdu, start);
+}
+
+void capture_dump(void)
+{
+    capture_frame_t frame;
+    char hex[2 * CAPTURE_DATA_MAX + 1];
+
+    portENTER_CRITICAL(&s_capture_lock);
+    uint32_t count = s_stats.frames < CAPTURE_FRAMES ? s_stats.frames : CAPTURE_FRAMES;
+    uint8_t first = (uint8_t)((s_head + CAPTURE_FRAMES - count) % CAPTURE_FRAMES);
+    portEXIT_CRITICAL(&s_capture_lock);
+
+    /* Lines are always printed, whatever the log threshold (like "PT") */
+    ESP_LOGI(TAG, "---- capture: %lu frames ----", (unsigned long)count);
+    for (uint32_t i = 0; i < count; i++) {
+        portENTER_CRITICAL(&s_capture_lock);
+        frame = s_frames[(first + i) % CAPTURE_FRAMES];
+        portEXIT_CRITICAL(&s_capture_lock);
+
+        size_t cut = frame.length > CAPTURE_DATA_MAX ? CAPTURE_DATA_MAX : frame.length;
+        for (size_t b = 0; b < cut; b++) {
+            hex[2 * b] = s_digits[frame.data[b] >> 4];
+            hex[2 * b + 1] = s_digits[frame.data[b] & 0x0F];
+        }
+        hex[2 * cut] = '\0';
+
+        ESP_LOGI(TAG, "CAP %llu %c %02x %u %04x %04x %u %u %04x %04x %u %d %u %s",
+                 (unsigned long long)frame.timestamp_us, frame.direction, frame.status,
+                 frame.dst_addr_mode, frame.src_addr, frame.dst_addr, frame.src_endpoint,
+                 frame.dst_endpoint, frame.profile_id, frame.cluster_id, frame.lqi, frame.rssi,
+                 frame.length, cut > 0 ? hex : "-");
+    }
+    ESP_LOGI(TAG, "---- end of capture ----");
+}
+
+void capture_clear(void)
+{
+    portENTER_CRITICAL(&s_capture_lock);
+    s_head = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    portEXIT_CRITICAL(&s_capture_lock);
+
+    APP_LOGI("Capture cleared");
+}
+
+void capture_get_stats(capture_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_capture_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_capture_lock);
+}
+
+#else /* !CAPTURE_ENABLE */
+
+void capture_on_aps_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    (void)ind;
+}
+
+void capture_on_aps_confirm(const esp_zb_apsde_data_confirm_t *confirm)
+{
+    (void)confirm;
+}
+
+void capture_dump(void)
+{
+    ESP_LOGW(TAG, "Not compiled in (build with CAPTURE_ENABLE=1)");
+}
+
+void capture_clear(void)
+{
+}
+
+void capture_get_stats(capture_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+#endif /* CAPTURE_ENABLE */
@@ -0,0 +1,104 @@
+/**
+ * @file capture.h
+ * @brief Zigbee frame capture for ESP32-C6 Zigbee Fan Switch
+ *
+ * The stack passes the application APS frames, not radio frames: received
+ * frames through the data indication hook, sent frames through the data
+ * confirm hook. The confirm hook only sees frames the application sends
+ * itself with esp_zb_aps_data_request(); reports and responses the stack
+ * sends are not captured. Both are copied into a ring of CAPTURE_FRAMES slots (oldest
+ * overwritten, payload cut at CAPTURE_DATA_MAX bytes) together with the
+ * addresses, endpoints, profile, cluster, LQI/RSSI and the confirm status.
+ *
+ * capture_dump() (console "capture") prints the ring as "CAP" lines, with
+ * 64-bit timestamps in us since boot.
+ * tools/capture_to_pcap.py turns a saved log into a pcap file for
+ * Wireshark (IEEE 802.15.4 without FCS). It builds the MAC, NWK and APS
+ * headers from the recorded fields, around the unencrypted APS payload.
+ *
+ * Recording takes the Zigbee task a copy and a critical section per frame.
+ * The cost is measured per call (capture_get_stats(), console "bench"), so
+ * the capture can stay on during soak runs.
+ *
+ * Disabled by default. Build with CAPTURE_ENABLE=1 to compile it in.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Compile the frame capture in (1) or out (0) */
+#ifndef CAPTURE_ENABLE
+#define CAPTURE_ENABLE          0
+#endif
+
+/** @brief Frames kept, the oldest is overwritten */
+#define CAPTURE_FRAMES          32
+
+/** @brief Payload bytes kept per frame, longer payloads are cut */
+#define CAPTURE_DATA_MAX        64
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/** @brief Direction of a captured frame */
+typedef enum {
+    CAPTURE_DIR_RX = 'R',
+    CAPTURE_DIR_TX = 'T',
+} capture_dir_t;
+
+/**
+ * @brief Capture counters and recording cost
+ */
+typedef struct {
+    uint32_t frames;            /**< Frames recorded since the last clear */
+    uint32_t overwritten;       /**< Frames lost to the ring wrapping */
+    uint32_t record_cycles_max; /**< Most CPU cycles of one record call */
+    uint64_t record_cycles;     /**< CPU cycles of all record calls */
+} capture_stats_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Record a received frame (APS data indication hook, Zigbee task)
+ */
+void capture_on_aps_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/**
+ * @brief Record a sent frame (APS data confirm hook, Zigbee task)
+ */
+void capture_on_aps_confirm(const esp_zb_apsde_data_confirm_t *confirm);
+
+/**
+ * @brief Print the ring to the log, oldest frame first ("CAP" lines)
+ */
+void capture_dump(void);
+
+/**
+ * @brief Empty the ring and reset the counters
+ */
+void capture_clear(void);
+
+/**
+ * @brief Copy the counters
+ */
+void capture_get_stats(capture_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAPTURE_H */
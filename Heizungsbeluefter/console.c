@@ -0,0 +1,637 @@
+/**
+ * @file console.c
+ * @brief Serial command console implementation
+ *
+ * Everything runs in the console task: input is collected in a static line
+ * buffer, split in place into words and looked up in a constant command
+ * table. Output is formatted into a static buffer and handed to the write
+ * function of the sketch.
+ */
+
+#include "console.h"
+
+#if CONSOLE_ENABLE
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "relay.h"
+#include "button.h"
+#include "app_event.h"
+#include "timer_wheel.h"
+#include "zigbee_handler.h"
+#include "network.h"
+#include "zb_endpoint.h"
+#include "diagnostics.h"
+#include "event_trace.h"
+#include "capture.h"
+#include "metrics.h"
+#include "hw_profile.h"
+#include "current_sense.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#define APP_LOG_MODULE_LEVEL    CONSOLE_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "CONSOLE";
+
+/** Below the Zigbee task, a running command never delays the stack */
+#define CONSOLE_TASK_PRIORITY   1
+#define CONSOLE_TASK_STACK      4096
+
+/** Longest formatted output line */
+#define CONSOLE_OUT_MAX         160
+
+/** Most events printed by "trace" */
+#define CONSOLE_TRACE_MAX       32
+
+/** A command: words after the name are passed in argv[1..argc-1] */
+typedef struct {
+    const char *name;
+    const char *usage;
+    void (*run)(int argc, char **argv);
+} console_cmd_t;
+
+static console_read_t s_read;
+static console_write_t s_write;
+static TaskHandle_t s_task;
+
+/* Console task only */
+static char s_line[CONSOLE_LINE_MAX + 1];
+static uint8_t s_len = 0;
+static bool s_overflow = false;
+static char s_out[CONSOLE_OUT_MAX];
+static event_trace_entry_t s_trace[CONSOLE_TRACE_MAX];
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void console_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static int console_split(char *line, char **argv);
+static const console_cmd_t *console_find(const char *name);
+static void console_execute(char *line);
+static int console_hex_digit(char c);
+static void console_task(void *arg);
+
+static void console_cmd_help(int argc, char **argv);
+static void console_cmd_stats(int argc, char **argv);
+static void console_cmd_net(int argc, char **argv);
+static void console_cmd_trace(int argc, char **argv);
+static void console_cmd_capture(int argc, char **argv);
+static void console_cmd_metrics(int argc, char **argv);
+static void console_cmd_relay(int argc, char **argv);
+static void console_cmd_steer(int argc, char **argv);
+static void console_cmd_leave(int argc, char **argv);
+static void console_cmd_factory_reset(int argc, char **argv);
+static void console_cmd_bench(int argc, char **argv);
+static void console_cmd_hw(int argc, char **argv);
+static void console_cmd_restart(int argc, char **argv);
+
+static const console_cmd_t s_commands[] = {
+    { "help", "", console_cmd_help },
+    { "stats", "", console_cmd_stats },
+    { "net", "", console_cmd_net },
+    { "trace", "[count]", console_cmd_trace },
+    { "capture", "[clear]", console_cmd_capture },
+    { "metrics", "[clear]", console_cmd_metrics },
+    { "relay", "on|off|toggle", console_cmd_relay },
+    { "steer", "", console_cmd_steer },
+    { "leave", "", console_cmd_leave },
+    { "factory-reset", "", console_cmd_factory_reset },
+    { "bench", "", console_cmd_bench },
+    { "hw", "[<20 hex digits>]", console_cmd_hw },
+    { "restart", "", console_cmd_restart },
+};
+
+#define CONSOLE_COMMAND_COUNT   (sizeof(s_commands) / sizeof(s_commands[0]))
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static void console_printf(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(s_out, sizeof(s_out), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof(s_out)) {
+        len = sizeof(s_out) - 1;
+    }
+    s_write(s_out, (size_t)len);
+}
+
+/** Split a line into words in place */
+static int console_split(char *line, char **argv)
+{
+    int argc = 0;
+
+    while (*line) {
+        while (*line == ' ' || *line == '\t') {
+            *line++ = '\0';
+        }
+        if (!*line) {
+            break;
+        }
+        if (argc == CONSOLE_ARGS_MAX) {
+            return -1;
+        }
+        argv[argc++] = line;
+        while (*line && *line != ' ' && *line != '\t') {
+            line++;
+        }
+    }
+    return argc;
+}
+
+static const console_cmd_t *console_find(const char *name)
+{
+    for (size_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+        if (strcmp(s_commands[i].name, name) == 0) {
+            return &s_commands[i];
+        }
+    }
+    return NULL;
+}
+
+static void console_execute(char *line)
+{
+    char *argv[CONSOLE_ARGS_MAX];
+
+    console_printf("> %s\n", line);
+
+    int argc = console_split(line, argv);
+    if (argc < 0) {
+        console_printf("Too many words (max %d)\n", CONSOLE_ARGS_MAX);
+        return;
+    }
+    if (argc == 0) {
+        return;
+    }
+
+    const console_cmd_t *cmd = console_find(argv[0]);
+    if (!cmd) {
+        console_printf("Unknown command '%s', try 'help'\n", argv[0]);
+        return;
+    }
+    cmd->run(argc, argv);
+}
+
+static int console_hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/** Poll the port; the delay is the only place the task waits */
+static void console_task(void *arg)
+{
+    (void)arg;
+    int c;
+
+    for (;;) {
+        while ((c = s_read()) >= 0) {
+            console_feed((char)c);
+        }
+        vTaskDelay(pdMS_TO_TICKS(CONSOLE_POLL_MS));
+    }
+}
+
+static void console_cmd_help(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    for (size_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+        console_printf("  %s %s\n", s_commands[i].name, s_commands[i].usage);
+    }
+}
+
+static void console_cmd_stats(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    zb_heap_snapshot_t heap;
+    relay_stats_t relay;
+    relay_counters_t counters;
+    button_stats_t button;
+    app_event_stats_t events;
+    timer_wheel_stats_t timers;
+
+    zb_heap_snapshot(&heap);
+    relay_get_stats(&relay);
+    relay_get_counters(&counters);
+    button_get_stats(&button);
+    app_event_get_stats(&events);
+    timer_wheel_get_stats(&timers);
+
+    console_printf("uptime   %llu s\n", (unsigned long long)(esp_timer_get_time() / 1000000));
+    console_printf("heap     free %u, min %u, largest %u, blocks %u\n",
+                   (unsigned)heap.free_bytes, (unsigned)heap.min_free_bytes,
+                   (unsigned)heap.largest_block, (unsigned)heap.allocated_blocks);
+    console_printf("relay    %s (desired %s), transitions %lu, duplicates %lu, deferred %lu, collapsed %lu\n",
+                   relay_get_state() ? "ON" : "OFF", relay_get_desired_state() ? "ON" : "OFF",
+                   (unsigned long)relay.transitions, (unsigned long)relay.duplicates,
+                   (unsigned long)relay.deferred, (unsigned long)relay.collapsed);
+    console_printf("lifetime %lu h, %lu cycles\n",
+                   (unsigned long)(counters.runtime_s / 3600), (unsigned long)counters.cycles);
+    console_printf("button   short %lu, long %lu, very long %lu, ignored %lu\n",
+                   (unsigned long)button.short_presses, (unsigned long)button.long_presses,
+                   (unsigned long)button.very_long_presses, (unsigned long)button.ignored_presses);
+    console_printf("latency  button to relay last %lu us, max %lu us, over %d us: %lu\n",
+                   (unsigned long)button.last_latency_us, (unsigned long)button.max_latency_us,
+                   BUTTON_LATENCY_TARGET_US, (unsigned long)button.slow_toggles);
+    console_printf("events   published %lu, delivered %lu, dispatch max %lu / avg %lu cycles\n",
+                   (unsigned long)events.published, (unsigned long)events.delivered,
+                   (unsigned long)events.max_cycles,
+                   (unsigned long)(events.published ? events.total_cycles / events.published : 0));
+    console_printf("timers   pending %lu, armed %lu, expired %lu, cancelled %lu, wakeups %lu\n",
+                   (unsigned long)timers.pending, (unsigned long)timers.armed,
+                   (unsigned long)timers.expired, (unsigned long)timers.cancelled,
+                   (unsigned long)timers.wakeups);
+#if CURRENT_SENSE_ENABLE
+    current_sense_stats_t current;
+    current_sense_get_stats(&current);
+    console_printf("current  %lu mA, %lu W, %llu Wh, alarms 0x%02x, read errors %lu\n",
+                   (unsigned long)current.current_ma, (unsigned long)current.active_power_w,
+                   (unsigned long long)(current.energy_mj / 3600000ULL), current.alarms,
+                   (unsigned long)current.read_errors);
+#endif
+}
+
+static void console_cmd_net(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    zigbee_handler_net_info_t info;
+    diagnostics_counters_t diag;
+    network_stats_t net;
+    static const char *const s_states[] = { "idle", "steering", "joined", "rejoining", "backoff", "left" };
+
+    zigbee_handler_get_network_info(&info);
+    diagnostics_get(&diag);
+    network_get_stats(&net);
+
+    const uint8_t *ieee = info.ieee_addr;
+    console_printf("ieee     %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x\n",
+                   ieee[7], ieee[6], ieee[5], ieee[4], ieee[3], ieee[2], ieee[1], ieee[0]);
+    if (!info.joined) {
+        console_printf("network  not joined\n");
+    } else {
+        const uint8_t *epid = info.extended_pan_id;
+        console_printf("network  PAN 0x%04x, channel %u, short 0x%04x\n",
+                       info.pan_id, info.channel, info.short_addr);
+        console_printf("ext pan  %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x\n",
+                       epid[7], epid[6], epid[5], epid[4], epid[3], epid[2], epid[1], epid[0]);
+    }
+    console_printf("state    %s, leaves %u, rejoins %u, failures %u, backoff %lu ms\n",
+                   net.state < sizeof(s_states) / sizeof(s_states[0]) ? s_states[net.state] : "?",
+                   net.leaves, net.rejoins, net.failures, (unsigned long)net.backoff_ms);
+    console_printf("leave    to steering %lu ms, to joined %lu ms\n",
+                   (unsigned long)net.leave_to_steering_ms, (unsigned long)net.leave_to_joined_ms);
+    console_printf("aps      rx ucast %u bcast %u\n", diag.aps_rx_ucast, diag.aps_rx_bcast);
+    console_printf("link     lqi %u, rssi %d dBm, parent changes %u, steering attempts %u\n",
+                   diag.last_lqi, diag.last_rssi, diag.parent_changes, diag.steering_attempts);
+    console_printf("parent   losses %u, last detected after %lu ms, recovered in %lu ms\n",
+                   diag.parent_losses, (unsigned long)diag.parent_detect_ms,
+                   (unsigned long)diag.parent_recovery_ms);
+}
+
+static void console_cmd_trace(int argc, char **argv)
+{
+    size_t want = CONSOLE_TRACE_MAX / 2;
+
+    if (argc > 1) {
+        want = strtoul(argv[1], NULL, 10);
+        if (want == 0 || want > CONSOLE_TRACE_MAX) {
+            want = CONSOLE_TRACE_MAX;
+        }
+    }
+
+    size_t count = event_trace_copy_recent(s_trace, want);
+    console_printf("%u events, boot %u\n", (unsigned)count, event_trace_boot_count());
+    for (size_t i = 0; i < count; i++) {
+        console_printf("%10lu ms  %-10s  arg8=0x%02x  arg16=0x%04x\n",
+                       (unsigned long)s_trace[i].timestamp_ms, event_trace_type_name(s_trace[i].type),
+                       s_trace[i].arg8, s_trace[i].arg16);
+    }
+}
+
+static void console_cmd_capture(int argc, char **argv)
+{
+    capture_stats_t stats;
+
+    if (argc > 1 && strcmp(argv[1], "clear") == 0) {
+        capture_clear();
+        console_printf("capture cleared\n");
+        return;
+    }
+
+    capture_get_stats(&stats);
+    console_printf("%lu frames, %lu overwritten, record avg %lu / max %lu cycles\n",
+                   (unsigned long)stats.frames, (unsigned long)stats.overwritten,
+                   (unsigned long)(stats.frames ? stats.record_cycles / stats.frames : 0),
+                   (unsigned long)stats.record_cycles_max);
+    /* CAP lines go to the log, tools/capture_to_pcap.py reads them */
+    capture_dump();
+}
+
+static void console_cmd_metrics(int argc, char **argv)
+{
+    metrics_snapshot_t snapshot;
+
+    if (argc > 1 && strcmp(argv[1], "clear") == 0) {
+        metrics_reset();
+        console_printf("metrics cleared\n");
+        return;
+    }
+
+    metrics_snapshot(&snapshot);
+    for (uint32_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        console_printf("METRIC %s=%lu\n", metrics_counter_name((metric_counter_t)i),
+                       (unsigned long)snapshot.counters[i]);
+    }
+    for (uint32_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        console_printf("METRIC %s=%lu\n", metrics_gauge_name((metric_gauge_t)i),
+                       (unsigned long)snapshot.gauges[i]);
+    }
+    /* Percentiles and max are bucket upper bounds, at most 25 % above the value */
+    for (uint32_t i = 0; i < METRIC_HIST_COUNT; i++) {
+        const uint32_t *fields = snapshot.hists[i].fields;
+        console_printf("METRIC %s count=%lu mean=%lu p50=%lu p90=%lu p99=%lu max=%lu\n",
+                       metrics_hist_name((metric_hist_t)i),
+                       (unsigned long)fields[METRICS_HIST_FIELD_COUNT],
+                       (unsigned long)fields[METRICS_HIST_FIELD_MEAN],
+                       (unsigned long)fields[METRICS_HIST_FIELD_P50],
+                       (unsigned long)fields[METRICS_HIST_FIELD_P90],
+                       (unsigned long)fields[METRICS_HIST_FIELD_P99],
+                       (unsigned long)fields[METRICS_HIST_FIELD_MAX]);
+    }
+}
+
+static void console_cmd_relay(int argc, char **argv)
+{
+    bool on;
+
+    if (argc < 2) {
+        console_printf("relay is %s\n", relay_get_state() ? "ON" : "OFF");
+        return;
+    }
+    if (strcmp(argv[1], "on") == 0) {
+        on = true;
+    } else if (strcmp(argv[1], "off") == 0) {
+        on = false;
+    } else if (strcmp(argv[1], "toggle") == 0) {
+        on = !relay_get_desired_state();
+    } else {
+        console_printf("usage: relay on|off|toggle\n");
+        return;
+    }
+
+    relay_result_t result = relay_set_from(on, APP_EVENT_SRC_CONSOLE);
+    console_printf("relay %s%s\n", on ? "ON" : "OFF",
+                   result == RELAY_RESULT_DEFERRED ? " (deferred by short-cycle protection)" :
+                   result == RELAY_RESULT_DUPLICATE ? " (unchanged)" : "");
+}
+
+static void console_cmd_steer(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    network_start_steering();
+    console_printf("steering started\n");
+}
+
+static void console_cmd_leave(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    network_leave();
+    console_printf("leaving the network, steering restarts\n");
+}
+
+static void console_cmd_factory_reset(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    console_printf("factory reset, restarting\n");
+    network_factory_reset();
+}
+
+static void console_cmd_bench(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    char line[] = "relay toggle";
+    char *words[CONSOLE_ARGS_MAX];
+    const console_cmd_t *volatile found = NULL;
+    uint64_t total = 0;
+
+    /* Split and lookup, not execution: the cost of a console line itself */
+    for (uint32_t i = 0; i < CONSOLE_BENCH_ITERATIONS; i++) {
+        memcpy(line, "relay toggle", sizeof(line));
+        esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+        if (console_split(line, words) > 0) {
+            found = console_find(words[0]);
+        }
+        total += esp_cpu_get_cycle_count() - start;
+    }
+    (void)found;
+    console_printf("BENCH console_parse_cycles=%lu\n", (unsigned long)(total / CONSOLE_BENCH_ITERATIONS));
+
+    /* Decoding only, nothing is published: safe while the fan runs */
+    console_printf("BENCH cmd_path_cycles=%lu\n",
+                   (unsigned long)zigbee_handler_bench_command_path(CONSOLE_BENCH_ITERATIONS));
+
+    app_event_stats_t event_stats;
+    app_event_get_stats(&event_stats);
+    console_printf("BENCH event_dispatch_max_cycles=%lu\n", (unsigned long)event_stats.max_cycles);
+    console_printf("BENCH event_dispatch_avg_cycles=%lu\n",
+                   (unsigned long)(event_stats.published ? event_stats.total_cycles / event_stats.published : 0));
+
+    timer_wheel_bench_t wheel_bench;
+    if (timer_wheel_bench(TIMER_WHEEL_BENCH_OPS, &wheel_bench) == ESP_OK) {
+        console_printf("BENCH timer_arm_cycles=%lu\n", (unsigned long)wheel_bench.arm_cycles_avg);
+        console_printf("BENCH timer_arm_max_cycles=%lu\n", (unsigned long)wheel_bench.arm_cycles_max);
+        console_printf("BENCH timer_cancel_cycles=%lu\n", (unsigned long)wheel_bench.cancel_cycles_avg);
+        console_printf("BENCH timer_cancel_max_cycles=%lu\n", (unsigned long)wheel_bench.cancel_cycles_max);
+    }
+
+    metrics_bench_t metrics;
+    metrics_bench(METRICS_BENCH_OPS, &metrics);
+    console_printf("BENCH metrics_count_cycles=%lu\n", (unsigned long)metrics.count_cycles);
+    console_printf("BENCH metrics_set_cycles=%lu\n", (unsigned long)metrics.set_cycles);
+    console_printf("BENCH metrics_record_cycles=%lu\n", (unsigned long)metrics.record_cycles);
+#if CAPTURE_ENABLE
+    capture_stats_t capture;
+    capture_get_stats(&capture);
+    if (capture.frames > 0) {
+        console_printf("BENCH capture_record_cycles=%lu\n",
+                       (unsigned long)(capture.record_cycles / capture.frames));
+        console_printf("BENCH capture_record_max_cycles=%lu\n", (unsigned long)capture.record_cycles_max);
+    }
+#endif
+#if CURRENT_SENSE_ENABLE
+    console_printf("BENCH current_kernel_cycles=%lu\n",
+                   (unsigned long)current_sense_bench_kernel(CURRENT_SENSE_BENCH_BLOCKS));
+#endif
+}
+
+static void console_cmd_hw(int argc, char **argv)
+{
+    hw_profile_t profile;
+    uint8_t *bytes = (uint8_t *)&profile;
+    size_t n = 0;
+
+    if (argc < 2) {
+        const hw_profile_t *active = hw_profile_get();
+        const uint8_t *raw = (const uint8_t *)active;
+        static const char *const s_sources[] = { "default", "stored", "stored invalid, default" };
+
+        console_printf("profile  %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x (%s)\n",
+                       raw[0], raw[1], raw[2], raw[3], raw[4], raw[5], raw[6], raw[7], raw[8], raw[9],
+                       s_sources[hw_profile_source()]);
+        for (uint8_t i = 0; i < active->output_count; i++) {
+            console_printf("output   GPIO%u active %s\n", active->output_pins[i],
+                           (active->output_active_high & (1U << i)) ? "high" : "low");
+        }
+        console_printf("button   GPIO%u active %s\n", active->button_pin,
+                       active->button_active_level ? "high" : "low");
+        console_printf("led      GPIO%u active %s\n", active->led_pin,
+                       active->led_active_level ? "high" : "low");
+        console_printf("current  GPIO%u\n", active->current_pin);
+        return;
+    }
+
+    /* Hex digits, optionally split into several words */
+    for (int i = 1; i < argc; i++) {
+        for (const char *p = argv[i]; *p; p += 2) {
+            int hi = console_hex_digit(p[0]);
+            int lo = hi < 0 ? -1 : console_hex_digit(p[1]);
+            if (lo < 0 || n == sizeof(profile)) {
+                console_printf("usage: hw <%u bytes as hex>\n", (unsigned)sizeof(profile));
+                return;
+            }
+            bytes[n++] = (uint8_t)((hi << 4) | lo);
+        }
+    }
+    if (n != sizeof(profile)) {
+        console_printf("usage: hw <%u bytes as hex>\n", (unsigned)sizeof(profile));
+        return;
+    }
+
+    esp_err_t ret = hw_profile_store(&profile);
+    if (ret == ESP_OK) {
+        console_printf("profile stored, 'restart' to apply\n");
+    } else {
+        console_printf("profile rejected: %s (see log)\n", esp_err_to_name(ret));
+    }
+}
+
+static void console_cmd_restart(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    console_printf("restarting\n");
+    vTaskDelay(pdMS_TO_TICKS(100));
+    esp_restart();
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t console_init(console_read_t read, console_write_t write)
+{
+    if (!read || !write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_read = read;
+    s_write = write;
+
+#if CONSOLE_BENCH_AT_BOOT
+    /* Before the task and the Zigbee stack run, nothing disturbs the timing */
+    console_cmd_bench(0, NULL);
+#endif
+
+    BaseType_t created = xTaskCreate(console_task, "console", CONSOLE_TASK_STACK, NULL,
+                                     CONSOLE_TASK_PRIORITY, &s_task);
+    if (created != pdPASS) {
+        APP_LOGE("Failed to create task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    APP_LOGI("Console ready, type 'help'");
+    return ESP_OK;
+}
+
+void console_feed(char c)
+{
+    if (c == '\r' || c == '\n') {
+        if (s_overflow) {
+            console_printf("Line too long (max %d characters)\n", CONSOLE_LINE_MAX);
+        } else if (s_len > 0) {
+            s_line[s_len] = '\0';
+            console_execute(s_line);
+        }
+        s_len = 0;
+        s_overflow = false;
+        return;
+    }
+    if (c == '\b' || c == 0x7F) {
+        if (s_len > 0) {
+            s_len--;
+        }
+        return;
+    }
+    if ((unsigned char)c < ' ') {
+        return;
+    }
+    if (s_len == CONSOLE_LINE_MAX) {
+        s_overflow = true;
+        return;
+    }
+    s_line[s_len++] = c;
+}
+
+#else /* !CONSOLE_ENABLE */
+
+esp_err_t console_init(console_read_t read, console_write_t write)
+{
+    (void)read;
+    (void)write;
+    return ESP_OK;
+}
+
+void console_feed(char c)
+{
+    (void)c;
+}
+
+#endif /* CONSOLE_ENABLE */
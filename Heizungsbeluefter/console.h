@@ -0,0 +1,118 @@
+/**
+ * @file console.h
+ * @brief Serial command console for ESP32-C6 Zigbee Fan Switch
+ *
+ * setup() never returns (the Zigbee main loop runs in it), so loop() is
+ * never called and cannot read the serial port. The console runs in its own
+ * low-priority task instead: the sketch passes a non-blocking read function
+ * and a write function for its Serial object, the task polls the port and
+ * executes a command per line.
+ *
+ * Commands (type "help"):
+ *   stats                      heap, relay, button latency, event bus, timers
+ *   net                        network parameters and state, leave and parent-loss timings,
+ *                              APS counters
+ *   trace                      newest events of the event trace
+ *   capture [clear]            print the frame capture as CAP lines (CAPTURE_ENABLE)
+ *   metrics [clear]            print the metrics registry as METRIC lines, or zero it
+ *   relay on|off|toggle        switch the fan (short-cycle protection applies)
+ *   steer                      start network steering
+ *   leave                      leave the network, steering restarts
+ *   factory-reset              leave, erase zb_storage and restart
+ *   bench                      run the micro-benchmarks, prints BENCH lines
+ *   hw [<20 hex digits>]       show or store the hardware profile
+ *   restart                    restart the device
+ *
+ * Lines are parsed in place in a static buffer, nothing is allocated. The
+ * Zigbee task never waits for the console: commands that touch the stack
+ * take the Zigbee lock for a few calls only, or hand the work to the
+ * Zigbee scheduler.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Compile the console in (1) or out (0) */
+#ifndef CONSOLE_ENABLE
+#define CONSOLE_ENABLE              1
+#endif
+
+/** @brief Longest command line, longer lines are rejected */
+#define CONSOLE_LINE_MAX            96
+
+/** @brief Most words per line, including the command */
+#define CONSOLE_ARGS_MAX            8
+
+/** @brief Interval at which the task polls the port */
+#define CONSOLE_POLL_MS             20
+
+/**
+ * @brief Run the bench command once in console_init() (see tools/size_report.py)
+ *
+ * The BENCH lines are printed before the console task and the Zigbee stack
+ * start.
+ */
+#ifndef CONSOLE_BENCH_AT_BOOT
+#define CONSOLE_BENCH_AT_BOOT       0
+#endif
+
+/** @brief Iterations of the console parse and command path benchmarks */
+#define CONSOLE_BENCH_ITERATIONS    1000
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Read one character without waiting
+ *
+ * @return Character, or -1 if none is available
+ */
+typedef int (*console_read_t)(void);
+
+/**
+ * @brief Write output text (not NUL terminated)
+ */
+typedef void (*console_write_t)(const char *text, size_t len);
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Start the console task
+ *
+ * Call at the end of setup(), before zigbee_handler_start(). With
+ * CONSOLE_BENCH_AT_BOOT the benchmarks run here first.
+ *
+ * @param read Non-blocking read function of the port
+ * @param write Write function of the port
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the task could not be created
+ */
+esp_err_t console_init(console_read_t read, console_write_t write);
+
+/**
+ * @brief Process one input character
+ *
+ * Called by the console task; executes the line on CR or LF.
+ *
+ * @param c Input character
+ */
+void console_feed(char c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONSOLE_H */
@@ -0,0 +1,560 @@
+/**
+ * @file current_sense.c
+ * @brief Fan current measurement implementation
+ *
+ * The "current" task reads DMA frames from the continuous ADC driver, feeds
+ * them through the block kernel and, every CURRENT_SENSE_REPORT_MS, updates
+ * the attributes under the Zigbee lock. The task only blocks in
+ * adc_continuous_read(), so it costs nothing between frames.
+ */
+
+#include "current_sense.h"
+
+#if CURRENT_SENSE_ENABLE
+
+#include <stdlib.h>
+#include "relay.h"
+#include "zigbee_handler.h"
+#include "hw_profile.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_check.h"
+#include "esp_cpu.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#define APP_LOG_MODULE_LEVEL    CURRENT_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "CURRENT";
+
+#define CURRENT_SENSE_TASK_STACK        3072
+#define CURRENT_SENSE_TASK_PRIORITY     3
+
+#define CURRENT_SENSE_FRAME_BYTES       (CURRENT_SENSE_BLOCK_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define CURRENT_SENSE_REPORT_BLOCKS     (CURRENT_SENSE_REPORT_MS / CURRENT_SENSE_BLOCK_MS)
+
+/** A read waits at most for two blocks before it counts as an error */
+#define CURRENT_SENSE_READ_TIMEOUT_MS   (2 * CURRENT_SENSE_BLOCK_MS)
+
+/** Full scale of the 12-bit ADC at 12 dB attenuation, without calibration */
+#define CURRENT_SENSE_NOMINAL_UV_PER_COUNT  806
+
+#define CURRENT_SENSE_MJ_PER_WH         3600000ULL
+
+/** Sum and sum of squares of one block, in raw ADC counts */
+typedef struct {
+    uint32_t n;
+    uint32_t sum;
+    uint64_t sum_sq;
+} current_sense_block_t;
+
+static adc_continuous_handle_t s_adc;
+static TaskHandle_t s_task;
+static uint8_t s_frame[CURRENT_SENSE_FRAME_BYTES];
+static current_sense_block_t s_block;
+
+/** ADC input scale, from the calibration if available */
+static uint32_t s_uv_per_count = CURRENT_SENSE_NOMINAL_UV_PER_COUNT;
+
+static current_sense_stats_t s_stats;
+static uint64_t s_energy_saved_mj;
+static uint32_t s_energy_saved_ms;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** Attribute start values (the SDK copies them) */
+static const uint32_t s_attr_measurement_type = 0x00000009;    /* Active + apparent, AC */
+static const uint16_t s_attr_rms_voltage = CURRENT_SENSE_MAINS_V;
+static const uint16_t s_attr_zero_u16 = 0;
+static const int16_t s_attr_zero_s16 = 0;
+static const uint16_t s_attr_one_u16 = 1;
+static const uint16_t s_attr_milli_u16 = 1000;
+static const uint8_t s_attr_zero_u8 = 0;
+static esp_zb_uint48_t s_attr_summation;
+static const uint8_t s_attr_unit_kwh = 0x00;
+static const esp_zb_uint24_t s_attr_one_u24 = { .low = 1, .high = 0 };
+static const esp_zb_uint24_t s_attr_milli_u24 = { .low = 1000, .high = 0 };
+static const uint8_t s_attr_summation_format = 0x2B;  /* 5 integer, 3 fraction digits */
+static const esp_zb_int24_t s_attr_zero_s24 = { .low = 0, .high = 0 };
+
+#define CURRENT_SENSE_ACCESS_REPORTED   (ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING)
+
+const zb_ep_attr_desc_t current_sense_elec_attrs[CURRENT_SENSE_ELEC_ATTR_COUNT] = {
+    { 0x0000, ESP_ZB_ZCL_ATTR_TYPE_32BITMAP, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_measurement_type },
+    { 0x0505, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_rms_voltage },
+    { 0x0508, ESP_ZB_ZCL_ATTR_TYPE_U16, CURRENT_SENSE_ACCESS_REPORTED, &s_attr_zero_u16 },
+    { 0x050B, ESP_ZB_ZCL_ATTR_TYPE_S16, CURRENT_SENSE_ACCESS_REPORTED, &s_attr_zero_s16 },
+    { 0x050F, ESP_ZB_ZCL_ATTR_TYPE_U16, CURRENT_SENSE_ACCESS_REPORTED, &s_attr_zero_u16 },
+    { 0x0600, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_one_u16 },
+    { 0x0601, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_one_u16 },
+    { 0x0602, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_one_u16 },
+    { 0x0603, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_milli_u16 },
+    { 0x0604, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_one_u16 },
+    { 0x0605, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_one_u16 },
+    { CURRENT_SENSE_ATTR_ALARMS_ID, ESP_ZB_ZCL_ATTR_TYPE_8BITMAP, CURRENT_SENSE_ACCESS_REPORTED, &s_attr_zero_u8 },
+};
+
+const zb_ep_attr_desc_t current_sense_meter_attrs[CURRENT_SENSE_METER_ATTR_COUNT] = {
+    { 0x0000, ESP_ZB_ZCL_ATTR_TYPE_U48, CURRENT_SENSE_ACCESS_REPORTED, &s_attr_summation },
+    { 0x0200, ESP_ZB_ZCL_ATTR_TYPE_8BITMAP, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_zero_u8 },
+    { 0x0300, ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_unit_kwh },
+    { 0x0301, ESP_ZB_ZCL_ATTR_TYPE_U24, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_one_u24 },
+    { 0x0302, ESP_ZB_ZCL_ATTR_TYPE_U24, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_milli_u24 },
+    { 0x0303, ESP_ZB_ZCL_ATTR_TYPE_8BITMAP, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_summation_format },
+    { 0x0306, ESP_ZB_ZCL_ATTR_TYPE_8BITMAP, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_attr_zero_u8 },
+    { 0x0400, ESP_ZB_ZCL_ATTR_TYPE_S24, CURRENT_SENSE_ACCESS_REPORTED, &s_attr_zero_s24 },
+};
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static size_t current_sense_accumulate(current_sense_block_t *block, const uint8_t *data, size_t len);
+static uint32_t current_sense_isqrt(uint64_t value);
+static uint32_t current_sense_block_ma(const current_sense_block_t *block);
+static uint8_t current_sense_check_alarms(uint32_t current_ma);
+static void current_sense_set_attr(uint16_t cluster_id, uint16_t attr_id, void *value);
+static void current_sense_publish(uint32_t current_ma, uint8_t alarms);
+static void current_sense_save(uint64_t energy_mj);
+static void current_sense_shutdown(void);
+static void current_sense_calibrate(adc_unit_t unit, adc_channel_t channel);
+static void current_sense_task(void *arg);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/**
+ * @brief Block kernel: add samples until the block is full
+ *
+ * The pattern has a single channel, so every result belongs to the sensor.
+ * Per-sample cost is a load, a mask, one 32x32 multiply and two adds.
+ *
+ * @return Bytes consumed
+ */
+static size_t current_sense_accumulate(current_sense_block_t *block, const uint8_t *data, size_t len)
+{
+    const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)data;
+    size_t count = len / SOC_ADC_DIGI_RESULT_BYTES;
+    size_t room = CURRENT_SENSE_BLOCK_SAMPLES - block->n;
+    uint32_t sum = 0;
+    uint64_t sum_sq = 0;
+
+    if (count > room) {
+        count = room;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint32_t x = result[i].type2.data;
+        sum += x;
+        sum_sq += x * x;
+    }
+
+    block->n += count;
+    block->sum += sum;
+    block->sum_sq += sum_sq;
+    return count * SOC_ADC_DIGI_RESULT_BYTES;
+}
+
+/** floor(sqrt(value)), bit by bit */
+static uint32_t current_sense_isqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/**
+ * @brief AC RMS of a full block in mA
+ *
+ * N^2 * variance = N * sum(x^2) - sum(x)^2 is exact in 64 bits for blocks of
+ * up to 4096 12-bit samples. It is scaled by 256 before the root to keep
+ * four fractional bits of the RMS in counts.
+ */
+static uint32_t current_sense_block_ma(const current_sense_block_t *block)
+{
+    uint64_t n2_var = (uint64_t)block->n * block->sum_sq - (uint64_t)block->sum * block->sum;
+    uint64_t rms_x16 = current_sense_isqrt(n2_var << 8) / block->n;
+    uint64_t ma = rms_x16 * s_uv_per_count * CURRENT_SENSE_MA_PER_V / (16ULL * 1000000ULL);
+
+    if (CURRENT_SENSE_NOISE_MA > 0) {
+        uint64_t noise_sq = (uint64_t)CURRENT_SENSE_NOISE_MA * CURRENT_SENSE_NOISE_MA;
+        uint64_t ma_sq = ma * ma;
+        ma = ma_sq > noise_sq ? current_sense_isqrt(ma_sq - noise_sq) : 0;
+    }
+    return (uint32_t)ma;
+}
+
+/** Compare the current with a relay state that has settled */
+static uint8_t current_sense_check_alarms(uint32_t current_ma)
+{
+    relay_stats_t relay_stats;
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint8_t alarms;
+
+    relay_get_stats(&relay_stats);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    alarms = s_stats.alarms;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (now_ms - relay_stats.last_change_ms < CURRENT_SENSE_ALARM_GRACE_MS) {
+        return alarms;
+    }
+
+    alarms = 0;
+    if (relay_get_state()) {
+        if (current_ma < CURRENT_SENSE_MIN_ON_MA) {
+            alarms |= CURRENT_SENSE_ALARM_NO_CURRENT;
+        }
+    } else if (current_ma > CURRENT_SENSE_MAX_OFF_MA) {
+        alarms |= CURRENT_SENSE_ALARM_OFF_CURRENT;
+    }
+    return alarms;
+}
+
+/** Set an attribute, manufacturer-specific ones (ZB_EP_MANUF_ATTR_ID_MIN) with the code */
+static void current_sense_set_attr(uint16_t cluster_id, uint16_t attr_id, void *value)
+{
+    esp_zb_zcl_status_t status;
+
+    if (attr_id >= ZB_EP_MANUF_ATTR_ID_MIN) {
+        status = esp_zb_zcl_set_manufacturer_attribute_val(
+            ZIGBEE_ENDPOINT, cluster_id, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+            ZB_EP_MANUF_CODE, attr_id, value, false);
+    } else {
+        status = esp_zb_zcl_set_attribute_val(
+            ZIGBEE_ENDPOINT, cluster_id, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, attr_id, value, false);
+    }
+
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        APP_LOGW("Failed to set attribute 0x%04x of cluster 0x%04x, status: 0x%x",
+                 attr_id, cluster_id, status);
+    }
+}
+
+static void current_sense_publish(uint32_t current_ma, uint8_t alarms)
+{
+    uint32_t apparent_va = current_ma * CURRENT_SENSE_MAINS_V / 1000;
+    uint32_t active_w = apparent_va * CURRENT_SENSE_POWER_FACTOR_PCT / 100;
+    uint64_t energy_wh;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    energy_wh = s_stats.energy_mj / CURRENT_SENSE_MJ_PER_WH;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    uint16_t rms_current = current_ma > 0xFFFE ? 0xFFFE : (uint16_t)current_ma;
+    uint16_t apparent = apparent_va > 0xFFFE ? 0xFFFE : (uint16_t)apparent_va;
+    int16_t active = active_w > 0x7FFE ? 0x7FFE : (int16_t)active_w;
+    esp_zb_uint48_t summation = { .low = (uint32_t)energy_wh, .high = (uint16_t)(energy_wh >> 32) };
+    esp_zb_int24_t demand = { .low = (uint16_t)active_w, .high = (int8_t)(active_w >> 16) };
+
+    bool locked = zigbee_handler_lock();
+    current_sense_set_attr(ESP_ZB_ZCL_CLUSTER_ID_ELECTRICAL_MEASUREMENT, 0x0508, &rms_current);
+    current_sense_set_attr(ESP_ZB_ZCL_CLUSTER_ID_ELECTRICAL_MEASUREMENT, 0x050B, &active);
+    current_sense_set_attr(ESP_ZB_ZCL_CLUSTER_ID_ELECTRICAL_MEASUREMENT, 0x050F, &apparent);
+    current_sense_set_attr(ESP_ZB_ZCL_CLUSTER_ID_ELECTRICAL_MEASUREMENT, CURRENT_SENSE_ATTR_ALARMS_ID,
+                           &alarms);
+    current_sense_set_attr(ESP_ZB_ZCL_CLUSTER_ID_METERING, 0x0000, &summation);
+    current_sense_set_attr(ESP_ZB_ZCL_CLUSTER_ID_METERING, 0x0400, &demand);
+    zigbee_handler_unlock(locked);
+}
+
+static void current_sense_save(uint64_t energy_mj)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(CURRENT_SENSE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+    if (ret == ESP_OK) {
+        ret = nvs_set_u64(handle, CURRENT_SENSE_NVS_KEY, energy_mj);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret == ESP_OK) {
+        s_energy_saved_mj = energy_mj;
+        s_energy_saved_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    } else {
+        APP_LOGW("Failed to store energy: %s", esp_err_to_name(ret));
+    }
+}
+
+static void current_sense_shutdown(void)
+{
+    uint64_t energy_mj;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    energy_mj = s_stats.energy_mj;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (energy_mj != s_energy_saved_mj) {
+        current_sense_save(energy_mj);
+    }
+}
+
+/** Input scale from the eFuse calibration, measured between 0.5 and 3.0 V */
+static void current_sense_calibrate(adc_unit_t unit, adc_channel_t channel)
+{
+    adc_cali_handle_t cali = NULL;
+    adc_cali_curve_fitting_config_t config = {
+        .unit_id = unit,
+        .chan = channel,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    int low_mv = 0;
+    int high_mv = 0;
+
+    if (adc_cali_create_scheme_curve_fitting(&config, &cali) == ESP_OK &&
+        adc_cali_raw_to_voltage(cali, 600, &low_mv) == ESP_OK &&
+        adc_cali_raw_to_voltage(cali, 3600, &high_mv) == ESP_OK && high_mv > low_mv) {
+        s_uv_per_count = (uint32_t)(high_mv - low_mv) * 1000 / 3000;
+        APP_LOGI("ADC calibrated: %lu uV/count", (unsigned long)s_uv_per_count);
+    } else {
+        APP_LOGW("No ADC calibration, using %lu uV/count", (unsigned long)s_uv_per_count);
+    }
+}
+
+static void current_sense_task(void *arg)
+{
+    (void)arg;
+    uint32_t report_blocks = 0;
+    uint64_t report_sum_sq = 0;
+    uint32_t energy_rem = 0;
+
+    for (;;) {
+        uint32_t len = 0;
+        esp_err_t ret = adc_continuous_read(s_adc, s_frame, sizeof(s_frame), &len,
+                                            CURRENT_SENSE_READ_TIMEOUT_MS);
+        if (ret != ESP_OK) {
+            portENTER_CRITICAL(&s_stats_lock);
+            s_stats.read_errors++;
+            portEXIT_CRITICAL(&s_stats_lock);
+            continue;
+        }
+
+        size_t offset = 0;
+        while (offset < len) {
+            esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+            offset += current_sense_accumulate(&s_block, s_frame + offset, len - offset);
+            if (s_block.n < CURRENT_SENSE_BLOCK_SAMPLES) {
+                break;
+            }
+            uint32_t block_ma = current_sense_block_ma(&s_block);
+            uint32_t cycles = esp_cpu_get_cycle_count() - start;
+            s_block = (current_sense_block_t){ 0 };
+
+            /* V * mA = mW, over one block: mW * ms / 1000 = mJ */
+            uint32_t power_mw = block_ma * CURRENT_SENSE_MAINS_V * CURRENT_SENSE_POWER_FACTOR_PCT / 100;
+            uint64_t energy_x1000 = (uint64_t)power_mw * CURRENT_SENSE_BLOCK_MS + energy_rem;
+            energy_rem = (uint32_t)(energy_x1000 % 1000);
+
+            portENTER_CRITICAL(&s_stats_lock);
+            s_stats.energy_mj += energy_x1000 / 1000;
+            s_stats.blocks++;
+            s_stats.kernel_cycles = cycles;
+            portEXIT_CRITICAL(&s_stats_lock);
+
+            report_sum_sq += (uint64_t)block_ma * block_ma;
+            if (++report_blocks < CURRENT_SENSE_REPORT_BLOCKS) {
+                continue;
+            }
+
+            /* RMS over the report interval */
+            uint32_t current_ma = current_sense_isqrt(report_sum_sq / report_blocks);
+            report_blocks = 0;
+            report_sum_sq = 0;
+
+            uint8_t alarms = current_sense_check_alarms(current_ma);
+            uint8_t previous;
+            uint64_t energy_mj;
+
+            portENTER_CRITICAL(&s_stats_lock);
+            previous = s_stats.alarms;
+            s_stats.current_ma = current_ma;
+            s_stats.active_power_w = current_ma * CURRENT_SENSE_MAINS_V / 1000 *
+                                     CURRENT_SENSE_POWER_FACTOR_PCT / 100;
+            s_stats.alarms = alarms;
+            energy_mj = s_stats.energy_mj;
+            portEXIT_CRITICAL(&s_stats_lock);
+
+            if (alarms != previous) {
+                if (alarms & CURRENT_SENSE_ALARM_NO_CURRENT) {
+                    APP_LOGW("Relay ON but only %lu mA: fan blocked or disconnected?",
+                             (unsigned long)current_ma);
+                } else if (alarms & CURRENT_SENSE_ALARM_OFF_CURRENT) {
+                    APP_LOGW("Relay OFF but %lu mA flowing: contact welded?", (unsigned long)current_ma);
+                } else {
+                    APP_LOGI("Current alarm cleared (%lu mA)", (unsigned long)current_ma);
+                }
+            }
+
+            current_sense_publish(current_ma, alarms);
+
+            uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+            if (energy_mj != s_energy_saved_mj &&
+                now_ms - s_energy_saved_ms >= CURRENT_SENSE_SAVE_INTERVAL_MS) {
+                current_sense_save(energy_mj);
+            }
+        }
+    }
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t current_sense_init(void)
+{
+    adc_unit_t unit;
+    adc_channel_t channel;
+    nvs_handle_t handle;
+    uint8_t pin = hw_profile_get()->current_pin;
+
+    _Static_assert(CURRENT_SENSE_BLOCK_SAMPLES <= 4096, "block too long for the 64-bit kernel");
+    _Static_assert(CURRENT_SENSE_REPORT_MS % CURRENT_SENSE_BLOCK_MS == 0,
+                   "report interval must be a whole number of blocks");
+
+    if (pin == HW_PROFILE_PIN_NONE) {
+        APP_LOGI("No current sensor in the hardware profile");
+        return ESP_OK;
+    }
+
+    if (nvs_open(CURRENT_SENSE_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u64(handle, CURRENT_SENSE_NVS_KEY, &s_stats.energy_mj);
+        nvs_close(handle);
+    }
+    s_energy_saved_mj = s_stats.energy_mj;
+
+    uint64_t energy_wh = s_stats.energy_mj / CURRENT_SENSE_MJ_PER_WH;
+    s_attr_summation.low = (uint32_t)energy_wh;
+    s_attr_summation.high = (uint16_t)(energy_wh >> 32);
+
+    ESP_RETURN_ON_ERROR(adc_continuous_io_to_channel(pin, &unit, &channel),
+                        TAG, "GPIO%u is not an ADC pin", pin);
+    ESP_RETURN_ON_FALSE(unit == ADC_UNIT_1, ESP_ERR_INVALID_ARG, TAG,
+                        "GPIO%u is not on ADC1", pin);
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = 2 * CURRENT_SENSE_FRAME_BYTES,
+        .conv_frame_size = CURRENT_SENSE_FRAME_BYTES,
+    };
+    ESP_RETURN_ON_ERROR(adc_continuous_new_handle(&handle_config, &s_adc), TAG, "Failed to create ADC");
+
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_12,
+        .channel = channel,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t config = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = CURRENT_SENSE_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    ESP_RETURN_ON_ERROR(adc_continuous_config(s_adc, &config), TAG, "Failed to configure ADC");
+
+    current_sense_calibrate(unit, channel);
+
+    /* ADC first: on a stopped ADC the task's read fails at once and it would spin */
+    ESP_RETURN_ON_ERROR(adc_continuous_start(s_adc), TAG, "Failed to start ADC");
+
+    BaseType_t created = xTaskCreate(current_sense_task, "current", CURRENT_SENSE_TASK_STACK, NULL,
+                                     CURRENT_SENSE_TASK_PRIORITY, &s_task);
+    if (created != pdPASS) {
+        adc_continuous_stop(s_adc);
+        APP_LOGE("Failed to create task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (esp_register_shutdown_handler(current_sense_shutdown) != ESP_OK) {
+        APP_LOGW("Energy is not saved on restart");
+    }
+
+    APP_LOGI("Measuring on GPIO%u, %d Hz, %d ms blocks, energy %llu Wh",
+             pin, CURRENT_SENSE_SAMPLE_HZ, CURRENT_SENSE_BLOCK_MS,
+             (unsigned long long)energy_wh);
+    return ESP_OK;
+}
+
+void current_sense_get_stats(current_sense_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+uint32_t current_sense_bench_kernel(uint32_t blocks)
+{
+    adc_digi_output_data_t *samples = malloc(CURRENT_SENSE_FRAME_BYTES);
+    uint64_t total = 0;
+    volatile uint32_t sink = 0;
+
+    if (!samples || blocks == 0) {
+        free(samples);
+        return 0;
+    }
+
+    /* Triangle wave around mid-scale, one period per CURRENT_SENSE_SAMPLES_PER_PERIOD */
+    for (uint32_t i = 0; i < CURRENT_SENSE_BLOCK_SAMPLES; i++) {
+        uint32_t phase = i % CURRENT_SENSE_SAMPLES_PER_PERIOD;
+        uint32_t half = CURRENT_SENSE_SAMPLES_PER_PERIOD / 2;
+        uint32_t ramp = phase < half ? phase : CURRENT_SENSE_SAMPLES_PER_PERIOD - phase;
+        samples[i].val = 0;
+        samples[i].type2.data = 1048 + ramp * 2000 / half;
+    }
+
+    for (uint32_t b = 0; b < blocks; b++) {
+        current_sense_block_t block = { 0 };
+        esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+        current_sense_accumulate(&block, (const uint8_t *)samples, CURRENT_SENSE_FRAME_BYTES);
+        sink = current_sense_block_ma(&block);
+        total += esp_cpu_get_cycle_count() - start;
+    }
+    (void)sink;
+
+    free(samples);
+    return (uint32_t)(total / blocks);
+}
+
+#else /* !CURRENT_SENSE_ENABLE */
+
+esp_err_t current_sense_init(void)
+{
+    return ESP_OK;
+}
+
+void current_sense_get_stats(current_sense_stats_t *stats)
+{
+    *stats = (current_sense_stats_t){ 0 };
+}
+
+uint32_t current_sense_bench_kernel(uint32_t blocks)
+{
+    (void)blocks;
+    return 0;
+}
+
+#endif /* CURRENT_SENSE_ENABLE */
@@ -0,0 +1,205 @@
+/**
+ * @file current_sense.h
+ * @brief Fan current measurement for ESP32-C6 Zigbee Fan Switch
+ *
+ * Measures the RMS current through the fan with a current transformer (or a
+ * Hall sensor with AC output) on an ADC1 pin, biased to mid-supply. The ADC
+ * runs in continuous (DMA) mode at CURRENT_SENSE_SAMPLE_HZ; every block of
+ * CURRENT_SENSE_BLOCK_SAMPLES covers a whole number of mains periods, so the
+ * RMS needs neither a zero-cross input nor windowing: partial periods, the
+ * only source of ripple in a block RMS, cannot occur.
+ *
+ * The block kernel runs in integer arithmetic only: one pass accumulates
+ * sum and sum of squares of the raw samples, the AC RMS then follows from
+ *   N * rms = sqrt(N * sum(x^2) - sum(x)^2)
+ * which removes the DC bias exactly and is converted to milliamperes with
+ * the ADC calibration and CURRENT_SENSE_MA_PER_V.
+ *
+ * Every CURRENT_SENSE_REPORT_MS the block values are combined and published
+ * on the fan endpoint:
+ *
+ * Electrical Measurement cluster (0x0B04):
+ *   0x0000  MeasurementType      (AC active + apparent)
+ *   0x0505  RMSVoltage           (V, CURRENT_SENSE_MAINS_V, not measured)
+ *   0x0508  RMSCurrent           (mA, reportable)
+ *   0x050B  ActivePower          (W, estimated with CURRENT_SENSE_POWER_FACTOR_PCT)
+ *   0x050F  ApparentPower        (VA, reportable)
+ *   0x0600..0x0605               AC multipliers and divisors
+ *   0xF000  Current alarms       (bitmap8, manufacturer-specific, reportable,
+ *                                 see current_sense_alarm_t)
+ *
+ * Metering cluster (0x0702):
+ *   0x0000  CurrentSummationDelivered  (Wh, reportable, kept in NVS)
+ *   0x0400  InstantaneousDemand        (W, reportable)
+ *   with UnitOfMeasure kWh, Multiplier 1, Divisor 1000
+ *
+ * The alarms compare the current with the relay state once the relay has
+ * been stable for CURRENT_SENSE_ALARM_GRACE_MS: no current while ON means a
+ * blocked or disconnected fan (or a failed relay contact), current while
+ * OFF means a welded contact.
+ *
+ * Disabled by default, since the sensor is optional hardware. Build with
+ * CURRENT_SENSE_ENABLE=1 to compile the measurement and the two clusters in;
+ * otherwise current_sense_init() does nothing.
+ */
+
+#ifndef CURRENT_SENSE_H
+#define CURRENT_SENSE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "zb_endpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Compile the current measurement in (1) or out (0) */
+#ifndef CURRENT_SENSE_ENABLE
+#define CURRENT_SENSE_ENABLE                0
+#endif
+
+/** @brief Default sensor input (hardware profile), must be an ADC1 pin (GPIO0..6 on the ESP32-C6) */
+#ifndef CURRENT_SENSE_GPIO_PIN
+#define CURRENT_SENSE_GPIO_PIN              3
+#endif
+
+/** @brief Mains frequency in Hz (50 or 60) */
+#ifndef CURRENT_SENSE_MAINS_HZ
+#define CURRENT_SENSE_MAINS_HZ              50
+#endif
+
+/** @brief Nominal mains voltage in V, used for power and energy */
+#ifndef CURRENT_SENSE_MAINS_V
+#define CURRENT_SENSE_MAINS_V               230
+#endif
+
+/** @brief Sensor scale in mA of primary current per V at the ADC pin (SCT-013-030: 30 A/V) */
+#ifndef CURRENT_SENSE_MA_PER_V
+#define CURRENT_SENSE_MA_PER_V              30000
+#endif
+
+/** @brief Power factor of the fan in percent, for the active power estimate */
+#ifndef CURRENT_SENSE_POWER_FACTOR_PCT
+#define CURRENT_SENSE_POWER_FACTOR_PCT      100
+#endif
+
+/**
+ * @brief RMS noise of the input with no current, in mA
+ *
+ * Subtracted in quadrature, so an idle input reads 0 mA. Measure with the
+ * relay OFF (RMSCurrent) and set it slightly above the reading.
+ */
+#ifndef CURRENT_SENSE_NOISE_MA
+#define CURRENT_SENSE_NOISE_MA              0
+#endif
+
+/** @brief Below this current the fan counts as not running */
+#ifndef CURRENT_SENSE_MIN_ON_MA
+#define CURRENT_SENSE_MIN_ON_MA             50
+#endif
+
+/** @brief Above this current the relay counts as conducting */
+#ifndef CURRENT_SENSE_MAX_OFF_MA
+#define CURRENT_SENSE_MAX_OFF_MA            50
+#endif
+
+/** @brief Mains periods per block */
+#define CURRENT_SENSE_BLOCK_PERIODS         10
+
+/** @brief Samples per mains period */
+#define CURRENT_SENSE_SAMPLES_PER_PERIOD    100
+
+#define CURRENT_SENSE_SAMPLE_HZ             (CURRENT_SENSE_MAINS_HZ * CURRENT_SENSE_SAMPLES_PER_PERIOD)
+#define CURRENT_SENSE_BLOCK_SAMPLES         (CURRENT_SENSE_BLOCK_PERIODS * CURRENT_SENSE_SAMPLES_PER_PERIOD)
+#define CURRENT_SENSE_BLOCK_MS              (CURRENT_SENSE_BLOCK_PERIODS * 1000 / CURRENT_SENSE_MAINS_HZ)
+
+/** @brief Attribute update interval (a whole number of blocks) */
+#define CURRENT_SENSE_REPORT_MS             5000
+
+/** @brief Relay stable time before the alarms are evaluated (inrush, run-down) */
+#define CURRENT_SENSE_ALARM_GRACE_MS        5000
+
+/** @brief Minimum interval between energy writes to NVS */
+#define CURRENT_SENSE_SAVE_INTERVAL_MS      (30UL * 60UL * 1000UL)
+
+/** @brief NVS namespace and key of the energy counter */
+#define CURRENT_SENSE_NVS_NAMESPACE         "current"
+#define CURRENT_SENSE_NVS_KEY               "energy_mj"
+
+/** @brief Manufacturer-specific alarm attribute in the Electrical Measurement cluster */
+#define CURRENT_SENSE_ATTR_ALARMS_ID        0xF000
+
+#define CURRENT_SENSE_ELEC_ATTR_COUNT       12
+#define CURRENT_SENSE_METER_ATTR_COUNT      8
+
+/** @brief Blocks timed by current_sense_bench_kernel() in bench builds */
+#define CURRENT_SENSE_BENCH_BLOCKS          100
+
+/** @brief Attribute tables for zb_endpoint_add_clusters() */
+extern const zb_ep_attr_desc_t current_sense_elec_attrs[CURRENT_SENSE_ELEC_ATTR_COUNT];
+extern const zb_ep_attr_desc_t current_sense_meter_attrs[CURRENT_SENSE_METER_ATTR_COUNT];
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Bits of the alarm attribute
+ */
+typedef enum {
+    CURRENT_SENSE_ALARM_NO_CURRENT = 0x01,  /**< Relay ON, current below CURRENT_SENSE_MIN_ON_MA */
+    CURRENT_SENSE_ALARM_OFF_CURRENT = 0x02, /**< Relay OFF, current above CURRENT_SENSE_MAX_OFF_MA */
+} current_sense_alarm_t;
+
+/**
+ * @brief Measurement state and counters
+ */
+typedef struct {
+    uint32_t current_ma;        /**< Last report */
+    uint32_t active_power_w;    /**< Last report */
+    uint64_t energy_mj;         /**< Lifetime energy in millijoules */
+    uint8_t alarms;             /**< current_sense_alarm_t bits */
+    uint32_t blocks;            /**< Blocks measured */
+    uint32_t read_errors;       /**< Failed or timed out ADC reads */
+    uint32_t kernel_cycles;     /**< CPU cycles of the last block (accumulate + RMS) */
+} current_sense_stats_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Load the energy counter and start the ADC and the measurement task
+ *
+ * Call after nvs_flash_init() and relay_init(), before zigbee_handler_init()
+ * so the Metering summation starts with the stored value.
+ *
+ * @return ESP_OK on success (also when compiled out), error code otherwise
+ */
+esp_err_t current_sense_init(void);
+
+/**
+ * @brief Get a copy of the measurement state
+ *
+ * @param[out] stats Destination (zeroed when compiled out)
+ */
+void current_sense_get_stats(current_sense_stats_t *stats);
+
+/**
+ * @brief Time the block kernel on a synthetic 50 Hz signal
+ *
+ * @param blocks Number of blocks
+ * @return Average CPU cycles per block, 0 if out of memory or compiled out
+ */
+uint32_t current_sense_bench_kernel(uint32_t blocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CURRENT_SENSE_H */
@@ -0,0 +1,182 @@
+/**
+ * @file diagnostics.c
+ * @brief Zigbee Diagnostics cluster implementation
+ *
+ * All hooks are called from the Zigbee task, so the counters need no locking
+ * against each other. Readers in other tasks get a consistent copy through a
+ * short critical section.
+ */
+
+#include "diagnostics.h"
+#include "zigbee_handler.h"
+#include "freertos/FreeRTOS.h"
+#define APP_LOG_MODULE_LEVEL    DIAG_LOG_LEVEL
+#include "app_log.h"
+#include <string.h>
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "DIAG";
+
+/** First broadcast short address (0xFFF8..0xFFFF) */
+#define ZB_BROADCAST_ADDR_MIN               0xFFF8
+
+/** Live counters, updated by the hooks */
+static diagnostics_counters_t s_counters;
+
+/** Values last written into the cluster */
+static diagnostics_counters_t s_published;
+
+static portMUX_TYPE s_counters_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* -----------------------------------------------------------------------------
+ * ZCL attribute defaults (flash-resident)
+ * ----------------------------------------------------------------------------- */
+
+static const uint32_t s_zero_u32 = 0;
+static const uint16_t s_zero_u16 = 0;
+static const uint8_t s_zero_u8 = 0;
+static const int8_t s_zero_s8 = 0;
+
+const zb_ep_attr_desc_t diagnostics_zcl_attrs[DIAGNOSTICS_ZCL_ATTR_COUNT] = {
+    { DIAG_ATTR_APS_RX_BCAST_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u16 },
+    { DIAG_ATTR_APS_RX_UCAST_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u16 },
+    { DIAG_ATTR_LAST_LQI_ID, ESP_ZB_ZCL_ATTR_TYPE_U8, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u8 },
+    { DIAG_ATTR_LAST_RSSI_ID, ESP_ZB_ZCL_ATTR_TYPE_S8, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_s8 },
+    { DIAG_ATTR_PARENT_CHANGES_ID, ESP_ZB_ZCL_ATTR_TYPE_U16,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_MANUF_SPEC, &s_zero_u16 },
+    { DIAG_ATTR_STEERING_ATTEMPTS_ID, ESP_ZB_ZCL_ATTR_TYPE_U16,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_MANUF_SPEC, &s_zero_u16 },
+    { DIAG_ATTR_PARENT_LOSSES_ID, ESP_ZB_ZCL_ATTR_TYPE_U16,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_MANUF_SPEC, &s_zero_u16 },
+    { DIAG_ATTR_PARENT_DETECT_MS_ID, ESP_ZB_ZCL_ATTR_TYPE_U32,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_MANUF_SPEC, &s_zero_u32 },
+    { DIAG_ATTR_PARENT_RECOVERY_MS_ID, ESP_ZB_ZCL_ATTR_TYPE_U32,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_MANUF_SPEC, &s_zero_u32 },
+};
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void diagnostics_set_attr(uint16_t attr_id, void *value);
+static void diagnostics_sync_cb(uint8_t param);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static void diagnostics_set_attr(uint16_t attr_id, void *value)
+{
+    esp_zb_zcl_status_t status;
+
+    if (attr_id >= ZB_EP_MANUF_ATTR_ID_MIN) {
+        status = esp_zb_zcl_set_manufacturer_attribute_val(
+            ZIGBEE_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+            ZB_EP_MANUF_CODE, attr_id, value, false);
+    } else {
+        status = esp_zb_zcl_set_attribute_val(
+            ZIGBEE_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+            attr_id, value, false);
+    }
+
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        APP_LOGW("Failed to set attribute 0x%04x, status: 0x%x", attr_id, status);
+    }
+}
+
+/** Write a counter into the cluster if it differs from the published value */
+#define DIAG_SYNC_FIELD(field, attr_id)                         \
+    do {                                                        \
+        if (now.field != s_published.field) {                   \
+            diagnostics_set_attr((attr_id), &now.field);        \
+            s_published.field = now.field;                      \
+        }                                                       \
+    } while (0)
+
+/**
+ * @brief Copy changed counters into the cluster, runs in the Zigbee task
+ */
+static void diagnostics_sync_cb(uint8_t param)
+{
+    (void)param;
+    diagnostics_counters_t now;
+
+    diagnostics_get(&now);
+
+    DIAG_SYNC_FIELD(aps_rx_bcast, DIAG_ATTR_APS_RX_BCAST_ID);
+    DIAG_SYNC_FIELD(aps_rx_ucast, DIAG_ATTR_APS_RX_UCAST_ID);
+    DIAG_SYNC_FIELD(last_lqi, DIAG_ATTR_LAST_LQI_ID);
+    DIAG_SYNC_FIELD(last_rssi, DIAG_ATTR_LAST_RSSI_ID);
+    DIAG_SYNC_FIELD(parent_changes, DIAG_ATTR_PARENT_CHANGES_ID);
+    DIAG_SYNC_FIELD(steering_attempts, DIAG_ATTR_STEERING_ATTEMPTS_ID);
+    DIAG_SYNC_FIELD(parent_losses, DIAG_ATTR_PARENT_LOSSES_ID);
+    DIAG_SYNC_FIELD(parent_detect_ms, DIAG_ATTR_PARENT_DETECT_MS_ID);
+    DIAG_SYNC_FIELD(parent_recovery_ms, DIAG_ATTR_PARENT_RECOVERY_MS_ID);
+
+    esp_zb_scheduler_alarm(diagnostics_sync_cb, 0, DIAGNOSTICS_SYNC_INTERVAL_MS);
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+void diagnostics_start(void)
+{
+    memset(&s_published, 0, sizeof(s_published));
+    esp_zb_scheduler_alarm(diagnostics_sync_cb, 0, DIAGNOSTICS_SYNC_INTERVAL_MS);
+}
+
+void diagnostics_on_aps_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    bool bcast = ind->dst_addr_mode == ESP_ZB_APS_ADDR_MODE_16_GROUP_ENDP_NOT_PRESENT ||
+                 ind->dst_short_addr >= ZB_BROADCAST_ADDR_MIN;
+
+    portENTER_CRITICAL(&s_counters_lock);
+    if (bcast) {
+        s_counters.aps_rx_bcast++;
+    } else {
+        s_counters.aps_rx_ucast++;
+    }
+    s_counters.last_lqi = ind->lqi;
+    s_counters.last_rssi = ind->rssi;
+    portEXIT_CRITICAL(&s_counters_lock);
+}
+
+void diagnostics_count_steering_attempt(void)
+{
+    portENTER_CRITICAL(&s_counters_lock);
+    s_counters.steering_attempts++;
+    portEXIT_CRITICAL(&s_counters_lock);
+}
+
+void diagnostics_count_parent_change(void)
+{
+    portENTER_CRITICAL(&s_counters_lock);
+    s_counters.parent_changes++;
+    portEXIT_CRITICAL(&s_counters_lock);
+}
+
+void diagnostics_count_parent_loss(uint32_t detect_ms)
+{
+    portENTER_CRITICAL(&s_counters_lock);
+    s_counters.parent_losses++;
+    s_counters.parent_detect_ms = detect_ms;
+    portEXIT_CRITICAL(&s_counters_lock);
+}
+
+void diagnostics_set_parent_recovery(uint32_t recovery_ms)
+{
+    portENTER_CRITICAL(&s_counters_lock);
+    s_counters.parent_recovery_ms = recovery_ms;
+    portEXIT_CRITICAL(&s_counters_lock);
+}
+
+void diagnostics_get(diagnostics_counters_t *counters)
+{
+    portENTER_CRITICAL(&s_counters_lock);
+    *counters = s_counters;
+    portEXIT_CRITICAL(&s_counters_lock);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file diagnostics.h
+ * @brief Zigbee Diagnostics cluster (0x0B05) for ESP32-C6 Fan Switch
+ *
+ * Link-quality and traffic counters are incremented in RAM from the APS
+ * data indication hook and the ZDO signal handler, all in the Zigbee task. They are
+ * copied into the Diagnostics cluster attributes every
+ * DIAGNOSTICS_SYNC_INTERVAL_MS, and only when they changed, so counting
+ * itself never causes radio traffic.
+ *
+ * The application only sees received APS frames, so the traffic counters
+ * are the APS receive ones. The MAC counters (0x0100..0x0105) are not
+ * provided, and neither are the APS transmit counters nor CCA failures:
+ * the APS data confirm hook only reports frames the application sends
+ * with esp_zb_aps_data_request(), and the reports and responses of this
+ * firmware are sent by the stack.
+ *
+ * Standard attributes:
+ *   0x0106  APSRxBcast         (uint16)
+ *   0x0108  APSRxUcast         (uint16)
+ *   0x011C  LastMessageLQI     (uint8)
+ *   0x011D  LastMessageRSSI    (int8)
+ *
+ * Manufacturer-specific attributes (manufacturer code ZB_EP_MANUF_CODE):
+ *   0xF001  Parent (re)selections           (uint16)
+ *   0xF002  Network steering attempts       (uint16)
+ *   0xF003  Parent losses detected          (uint16)
+ *   0xF004  Last parent-loss detection time (uint32, ms from the last frame
+ *           exchanged with the parent to the detection)
+ *   0xF005  Last parent-loss recovery time  (uint32, ms from the detection
+ *           to joined again)
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdint.h>
+#include "esp_zigbee_core.h"
+#include "zb_endpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Interval for copying the counters into the ZCL attributes */
+#define DIAGNOSTICS_SYNC_INTERVAL_MS    30000
+
+/* Diagnostics cluster attribute IDs */
+#define DIAG_ATTR_APS_RX_BCAST_ID       0x0106
+#define DIAG_ATTR_APS_RX_UCAST_ID       0x0108
+#define DIAG_ATTR_LAST_LQI_ID           0x011C
+#define DIAG_ATTR_LAST_RSSI_ID          0x011D
+#define DIAG_ATTR_PARENT_CHANGES_ID     0xF001
+#define DIAG_ATTR_STEERING_ATTEMPTS_ID  0xF002
+#define DIAG_ATTR_PARENT_LOSSES_ID      0xF003
+#define DIAG_ATTR_PARENT_DETECT_MS_ID   0xF004
+#define DIAG_ATTR_PARENT_RECOVERY_MS_ID 0xF005
+
+/** @brief Number of attributes in diagnostics_zcl_attrs */
+#define DIAGNOSTICS_ZCL_ATTR_COUNT      9
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Snapshot of all link counters
+ */
+typedef struct {
+    uint16_t aps_rx_bcast;
+    uint16_t aps_rx_ucast;
+    uint16_t parent_changes;
+    uint16_t steering_attempts;
+    uint16_t parent_losses;
+    uint32_t parent_detect_ms;
+    uint32_t parent_recovery_ms;
+    uint8_t last_lqi;
+    int8_t last_rssi;
+} diagnostics_counters_t;
+
+/** Attribute table of the Diagnostics cluster (see zb_endpoint.h) */
+extern const zb_ep_attr_desc_t diagnostics_zcl_attrs[DIAGNOSTICS_ZCL_ATTR_COUNT];
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Start periodic synchronization of the counters into the cluster
+ *
+ * Must be called from the Zigbee task after the stack has been started.
+ */
+void diagnostics_start(void);
+
+/**
+ * @brief Account for a received APS data frame
+ *
+ * @param ind APS data indication from the stack
+ */
+void diagnostics_on_aps_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/** @brief Count a network steering attempt */
+void diagnostics_count_steering_attempt(void);
+
+/** @brief Count a (re)join, i.e. a new parent selection */
+void diagnostics_count_parent_change(void);
+
+/**
+ * @brief Count a detected parent loss
+ *
+ * @param detect_ms Time from the last frame exchanged with the parent
+ */
+void diagnostics_count_parent_loss(uint32_t detect_ms);
+
+/**
+ * @brief Record the recovery from a parent loss
+ *
+ * @param recovery_ms Time from the detection to joined again
+ */
+void diagnostics_set_parent_recovery(uint32_t recovery_ms);
+
+/**
+ * @brief Get a copy of all counters
+ *
+ * @param[out] counters Counters to fill
+ */
+void diagnostics_get(diagnostics_counters_t *counters);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIAGNOSTICS_H */
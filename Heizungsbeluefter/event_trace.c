@@ -0,0 +1,153 @@
+/**
+ * @file event_trace.c
+ * @brief Crash-safe binary event trace implementation
+ */
+
+#include "event_trace.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#define APP_LOG_MODULE_LEVEL    TRACE_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "TRACE";
+
+#define EVENT_TRACE_MAGIC   0x45565431UL    /* "EVT1" */
+#define EVENT_TRACE_MASK    (EVENT_TRACE_SIZE - 1)
+
+_Static_assert((EVENT_TRACE_SIZE & EVENT_TRACE_MASK) == 0, "EVENT_TRACE_SIZE must be a power of two");
+
+/**
+ * @brief Trace storage, survives everything but a power-on reset
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t boot_count;
+    uint16_t head;          /* Next slot to write */
+    uint16_t count;         /* Valid events */
+    uint16_t check;         /* ~head, detects a torn header */
+    event_trace_entry_t entries[EVENT_TRACE_SIZE];
+} event_trace_store_t;
+
+static RTC_NOINIT_ATTR event_trace_store_t s_trace;
+
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** Printable event type names, indexed by event_type_t */
+static const char *const s_type_names[] = {
+    [EVT_RESET] = "RESET",
+    [EVT_ZDO_SIGNAL] = "ZDO_SIGNAL",
+    [EVT_ZCL_ATTR] = "ZCL_ATTR",
+    [EVT_RELAY] = "RELAY",
+    [EVT_BUTTON] = "BUTTON",
+    [EVT_NETWORK] = "NETWORK",
+};
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static bool event_trace_valid(void)
+{
+    return s_trace.magic == EVENT_TRACE_MAGIC &&
+           s_trace.head < EVENT_TRACE_SIZE &&
+           s_trace.count <= EVENT_TRACE_SIZE &&
+           (uint16_t)(s_trace.check ^ s_trace.head) == 0xFFFF;
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+void event_trace_init(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    if (reason == ESP_RST_POWERON || !event_trace_valid()) {
+        s_trace.magic = EVENT_TRACE_MAGIC;
+        s_trace.boot_count = 0;
+        s_trace.head = 0;
+        s_trace.count = 0;
+        s_trace.check = (uint16_t)(s_trace.head ^ 0xFFFF);
+        APP_LOGI("Event trace started (%d events)", EVENT_TRACE_SIZE);
+    } else {
+        APP_LOGI("Event trace kept across reset: %u events, boot %u",
+                 s_trace.count, s_trace.boot_count);
+        if (reason != ESP_RST_SW && reason != ESP_RST_DEEPSLEEP) {
+            APP_LOGW("Abnormal reset (reason %d), previous trace follows", reason);
+            event_trace_dump();
+        }
+    }
+
+    s_trace.boot_count++;
+    event_trace_log(EVT_RESET, (uint8_t)reason, s_trace.boot_count);
+}
+
+void IRAM_ATTR event_trace_log(event_type_t type, uint8_t arg8, uint16_t arg16)
+{
+    uint32_t now = esp_log_timestamp();
+
+    portENTER_CRITICAL_SAFE(&s_trace_lock);
+    uint16_t i = s_trace.head;
+    event_trace_entry_t *entry = &s_trace.entries[i];
+    entry->timestamp_ms = now;
+    entry->type = (uint8_t)type;
+    entry->arg8 = arg8;
+    entry->arg16 = arg16;
+    i = (i + 1) & EVENT_TRACE_MASK;
+    s_trace.head = i;
+    s_trace.check = (uint16_t)(i ^ 0xFFFF);
+    if (s_trace.count < EVENT_TRACE_SIZE) {
+        s_trace.count++;
+    }
+    portEXIT_CRITICAL_SAFE(&s_trace_lock);
+}
+
+size_t event_trace_copy_recent(event_trace_entry_t *entries, size_t max_entries)
+{
+    portENTER_CRITICAL(&s_trace_lock);
+    size_t count = s_trace.count < max_entries ? s_trace.count : max_entries;
+    uint16_t first = (s_trace.head - count) & EVENT_TRACE_MASK;
+    for (size_t n = 0; n < count; n++) {
+        entries[n] = s_trace.entries[(first + n) & EVENT_TRACE_MASK];
+    }
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    return count;
+}
+
+const char *event_trace_type_name(uint8_t type)
+{
+    if (type < sizeof(s_type_names) / sizeof(s_type_names[0]) && s_type_names[type]) {
+        return s_type_names[type];
+    }
+    return "?";
+}
+
+void event_trace_dump(void)
+{
+    event_trace_entry_t entry;
+    uint16_t count = s_trace.count;
+    uint16_t first = (s_trace.head - count) & EVENT_TRACE_MASK;
+
+    ESP_LOGI(TAG, "---- event trace: %u events ----", count);
+    for (uint16_t n = 0; n < count; n++) {
+        portENTER_CRITICAL(&s_trace_lock);
+        entry = s_trace.entries[(first + n) & EVENT_TRACE_MASK];
+        portEXIT_CRITICAL(&s_trace_lock);
+
+        ESP_LOGI(TAG, "%10lu ms  %-10s  arg8=0x%02x  arg16=0x%04x",
+                 (unsigned long)entry.timestamp_ms, event_trace_type_name(entry.type),
+                 entry.arg8, entry.arg16);
+    }
+    ESP_LOGI(TAG, "---- end of event trace ----");
+}
+
+uint16_t event_trace_boot_count(void)
+{
+    return s_trace.boot_count;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file event_trace.h
+ * @brief Crash-safe binary event trace for ESP32-C6 Zigbee Fan Switch
+ *
+ * A compact ring of 8-byte events kept in RTC no-init memory. The ring is
+ * not cleared by software resets, watchdog resets or panics, so after such a
+ * reset the history leading up to it is still available. A power-on reset
+ * (or a corrupted header) starts a fresh trace.
+ *
+ * Writing an event is a handful of stores inside a short critical section
+ * and is safe from tasks and ISRs, so the trace stays enabled in production.
+ *
+ * Reading:
+ *   - event_trace_dump() prints the trace to the log (done automatically at
+ *     boot when the previous run ended in an abnormal reset)
+ *   - event_trace_copy_recent() returns the newest events in wire format,
+ *     used for the Telemetry cluster attribute 0x0007
+ */
+
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Number of events kept (power of two) */
+#define EVENT_TRACE_SIZE        128
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Event types
+ *
+ * Values are stored in the trace, so only append new types.
+ */
+typedef enum {
+    EVT_RESET = 1,          /**< arg8 = esp_reset_reason_t, arg16 = boot count */
+    EVT_ZDO_SIGNAL = 2,     /**< arg8 = signal type, arg16 = esp_err_t status (low 16 bits) */
+    EVT_ZCL_ATTR = 3,       /**< arg8 = first value byte, arg16 = cluster ID */
+    EVT_RELAY = 4,          /**< arg8 = new state, arg16 = 0 */
+    EVT_BUTTON = 5,         /**< arg8 = button_action_t, arg16 = press duration in 10 ms units */
+    EVT_NETWORK = 6,        /**< arg8 = new network_state_t, arg16 = 0 */
+} event_type_t;
+
+/**
+ * @brief One trace event (8 bytes)
+ */
+typedef struct {
+    uint32_t timestamp_ms;  /**< Milliseconds since boot */
+    uint8_t type;           /**< event_type_t */
+    uint8_t arg8;           /**< Type-specific argument */
+    uint16_t arg16;         /**< Type-specific argument */
+} event_trace_entry_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Validate the trace after a reset and record the reset
+ *
+ * Call as early as possible in setup(). Dumps the previous trace to the log
+ * if the reset was not a regular power-on.
+ */
+void event_trace_init(void);
+
+/**
+ * @brief Append an event (task and ISR safe)
+ *
+ * @param type Event type
+ * @param arg8 8-bit argument
+ * @param arg16 16-bit argument
+ */
+void event_trace_log(event_type_t type, uint8_t arg8, uint16_t arg16);
+
+/**
+ * @brief Copy the newest events, oldest first
+ *
+ * @param[out] entries Destination array
+ * @param max_entries Capacity of entries
+ * @return Number of events copied
+ */
+size_t event_trace_copy_recent(event_trace_entry_t *entries, size_t max_entries);
+
+/**
+ * @brief Printable name of an event type ("?" if unknown)
+ */
+const char *event_trace_type_name(uint8_t type);
+
+/**
+ * @brief Print the whole trace to the log
+ */
+void event_trace_dump(void);
+
+/**
+ * @brief Get the boot count stored alongside the trace
+ *
+ * @return Number of boots since the trace was last cleared
+ */
+uint16_t event_trace_boot_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_TRACE_H */
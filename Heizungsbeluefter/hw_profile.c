@@ -0,0 +1,265 @@
+/**
+ * @file hw_profile.c
+ * @brief Board description implementation
+ *
+ * The active profile is fixed after hw_profile_init(). Profile writes arrive
+ * as APP_EVENT_ZB_ATTR_WRITTEN in the Zigbee task; hw_profile_store() may
+ * also be called from other tasks and takes the Zigbee lock for the
+ * attributes.
+ */
+
+#include "hw_profile.h"
+#include "relay.h"
+#include "button.h"
+#include "status_led.h"
+#include "current_sense.h"
+#include "app_event.h"
+#include "zigbee_handler.h"
+#include "zcl_codec.h"
+#include "driver/gpio.h"
+#include "esp_check.h"
+#include "nvs.h"
+#include <string.h>
+#define APP_LOG_MODULE_LEVEL    HW_PROFILE_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "HW";
+
+_Static_assert(sizeof(hw_profile_t) == 10, "hardware profile layout is part of the ZCL format");
+
+/** Compile-time board, used while nothing valid is stored */
+static const hw_profile_t s_default_profile = {
+    .version = HW_PROFILE_VERSION,
+    .output_count = 1,
+    .output_pins = { RELAY_DEFAULT_GPIO_PIN, HW_PROFILE_PIN_NONE },
+    .output_active_high = RELAY_DEFAULT_ACTIVE_LEVEL ? 0x01 : 0x00,
+    .button_pin = BUTTON_GPIO_PIN,
+    .button_active_level = BUTTON_ACTIVE_LEVEL,
+    .led_pin = STATUS_LED_GPIO_PIN,
+    .led_active_level = STATUS_LED_ACTIVE_LEVEL,
+#if CURRENT_SENSE_ENABLE
+    .current_pin = CURRENT_SENSE_GPIO_PIN,
+#else
+    .current_pin = HW_PROFILE_PIN_NONE,
+#endif
+};
+
+static hw_profile_t s_profile;
+static hw_profile_source_t s_source = HW_PROFILE_SOURCE_DEFAULT;
+
+/** Attribute start values, set before the endpoint is created */
+static uint8_t s_attr_profile[1 + sizeof(hw_profile_t)] = { sizeof(hw_profile_t) };
+static uint8_t s_attr_source = HW_PROFILE_SOURCE_DEFAULT;
+static const bool s_attr_pending = false;
+
+const zb_ep_attr_desc_t hw_profile_zcl_attrs[HW_PROFILE_ZCL_ATTR_COUNT] = {
+    { HW_PROFILE_ATTR_PROFILE_ID, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE,
+      s_attr_profile },
+    { HW_PROFILE_ATTR_SOURCE_ID, ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY,
+      &s_attr_source },
+    { HW_PROFILE_ATTR_PENDING_ID, ESP_ZB_ZCL_ATTR_TYPE_BOOL, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY,
+      &s_attr_pending },
+};
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static bool hw_profile_check_pin(uint8_t pin, bool output, uint32_t *used, const char *what);
+static void hw_profile_set_attr(uint16_t attr_id, void *value);
+static void hw_profile_on_attr_written(const app_event_t *event, void *ctx);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/** Check one pin and claim it in @p used */
+static bool hw_profile_check_pin(uint8_t pin, bool output, uint32_t *used, const char *what)
+{
+    if (pin >= 32 || (output ? !GPIO_IS_VALID_OUTPUT_GPIO(pin) : !GPIO_IS_VALID_GPIO(pin))) {
+        APP_LOGW("%s: GPIO%u does not exist or cannot drive", what, pin);
+        return false;
+    }
+    if (HW_PROFILE_RESERVED_PINS & (1UL << pin)) {
+        APP_LOGW("%s: GPIO%u is reserved (USB or flash)", what, pin);
+        return false;
+    }
+    if (*used & (1UL << pin)) {
+        APP_LOGW("%s: GPIO%u is used twice", what, pin);
+        return false;
+    }
+    *used |= 1UL << pin;
+    return true;
+}
+
+static void hw_profile_set_attr(uint16_t attr_id, void *value)
+{
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(
+        ZIGBEE_ENDPOINT, HW_PROFILE_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        attr_id, value, false);
+
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        APP_LOGW("Failed to set attribute 0x%04x, status: 0x%x", attr_id, status);
+    }
+}
+
+/**
+ * @brief Store a written profile or restore the attribute (Zigbee task)
+ */
+static void hw_profile_on_attr_written(const app_event_t *event, void *ctx)
+{
+    (void)ctx;
+
+    if (event->zcl.cluster != HW_PROFILE_CLUSTER_ID ||
+        event->zcl.attr_id != HW_PROFILE_ATTR_PROFILE_ID || !event->zcl.value) {
+        return;
+    }
+
+    const uint8_t *data;
+    uint16_t len;
+    hw_profile_t profile;
+    esp_err_t ret = zcl_codec_read_string(event->zcl.attr_type, event->zcl.value, &data, &len);
+
+    if (ret == ESP_OK && len != sizeof(profile)) {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    if (ret == ESP_OK) {
+        memcpy(&profile, data, sizeof(profile));
+        ret = hw_profile_store(&profile);
+    }
+    if (ret != ESP_OK) {
+        APP_LOGW("Profile write rejected: %s", esp_err_to_name(ret));
+        /* Show the active profile again */
+        hw_profile_set_attr(HW_PROFILE_ATTR_PROFILE_ID, s_attr_profile);
+    }
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t hw_profile_init(void)
+{
+    nvs_handle_t handle;
+    hw_profile_t stored;
+    size_t size = sizeof(stored);
+
+    s_profile = s_default_profile;
+    s_source = HW_PROFILE_SOURCE_DEFAULT;
+
+    esp_err_t ret = nvs_open(HW_PROFILE_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, HW_PROFILE_NVS_KEY, &stored, &size);
+        nvs_close(handle);
+    }
+
+    if (ret == ESP_OK) {
+        if (size == sizeof(stored) && hw_profile_validate(&stored) == ESP_OK) {
+            s_profile = stored;
+            s_source = HW_PROFILE_SOURCE_NVS;
+        } else {
+            APP_LOGE("Stored hardware profile is invalid, using the defaults");
+            s_source = HW_PROFILE_SOURCE_INVALID;
+        }
+    } else if (hw_profile_validate(&s_default_profile) != ESP_OK) {
+        /* A build error, not a board error: the defaults must be usable */
+        APP_LOGE("Default hardware profile is invalid, check the *_GPIO_PIN settings");
+    }
+
+    memcpy(&s_attr_profile[1], &s_profile, sizeof(s_profile));
+    s_attr_source = (uint8_t)s_source;
+
+    APP_LOGI("Hardware profile (%s): %u output(s) GPIO%u/%u, button GPIO%u, LED GPIO%u, current GPIO%u",
+             s_source == HW_PROFILE_SOURCE_NVS ? "stored" : "default",
+             s_profile.output_count, s_profile.output_pins[0], s_profile.output_pins[1],
+             s_profile.button_pin, s_profile.led_pin, s_profile.current_pin);
+
+    return app_event_subscribe(APP_EVENT_MASK(APP_EVENT_ZB_ATTR_WRITTEN), hw_profile_on_attr_written, NULL);
+}
+
+const hw_profile_t *hw_profile_get(void)
+{
+    return &s_profile;
+}
+
+hw_profile_source_t hw_profile_source(void)
+{
+    return s_source;
+}
+
+esp_err_t hw_profile_validate(const hw_profile_t *profile)
+{
+    uint32_t used = 0;
+
+    if (!profile || profile->version != HW_PROFILE_VERSION) {
+        APP_LOGW("Unknown profile version");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (profile->output_count < 1 || profile->output_count > HW_PROFILE_MAX_OUTPUTS) {
+        APP_LOGW("Output count %u out of range", profile->output_count);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t i = 0; i < profile->output_count; i++) {
+        if (!hw_profile_check_pin(profile->output_pins[i], true, &used, "Output")) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (profile->button_active_level > 1 || profile->led_active_level > 1) {
+        APP_LOGW("Active levels must be 0 or 1");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (profile->button_pin != HW_PROFILE_PIN_NONE &&
+        !hw_profile_check_pin(profile->button_pin, false, &used, "Button")) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (profile->led_pin != HW_PROFILE_PIN_NONE &&
+        !hw_profile_check_pin(profile->led_pin, true, &used, "LED")) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (profile->current_pin != HW_PROFILE_PIN_NONE) {
+        if (profile->current_pin > HW_PROFILE_ADC_PIN_MAX) {
+            APP_LOGW("Current sensor: GPIO%u is not an ADC1 pin", profile->current_pin);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (!hw_profile_check_pin(profile->current_pin, false, &used, "Current sensor")) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t hw_profile_store(const hw_profile_t *profile)
+{
+    nvs_handle_t handle;
+
+    ESP_RETURN_ON_ERROR(hw_profile_validate(profile), TAG, "Profile not stored");
+
+    esp_err_t ret = nvs_open(HW_PROFILE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, HW_PROFILE_NVS_KEY, profile, sizeof(*profile));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        APP_LOGW("Failed to store profile: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    bool pending = memcmp(profile, &s_profile, sizeof(*profile)) != 0;
+    uint8_t attr_profile[1 + sizeof(hw_profile_t)];
+    zcl_codec_write_octets(attr_profile, sizeof(attr_profile), profile, sizeof(*profile));
+
+    bool locked = zigbee_handler_lock();
+    hw_profile_set_attr(HW_PROFILE_ATTR_PROFILE_ID, attr_profile);
+    hw_profile_set_attr(HW_PROFILE_ATTR_PENDING_ID, &pending);
+    zigbee_handler_unlock(locked);
+
+    APP_LOGI("Hardware profile stored%s", pending ? ", restart to apply" : "");
+    return ESP_OK;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file hw_profile.h
+ * @brief Board description for ESP32-C6 Zigbee Fan Switch
+ *
+ * One firmware image serves several relay boards: pins and polarities of
+ * the relay outputs, the button, the status LED and the current sensor are
+ * a hardware profile record in NVS instead of compile-time constants. The
+ * compile-time values (RELAY_DEFAULT_GPIO_PIN, BUTTON_GPIO_PIN, ...) are
+ * only the defaults used while no valid profile is stored.
+ *
+ * The profile is loaded and validated once at boot, before any driver is
+ * set up; modules resolve it once in their init (the relay into GPIO
+ * set/clear masks), so nothing on the switching path looks at it again.
+ * A new profile takes effect after a restart.
+ *
+ * Manufacturer-specific Hardware Profile cluster (HW_PROFILE_CLUSTER_ID):
+ *   0x0000  Profile   (octet string, read/write, hw_profile_t; an invalid
+ *                      write is rejected and the active profile written back)
+ *   0x0001  Source    (enum8, read-only, hw_profile_source_t)
+ *   0x0002  Pending   (bool, read-only, stored profile differs from the
+ *                      active one until the next restart)
+ */
+
+#ifndef HW_PROFILE_H
+#define HW_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "zb_endpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Manufacturer-specific Hardware Profile cluster ID */
+#define HW_PROFILE_CLUSTER_ID           0xFC13
+
+/* Hardware Profile cluster attribute IDs */
+#define HW_PROFILE_ATTR_PROFILE_ID      0x0000
+#define HW_PROFILE_ATTR_SOURCE_ID       0x0001
+#define HW_PROFILE_ATTR_PENDING_ID      0x0002
+
+#define HW_PROFILE_ZCL_ATTR_COUNT       3
+
+/** @brief Layout version, first byte of the record */
+#define HW_PROFILE_VERSION              1
+
+/** @brief Relay outputs switched together */
+#define HW_PROFILE_MAX_OUTPUTS          2
+
+/** @brief Pin value for "not fitted" */
+#define HW_PROFILE_PIN_NONE             0xFF
+
+/**
+ * @brief Pins never accepted: USB D-/D+ (GPIO12/13, serial console) and
+ *        the SPI flash (GPIO24..30)
+ */
+#define HW_PROFILE_RESERVED_PINS        ((1UL << 12) | (1UL << 13) | (0x7FUL << 24))
+
+/** @brief Highest ADC1 pin of the ESP32-C6 (ADC1 channels are GPIO0..6) */
+#define HW_PROFILE_ADC_PIN_MAX          6
+
+/** @brief NVS namespace and key of the stored profile */
+#define HW_PROFILE_NVS_NAMESPACE        "hw"
+#define HW_PROFILE_NVS_KEY              "profile"
+
+/** @brief Attribute table for zb_endpoint_add_clusters() */
+extern const zb_ep_attr_desc_t hw_profile_zcl_attrs[HW_PROFILE_ZCL_ATTR_COUNT];
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Hardware profile (same layout in NVS and in the Profile attribute)
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;                            /**< HW_PROFILE_VERSION */
+    uint8_t output_count;                       /**< 1 .. HW_PROFILE_MAX_OUTPUTS */
+    uint8_t output_pins[HW_PROFILE_MAX_OUTPUTS];
+    uint8_t output_active_high;                 /**< Bit n = output n is active high */
+    uint8_t button_pin;                         /**< HW_PROFILE_PIN_NONE = no button */
+    uint8_t button_active_level;
+    uint8_t led_pin;                            /**< HW_PROFILE_PIN_NONE = no status LED */
+    uint8_t led_active_level;
+    uint8_t current_pin;                        /**< ADC1 pin, HW_PROFILE_PIN_NONE = no sensor */
+} hw_profile_t;
+
+/**
+ * @brief Where the active profile came from
+ */
+typedef enum {
+    HW_PROFILE_SOURCE_DEFAULT = 0,  /**< None stored, compile-time defaults */
+    HW_PROFILE_SOURCE_NVS,          /**< Stored profile */
+    HW_PROFILE_SOURCE_INVALID,      /**< Stored profile rejected, defaults used */
+} hw_profile_source_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Load and validate the stored profile
+ *
+ * Call after nvs_flash_init() and before relay_init() and the other drivers.
+ * Falls back to the compile-time defaults if nothing valid is stored.
+ *
+ * @return ESP_OK (the fallback is not an error)
+ */
+esp_err_t hw_profile_init(void);
+
+/**
+ * @brief Active profile
+ */
+const hw_profile_t *hw_profile_get(void);
+
+/**
+ * @brief Source of the active profile
+ */
+hw_profile_source_t hw_profile_source(void);
+
+/**
+ * @brief Check a profile against the pin rules of the ESP32-C6
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG (the reason is logged)
+ */
+esp_err_t hw_profile_validate(const hw_profile_t *profile);
+
+/**
+ * @brief Validate and store a profile, active after the next restart
+ *
+ * Used by the Profile attribute and available to a serial console.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or an NVS error
+ */
+esp_err_t hw_profile_store(const hw_profile_t *profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HW_PROFILE_H */
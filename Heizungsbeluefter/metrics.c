@@ -0,0 +1,346 @@
+/**
+ * @file metrics.c
+ * @brief Metrics registry implementation
+ *
+ * Each metric is one word (a histogram one word per bucket), updated with a
+ * relaxed atomic operation. Nothing orders the words against each other;
+ * readers only need each word to be read whole.
+ */
+
+#include "metrics.h"
+#include "zigbee_handler.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_zigbee_core.h"
+#include <string.h>
+#define APP_LOG_MODULE_LEVEL    METRICS_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "METRICS";
+
+/** Value recorded by metrics_bench(), any in-range value costs the same */
+#define METRICS_BENCH_VALUE     1000
+
+#define METRICS_NAME(id, name)  name,
+
+static const char *const s_counter_names[METRIC_COUNTER_COUNT] = { METRICS_COUNTERS(METRICS_NAME) };
+static const char *const s_gauge_names[METRIC_GAUGE_COUNT] = { METRICS_GAUGES(METRICS_NAME) };
+static const char *const s_hist_names[METRIC_HIST_COUNT] = { METRICS_HISTOGRAMS(METRICS_NAME) };
+
+/** Percentiles of METRICS_HIST_FIELD_P50..P99 */
+static const uint8_t s_percentiles[] = { 50, 90, 99 };
+
+/* Updated from any context, atomically */
+static uint32_t s_counters[METRIC_COUNTER_COUNT];
+static uint32_t s_gauges[METRIC_GAUGE_COUNT];
+static uint32_t s_buckets[METRIC_HIST_COUNT][METRICS_HIST_BUCKETS];
+
+/* Zigbee task only: values last written into the cluster */
+static metrics_snapshot_t s_published;
+
+/* -----------------------------------------------------------------------------
+ * ZCL attribute defaults (flash-resident)
+ * ----------------------------------------------------------------------------- */
+
+static const uint32_t s_zero_u32 = 0;
+
+#define METRICS_ATTR(attr_id) \
+    { (attr_id), ESP_ZB_ZCL_ATTR_TYPE_U32, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u32 },
+#define METRICS_COUNTER_ATTR(id, name)  METRICS_ATTR(METRICS_ATTR_COUNTER_ID(METRIC_##id))
+#define METRICS_GAUGE_ATTR(id, name)    METRICS_ATTR(METRICS_ATTR_GAUGE_ID(METRIC_##id))
+#define METRICS_HIST_ATTRS(id, name)                                        \
+    METRICS_ATTR(METRICS_ATTR_HIST_ID(METRIC_##id, METRICS_HIST_FIELD_COUNT)) \
+    METRICS_ATTR(METRICS_ATTR_HIST_ID(METRIC_##id, METRICS_HIST_FIELD_MEAN))  \
+    METRICS_ATTR(METRICS_ATTR_HIST_ID(METRIC_##id, METRICS_HIST_FIELD_P50))   \
+    METRICS_ATTR(METRICS_ATTR_HIST_ID(METRIC_##id, METRICS_HIST_FIELD_P90))   \
+    METRICS_ATTR(METRICS_ATTR_HIST_ID(METRIC_##id, METRICS_HIST_FIELD_P99))   \
+    METRICS_ATTR(METRICS_ATTR_HIST_ID(METRIC_##id, METRICS_HIST_FIELD_MAX))
+
+const zb_ep_attr_desc_t metrics_zcl_attrs[METRICS_ZCL_ATTR_COUNT] = {
+    METRICS_COUNTERS(METRICS_COUNTER_ATTR)
+    METRICS_GAUGES(METRICS_GAUGE_ATTR)
+    METRICS_HISTOGRAMS(METRICS_HIST_ATTRS)
+};
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+FORCE_INLINE_ATTR uint32_t metrics_log2(uint32_t value);
+FORCE_INLINE_ATTR uint32_t metrics_bucket(uint32_t value);
+static uint32_t metrics_bucket_low(uint32_t bucket);
+static uint32_t metrics_bucket_high(uint32_t bucket);
+static void metrics_summarize(const uint32_t *buckets, metrics_hist_summary_t *summary);
+static void metrics_sync_value(uint16_t attr_id, uint32_t value, uint32_t *published);
+static void metrics_sync_cb(uint8_t param);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/**
+ * @brief Index of the highest set bit, @p value must not be 0
+ *
+ * RV32IMAC has no count-leading-zeros instruction and libgcc's __clzsi2
+ * reads a table in flash, which an ISR must not touch while the cache is
+ * off. Five compare-and-shift steps instead, forced inline so the updates
+ * stay in IRAM.
+ */
+FORCE_INLINE_ATTR uint32_t metrics_log2(uint32_t value)
+{
+    uint32_t log = 0;
+
+    if (value >> 16) { value >>= 16; log += 16; }
+    if (value >> 8)  { value >>= 8;  log += 8; }
+    if (value >> 4)  { value >>= 4;  log += 4; }
+    if (value >> 2)  { value >>= 2;  log += 2; }
+    if (value >> 1)  { log += 1; }
+    return log;
+}
+
+/**
+ * @brief Bucket of a value
+ *
+ * Group 0 holds 0 .. SUB_BUCKETS-1 exactly. Group g >= 1 covers
+ * [2^(g+SUB_BITS-1), 2^(g+SUB_BITS)) in SUB_BUCKETS buckets of width
+ * 2^(g-1), selected by the bits below the leading one.
+ */
+FORCE_INLINE_ATTR uint32_t metrics_bucket(uint32_t value)
+{
+    if (value < METRICS_HIST_SUB_BUCKETS) {
+        return value;
+    }
+
+    uint32_t log = metrics_log2(value);
+    if (log >= METRICS_HIST_RANGE_BITS) {
+        return METRICS_HIST_BUCKETS - 1;
+    }
+
+    uint32_t shift = log - METRICS_HIST_SUB_BITS;
+    return ((shift + 1) << METRICS_HIST_SUB_BITS) + ((value >> shift) & (METRICS_HIST_SUB_BUCKETS - 1));
+}
+
+/** Smallest value of a bucket (2^RANGE_BITS for the overflow bucket) */
+static uint32_t metrics_bucket_low(uint32_t bucket)
+{
+    uint32_t group = bucket >> METRICS_HIST_SUB_BITS;
+    uint32_t sub = bucket & (METRICS_HIST_SUB_BUCKETS - 1);
+
+    if (group == 0) {
+        return sub;
+    }
+    return (METRICS_HIST_SUB_BUCKETS + sub) << (group - 1);
+}
+
+/** Largest value of a bucket (UINT32_MAX for the overflow bucket) */
+static uint32_t metrics_bucket_high(uint32_t bucket)
+{
+    uint32_t group = bucket >> METRICS_HIST_SUB_BITS;
+
+    if (bucket == METRICS_HIST_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return metrics_bucket_low(bucket) + (group == 0 ? 0 : (1u << (group - 1)) - 1);
+}
+
+static void metrics_summarize(const uint32_t *buckets, metrics_hist_summary_t *summary)
+{
+    uint32_t count = 0;
+    uint32_t last = 0;
+    uint64_t sum = 0;
+
+    memset(summary, 0, sizeof(*summary));
+
+    for (uint32_t b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        if (buckets[b] == 0) {
+            continue;
+        }
+        /* Centre of the bucket; the overflow bucket counts as its lower bound */
+        uint32_t low = metrics_bucket_low(b);
+        uint32_t centre = b == METRICS_HIST_BUCKETS - 1 ? low : low + (metrics_bucket_high(b) - low) / 2;
+        count += buckets[b];
+        sum += (uint64_t)buckets[b] * centre;
+        last = b;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    summary->fields[METRICS_HIST_FIELD_COUNT] = count;
+    summary->fields[METRICS_HIST_FIELD_MEAN] = (uint32_t)(sum / count);
+    summary->fields[METRICS_HIST_FIELD_MAX] = metrics_bucket_high(last);
+
+    for (uint32_t p = 0; p < sizeof(s_percentiles); p++) {
+        uint64_t rank = ((uint64_t)count * s_percentiles[p] + 99) / 100;
+        uint64_t seen = 0;
+        uint32_t b = 0;
+
+        while (b < last) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                break;
+            }
+            b++;
+        }
+        summary->fields[METRICS_HIST_FIELD_P50 + p] = metrics_bucket_high(b);
+    }
+}
+
+/** Write a value into the cluster if it differs from the published one */
+static void metrics_sync_value(uint16_t attr_id, uint32_t value, uint32_t *published)
+{
+    if (value == *published) {
+        return;
+    }
+
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(
+        ZIGBEE_ENDPOINT, METRICS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        attr_id, &value, false);
+
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        APP_LOGW("Failed to set attribute 0x%04x, status: 0x%x", attr_id, status);
+        return;
+    }
+    *published = value;
+}
+
+/**
+ * @brief Copy the changed values into the cluster, runs in the Zigbee task
+ */
+static void metrics_sync_cb(uint8_t param)
+{
+    (void)param;
+    metrics_snapshot_t now;
+
+    metrics_snapshot(&now);
+
+    for (uint32_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        metrics_sync_value(METRICS_ATTR_COUNTER_ID(i), now.counters[i], &s_published.counters[i]);
+    }
+    for (uint32_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        metrics_sync_value(METRICS_ATTR_GAUGE_ID(i), now.gauges[i], &s_published.gauges[i]);
+    }
+    for (uint32_t i = 0; i < METRIC_HIST_COUNT; i++) {
+        for (uint32_t f = 0; f < METRICS_HIST_FIELDS; f++) {
+            metrics_sync_value(METRICS_ATTR_HIST_ID(i, f), now.hists[i].fields[f],
+                               &s_published.hists[i].fields[f]);
+        }
+    }
+
+    esp_zb_scheduler_alarm(metrics_sync_cb, 0, METRICS_SYNC_INTERVAL_MS);
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+void IRAM_ATTR metrics_count(metric_counter_t id)
+{
+    __atomic_fetch_add(&s_counters[id], 1, __ATOMIC_RELAXED);
+}
+
+void IRAM_ATTR metrics_add(metric_counter_t id, uint32_t amount)
+{
+    __atomic_fetch_add(&s_counters[id], amount, __ATOMIC_RELAXED);
+}
+
+void IRAM_ATTR metrics_set(metric_gauge_t id, uint32_t value)
+{
+    __atomic_store_n(&s_gauges[id], value, __ATOMIC_RELAXED);
+}
+
+void IRAM_ATTR metrics_record(metric_hist_t id, uint32_t value)
+{
+    __atomic_fetch_add(&s_buckets[id][metrics_bucket(value)], 1, __ATOMIC_RELAXED);
+}
+
+void metrics_snapshot(metrics_snapshot_t *snapshot)
+{
+    uint32_t buckets[METRICS_HIST_BUCKETS];
+
+    for (uint32_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        snapshot->counters[i] = __atomic_load_n(&s_counters[i], __ATOMIC_RELAXED);
+    }
+    for (uint32_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        snapshot->gauges[i] = __atomic_load_n(&s_gauges[i], __ATOMIC_RELAXED);
+    }
+    for (uint32_t i = 0; i < METRIC_HIST_COUNT; i++) {
+        for (uint32_t b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            buckets[b] = __atomic_load_n(&s_buckets[i][b], __ATOMIC_RELAXED);
+        }
+        metrics_summarize(buckets, &snapshot->hists[i]);
+    }
+}
+
+void metrics_reset(void)
+{
+    for (uint32_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        __atomic_store_n(&s_counters[i], 0, __ATOMIC_RELAXED);
+    }
+    for (uint32_t i = 0; i < METRIC_HIST_COUNT; i++) {
+        for (uint32_t b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            __atomic_store_n(&s_buckets[i][b], 0, __ATOMIC_RELAXED);
+        }
+    }
+
+    APP_LOGI("Metrics reset");
+}
+
+const char *metrics_counter_name(metric_counter_t id)
+{
+    return (uint32_t)id < METRIC_COUNTER_COUNT ? s_counter_names[id] : "?";
+}
+
+const char *metrics_gauge_name(metric_gauge_t id)
+{
+    return (uint32_t)id < METRIC_GAUGE_COUNT ? s_gauge_names[id] : "?";
+}
+
+const char *metrics_hist_name(metric_hist_t id)
+{
+    return (uint32_t)id < METRIC_HIST_COUNT ? s_hist_names[id] : "?";
+}
+
+void metrics_start(void)
+{
+    memset(&s_published, 0, sizeof(s_published));
+    esp_zb_scheduler_alarm(metrics_sync_cb, 0, METRICS_SYNC_INTERVAL_MS);
+}
+
+void metrics_bench(uint32_t iterations, metrics_bench_t *bench)
+{
+    const metric_counter_t counter = (metric_counter_t)0;
+    const metric_gauge_t gauge = (metric_gauge_t)0;
+    const metric_hist_t hist = (metric_hist_t)0;
+
+    memset(bench, 0, sizeof(*bench));
+    if (iterations == 0) {
+        return;
+    }
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < iterations; i++) {
+        metrics_count(counter);
+    }
+    bench->count_cycles = (esp_cpu_get_cycle_count() - start) / iterations;
+    __atomic_fetch_sub(&s_counters[counter], iterations, __ATOMIC_RELAXED);
+
+    uint32_t previous = __atomic_load_n(&s_gauges[gauge], __ATOMIC_RELAXED);
+    start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < iterations; i++) {
+        metrics_set(gauge, i);
+    }
+    bench->set_cycles = (esp_cpu_get_cycle_count() - start) / iterations;
+    metrics_set(gauge, previous);
+
+    start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < iterations; i++) {
+        metrics_record(hist, METRICS_BENCH_VALUE);
+    }
+    bench->record_cycles = (esp_cpu_get_cycle_count() - start) / iterations;
+    __atomic_fetch_sub(&s_buckets[hist][metrics_bucket(METRICS_BENCH_VALUE)], iterations, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,246 @@
+/**
+ * @file metrics.h
+ * @brief Metrics registry for ESP32-C6 Zigbee Fan Switch
+ *
+ * One place for the numbers the firmware counts and measures, instead of a
+ * set of ad-hoc globals per idea. The metrics are listed at compile time
+ * below (METRICS_COUNTERS, METRICS_GAUGES, METRICS_HISTOGRAMS), which makes
+ * the ids, the names and the ZCL attributes; adding a metric is one line.
+ *
+ *   counter    uint32, only grows (wraps at 2^32)
+ *   gauge      uint32, last value set
+ *   histogram  log-linear buckets: values below 2^METRICS_HIST_SUB_BITS
+ *              exactly, above that METRICS_HIST_SUB_BUCKETS buckets per power
+ *              of two (at most 25 % wide), values from
+ *              2^METRICS_HIST_RANGE_BITS in an overflow bucket
+ *
+ * Values are integers in the unit named by the metric (us, cycles, ...),
+ * there is no floating point anywhere. Every update is a single relaxed
+ * atomic read-modify-write or store on one word: no lock, no critical
+ * section, safe from tasks and from interrupts (the update functions are in
+ * IRAM), and wait-free on the ESP32-C6 (amoadd.w). The cost is measured by
+ * metrics_bench() (console "bench").
+ *
+ * metrics_snapshot() reads every word once and reduces the histograms to
+ * count, mean and percentiles (bucket upper bounds). Metrics updated while
+ * the snapshot runs may land in it or in the next one. The snapshot is the
+ * only export path: the console "metrics" command prints it as "METRIC"
+ * lines, metrics_start() copies it into the Metrics cluster every
+ * METRICS_SYNC_INTERVAL_MS.
+ *
+ * Manufacturer-specific Metrics cluster (METRICS_CLUSTER_ID), all uint32:
+ *   0x0000 + n             counter n
+ *   0x0100 + n             gauge n
+ *   0x0200 + 0x10 * n + f  histogram n, field f: 0 count, 1 mean, 2 p50,
+ *                          3 p90, 4 p99, 5 max
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "zb_endpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/**
+ * @brief Counters: X(id, name)
+ *
+ *   zcl_writes             attribute writes accepted by the handler
+ *   zcl_rejected           malformed attribute writes dropped
+ *   aps_rx                 APS frames received
+ */
+#define METRICS_COUNTERS(X)                         \
+    X(ZCL_WRITES,           "zcl_writes")           \
+    X(ZCL_REJECTED,         "zcl_rejected")         \
+    X(APS_RX,               "aps_rx")
+
+/**
+ * @brief Gauges: X(id, name)
+ *
+ *   net_state              network state (network_state_t)
+ *   parent_fails           link failures in a row reported by the stack
+ */
+#define METRICS_GAUGES(X)                           \
+    X(NET_STATE,            "net_state")            \
+    X(PARENT_FAILS,         "parent_fails")
+
+/**
+ * @brief Histograms: X(id, name)
+ *
+ *   button_latency_us      button release to the relay GPIO write
+ *   zcl_write_cycles       attribute handler, accepted writes
+ *   event_dispatch_cycles  app_event_publish(), all subscribers
+ */
+#define METRICS_HISTOGRAMS(X)                       \
+    X(BUTTON_LATENCY_US,    "button_latency_us")    \
+    X(ZCL_WRITE_CYCLES,     "zcl_write_cycles")     \
+    X(EVENT_DISPATCH_CYCLES, "event_dispatch_cycles")
+
+/** @brief Buckets per power of two are 2^METRICS_HIST_SUB_BITS */
+#define METRICS_HIST_SUB_BITS       2
+#define METRICS_HIST_SUB_BUCKETS    (1 << METRICS_HIST_SUB_BITS)
+
+/** @brief Values from 2^METRICS_HIST_RANGE_BITS go to the overflow bucket */
+#define METRICS_HIST_RANGE_BITS     24
+
+/** @brief Buckets per histogram, the last one is the overflow bucket */
+#define METRICS_HIST_BUCKETS \
+    (((METRICS_HIST_RANGE_BITS - METRICS_HIST_SUB_BITS + 1) << METRICS_HIST_SUB_BITS) + 1)
+
+/** @brief Interval at which the snapshot is copied into the Metrics cluster */
+#define METRICS_SYNC_INTERVAL_MS    30000
+
+/** @brief Updates per metric kind in metrics_bench() */
+#define METRICS_BENCH_OPS           1000
+
+/** @brief Manufacturer-specific Metrics cluster ID */
+#define METRICS_CLUSTER_ID          0xFC14
+
+/* Metrics cluster attribute IDs */
+#define METRICS_ATTR_COUNTER_ID(n)      (0x0000 + (n))
+#define METRICS_ATTR_GAUGE_ID(n)        (0x0100 + (n))
+#define METRICS_ATTR_HIST_ID(n, field)  (0x0200 + 0x10 * (n) + (field))
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+#define METRICS_ENUM_ID(id, name)   METRIC_##id,
+
+/** @brief Counter ids */
+typedef enum {
+    METRICS_COUNTERS(METRICS_ENUM_ID)
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+/** @brief Gauge ids */
+typedef enum {
+    METRICS_GAUGES(METRICS_ENUM_ID)
+    METRIC_GAUGE_COUNT
+} metric_gauge_t;
+
+/** @brief Histogram ids */
+typedef enum {
+    METRICS_HISTOGRAMS(METRICS_ENUM_ID)
+    METRIC_HIST_COUNT
+} metric_hist_t;
+
+/** @brief Histogram fields, in the order of their ZCL attributes */
+typedef enum {
+    METRICS_HIST_FIELD_COUNT = 0,
+    METRICS_HIST_FIELD_MEAN,
+    METRICS_HIST_FIELD_P50,
+    METRICS_HIST_FIELD_P90,
+    METRICS_HIST_FIELD_P99,
+    METRICS_HIST_FIELD_MAX,
+    METRICS_HIST_FIELDS
+} metrics_hist_field_t;
+
+/** @brief Number of attributes in metrics_zcl_attrs */
+#define METRICS_ZCL_ATTR_COUNT \
+    (METRIC_COUNTER_COUNT + METRIC_GAUGE_COUNT + METRIC_HIST_COUNT * METRICS_HIST_FIELDS)
+
+/**
+ * @brief Histogram reduced to its summary
+ *
+ * Percentiles and the maximum are the upper bound of the bucket they fall
+ * in, UINT32_MAX for the overflow bucket. The mean uses the bucket centres.
+ */
+typedef struct {
+    uint32_t fields[METRICS_HIST_FIELDS];   /**< Indexed by metrics_hist_field_t */
+} metrics_hist_summary_t;
+
+/**
+ * @brief Snapshot of all metrics
+ */
+typedef struct {
+    uint32_t counters[METRIC_COUNTER_COUNT];
+    uint32_t gauges[METRIC_GAUGE_COUNT];
+    metrics_hist_summary_t hists[METRIC_HIST_COUNT];
+} metrics_snapshot_t;
+
+/**
+ * @brief Cost of the updates, CPU cycles per call
+ */
+typedef struct {
+    uint32_t count_cycles;      /**< metrics_count() */
+    uint32_t set_cycles;        /**< metrics_set() */
+    uint32_t record_cycles;     /**< metrics_record() */
+} metrics_bench_t;
+
+/** Attribute table of the Metrics cluster (see zb_endpoint.h) */
+extern const zb_ep_attr_desc_t metrics_zcl_attrs[METRICS_ZCL_ATTR_COUNT];
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Add one to a counter (any context, including ISRs)
+ */
+void metrics_count(metric_counter_t id);
+
+/**
+ * @brief Add to a counter (any context, including ISRs)
+ */
+void metrics_add(metric_counter_t id, uint32_t amount);
+
+/**
+ * @brief Set a gauge (any context, including ISRs)
+ */
+void metrics_set(metric_gauge_t id, uint32_t value);
+
+/**
+ * @brief Record a value in a histogram (any context, including ISRs)
+ */
+void metrics_record(metric_hist_t id, uint32_t value);
+
+/**
+ * @brief Read all metrics
+ */
+void metrics_snapshot(metrics_snapshot_t *snapshot);
+
+/**
+ * @brief Zero counters and histograms, gauges keep their value
+ *
+ * Updates racing with the reset may survive it.
+ */
+void metrics_reset(void);
+
+/**
+ * @brief Names as listed in METRICS_COUNTERS / _GAUGES / _HISTOGRAMS
+ */
+const char *metrics_counter_name(metric_counter_t id);
+const char *metrics_gauge_name(metric_gauge_t id);
+const char *metrics_hist_name(metric_hist_t id);
+
+/**
+ * @brief Start copying the snapshot into the Metrics cluster
+ *
+ * Must be called from the Zigbee task after the stack has been started.
+ */
+void metrics_start(void);
+
+/**
+ * @brief Measure the cost of the update functions
+ *
+ * Updates the first counter, gauge and histogram and takes the updates back
+ * afterwards (the gauge gets its previous value).
+ *
+ * @param iterations Updates per function
+ * @param[out] bench Average cycles per call
+ */
+void metrics_bench(uint32_t iterations, metrics_bench_t *bench);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_H */
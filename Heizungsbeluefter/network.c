@@ -0,0 +1,487 @@
+/**
+ * @file network.c
+ * @brief Network membership state machine implementation
+ *
+ * State changes and all esp_zb_* calls happen in the Zigbee task (signal
+ * handler and scheduler callbacks). At most one steering or rejoin step is
+ * scheduled at a time; scheduling a step cancels the other one. The public
+ * request functions take the Zigbee lock and only schedule a step.
+ */
+
+#include "network.h"
+#include "zigbee_handler.h"
+#include "app_event.h"
+#include "status_led.h"
+#include "diagnostics.h"
+#include "event_trace.h"
+#include "metrics.h"
+#include "esp_zigbee_core.h"
+#include "esp_timer.h"
+#include "esp_rtc_time.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#define APP_LOG_MODULE_LEVEL    NETWORK_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "NET";
+
+/** Short address of the coordinator (trust center) */
+#define NETWORK_COORDINATOR_ADDR    0x0000
+
+#define NETWORK_RTC_MAGIC           0x4C454156  /* "LEAV" */
+
+/**
+ * Leave time, survives the restart of the zb_storage erase. RTC time keeps
+ * running through software resets, esp_timer does not.
+ */
+typedef struct {
+    uint32_t magic;
+    uint64_t left_rtc_us;
+} network_rtc_leave_t;
+
+static RTC_NOINIT_ATTR network_rtc_leave_t s_rtc_leave;
+
+/* Zigbee task, or another task holding the Zigbee lock */
+static network_state_t s_state = NETWORK_STATE_IDLE;
+static uint32_t s_backoff_ms = NETWORK_BACKOFF_MIN_MS;
+static uint64_t s_left_us = 0;          /**< RTC time of the last leave, 0 = none pending */
+static bool s_steered_since_leave = false;
+static uint8_t s_parent_failures = 0;   /**< Link failures in a row */
+static int64_t s_parent_ok_us = 0;      /**< Last frame exchanged with the parent */
+static int64_t s_parent_lost_us = 0;    /**< Time the parent loss was detected, 0 = none pending */
+
+/* Written in the Zigbee task, read by any task */
+static network_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void network_set_state(network_state_t state);
+static void network_schedule(esp_zb_callback_t cb, uint32_t delay_ms);
+static void network_steer_cb(uint8_t param);
+static void network_rejoin_cb(uint8_t param);
+static void network_retry(bool rejoin);
+static void network_joined(void);
+static void network_start_rejoin(const char *reason);
+static void network_parent_lost(const char *reason);
+static void network_link_failure(uint16_t dst_addr);
+static void network_on_leave(const esp_zb_zdo_signal_leave_params_t *params);
+static void network_restore_leave(void);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static void network_set_state(network_state_t state)
+{
+    if (state == s_state) {
+        return;
+    }
+    APP_LOGD("State %d -> %d", s_state, state);
+    s_state = state;
+    event_trace_log(EVT_NETWORK, (uint8_t)state, 0);
+    metrics_set(METRIC_NET_STATE, (uint32_t)state);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.state = (uint8_t)state;
+    s_stats.backoff_ms = s_backoff_ms;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    switch (state) {
+        case NETWORK_STATE_STEERING:
+        case NETWORK_STATE_REJOINING:
+            status_led_set_network(STATUS_LED_NET_STEERING);
+            break;
+        case NETWORK_STATE_JOINED:
+            status_led_set_network(STATUS_LED_NET_JOINED);
+            break;
+        default:
+            status_led_set_network(STATUS_LED_NET_OFFLINE);
+            break;
+    }
+}
+
+/** Schedule the next step, replacing a pending one */
+static void network_schedule(esp_zb_callback_t cb, uint32_t delay_ms)
+{
+    esp_zb_scheduler_alarm_cancel(network_steer_cb, 0);
+    esp_zb_scheduler_alarm_cancel(network_rejoin_cb, 0);
+    esp_zb_scheduler_alarm(cb, 0, delay_ms);
+}
+
+/**
+ * @brief Start BDB network steering and count the attempt
+ *
+ * Has the esp_zb_callback_t signature so it can be scheduled directly.
+ */
+static void network_steer_cb(uint8_t param)
+{
+    (void)param;
+
+    network_set_state(NETWORK_STATE_STEERING);
+    diagnostics_count_steering_attempt();
+
+    if (s_left_us && !s_steered_since_leave) {
+        uint32_t elapsed_ms = (uint32_t)((esp_rtc_get_time_us() - s_left_us) / 1000);
+        s_steered_since_leave = true;
+
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.leave_to_steering_ms = elapsed_ms;
+        portEXIT_CRITICAL(&s_stats_lock);
+
+        if (elapsed_ms > NETWORK_REPAIRABLE_MAX_MS) {
+            APP_LOGW("Re-pairable %lu ms after leave (bound %d ms)",
+                     (unsigned long)elapsed_ms, NETWORK_REPAIRABLE_MAX_MS);
+        } else {
+            APP_LOGI("Re-pairable %lu ms after leave", (unsigned long)elapsed_ms);
+        }
+    }
+
+    esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
+}
+
+/**
+ * @brief Rejoin the stored network (BDB initialization of a commissioned device)
+ */
+static void network_rejoin_cb(uint8_t param)
+{
+    (void)param;
+
+    network_set_state(NETWORK_STATE_REJOINING);
+    esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
+}
+
+/** Retry a failed attempt after the current backoff, then double it */
+static void network_retry(bool rejoin)
+{
+    uint32_t delay_ms = s_backoff_ms;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.failures++;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    network_set_state(NETWORK_STATE_BACKOFF);
+    APP_LOGW("%s failed, retrying in %lu ms", rejoin ? "Rejoin" : "Steering", (unsigned long)delay_ms);
+    network_schedule(rejoin ? network_rejoin_cb : network_steer_cb, delay_ms);
+
+    s_backoff_ms = delay_ms * 2 > NETWORK_BACKOFF_MAX_MS ? NETWORK_BACKOFF_MAX_MS : delay_ms * 2;
+}
+
+/** Tell the application that the device is part of a network */
+static void network_joined(void)
+{
+    app_event_t event = {
+        .type = APP_EVENT_ZB_JOINED,
+        .source = APP_EVENT_SRC_ZIGBEE,
+    };
+
+    s_backoff_ms = NETWORK_BACKOFF_MIN_MS;
+    diagnostics_count_parent_change();
+
+    if (s_left_us) {
+        uint32_t elapsed_ms = (uint32_t)((esp_rtc_get_time_us() - s_left_us) / 1000);
+        s_left_us = 0;
+        s_rtc_leave.magic = 0;
+
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.leave_to_joined_ms = elapsed_ms;
+        portEXIT_CRITICAL(&s_stats_lock);
+
+        APP_LOGI("Joined %lu ms after leave", (unsigned long)elapsed_ms);
+    }
+    if (s_parent_lost_us) {
+        uint32_t recovery_ms = (uint32_t)((esp_timer_get_time() - s_parent_lost_us) / 1000);
+        s_parent_lost_us = 0;
+        diagnostics_set_parent_recovery(recovery_ms);
+        APP_LOGI("Recovered from parent loss in %lu ms", (unsigned long)recovery_ms);
+    }
+    s_parent_failures = 0;
+    metrics_set(METRIC_PARENT_FAILS, 0);
+    s_parent_ok_us = esp_timer_get_time();
+
+    network_set_state(NETWORK_STATE_JOINED);
+    app_event_publish(&event);
+}
+
+/** Keep the network and rejoin it, unless a procedure is already running */
+static void network_start_rejoin(const char *reason)
+{
+    if (s_state != NETWORK_STATE_JOINED) {
+        APP_LOGD("%s while not joined, ignored", reason);
+        return;
+    }
+    APP_LOGW("%s, rejoining", reason);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.rejoins++;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    s_backoff_ms = NETWORK_BACKOFF_MIN_MS;
+    network_schedule(network_rejoin_cb, 0);
+}
+
+/** Measure the detection time and rejoin, the old parent is gone */
+static void network_parent_lost(const char *reason)
+{
+    if (s_state != NETWORK_STATE_JOINED) {
+        APP_LOGD("%s while not joined, ignored", reason);
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint32_t detect_ms = s_parent_ok_us ? (uint32_t)((now - s_parent_ok_us) / 1000) : 0;
+
+    s_parent_lost_us = now;
+    s_parent_failures = 0;
+    metrics_set(METRIC_PARENT_FAILS, 0);
+    diagnostics_count_parent_loss(detect_ms);
+    APP_LOGW("Parent lost %lu ms after the last frame", (unsigned long)detect_ms);
+
+    network_start_rejoin(reason);
+}
+
+/**
+ * @brief Count a frame the stack could not deliver to the next hop
+ *
+ * The next hop of an end device is always its parent, whatever the
+ * destination of the frame.
+ */
+static void network_link_failure(uint16_t dst_addr)
+{
+    if (s_state != NETWORK_STATE_JOINED) {
+        return;
+    }
+    s_parent_failures++;
+    metrics_set(METRIC_PARENT_FAILS, s_parent_failures);
+    APP_LOGD("Link failure towards 0x%04x (%u in a row)", dst_addr, s_parent_failures);
+    if (s_parent_failures >= NETWORK_PARENT_FAIL_THRESHOLD) {
+        network_parent_lost("Parent not acknowledging");
+    }
+}
+
+static void network_on_leave(const esp_zb_zdo_signal_leave_params_t *params)
+{
+    if (params && params->leave_type == ESP_ZB_NWK_LEAVE_TYPE_REJOIN) {
+        APP_LOGI("Left the network with rejoin");
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.rejoins++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        s_backoff_ms = NETWORK_BACKOFF_MIN_MS;
+        network_set_state(NETWORK_STATE_REJOINING);
+        network_schedule(network_rejoin_cb, NETWORK_LEAVE_STEER_DELAY_MS);
+        return;
+    }
+
+    app_event_t event = {
+        .type = APP_EVENT_ZB_LEFT,
+        .source = APP_EVENT_SRC_ZIGBEE,
+    };
+
+    APP_LOGW("Removed from the network");
+    s_left_us = esp_rtc_get_time_us();
+    s_rtc_leave.left_rtc_us = s_left_us;
+    s_rtc_leave.magic = NETWORK_RTC_MAGIC;
+    s_steered_since_leave = false;
+    s_parent_lost_us = 0;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.leaves++;
+    s_stats.leave_to_steering_ms = 0;
+    s_stats.leave_to_joined_ms = 0;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    network_set_state(NETWORK_STATE_LEFT);
+    app_event_publish(&event);
+
+    if (!esp_zb_bdb_is_factory_new()) {
+        /*
+         * The stack kept the old network; only an erase makes the device
+         * joinable. The restart keeps the leave time, the measurement ends
+         * at the first steering after boot.
+         */
+        APP_LOGW("Network data still stored, erasing zb_storage");
+        esp_zb_factory_reset();
+        return;
+    }
+
+    s_backoff_ms = NETWORK_BACKOFF_MIN_MS;
+    network_schedule(network_steer_cb, NETWORK_LEAVE_STEER_DELAY_MS);
+}
+
+/** Take over a leave from before a software restart (zb_storage erase) */
+static void network_restore_leave(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    uint64_t now = esp_rtc_get_time_us();
+
+    if (s_rtc_leave.magic != NETWORK_RTC_MAGIC || reason == ESP_RST_POWERON ||
+        reason == ESP_RST_BROWNOUT || s_rtc_leave.left_rtc_us > now) {
+        s_rtc_leave.magic = 0;
+        return;
+    }
+    s_left_us = s_rtc_leave.left_rtc_us;
+    s_steered_since_leave = false;
+    APP_LOGI("Restarted %lu ms after leave", (unsigned long)((now - s_left_us) / 1000));
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+bool network_on_signal(uint32_t type, esp_err_t status, void *params)
+{
+    switch (type) {
+        case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
+            APP_LOGI("Zigbee stack initialized");
+            network_restore_leave();
+            /* Start network steering (join network) */
+            network_schedule(network_steer_cb, 0);
+            return true;
+
+        case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
+        case ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT:
+            if (esp_zb_bdb_is_factory_new()) {
+                if (status == ESP_OK) {
+                    APP_LOGI("Start network steering (searching for coordinator)");
+                    network_schedule(network_steer_cb, 0);
+                } else {
+                    APP_LOGW("Device startup failed, status: %s", esp_err_to_name(status));
+                    network_retry(false);
+                }
+            } else if (status == ESP_OK) {
+                APP_LOGI("%s", s_state == NETWORK_STATE_REJOINING ? "Rejoined the network" :
+                         "Device already commissioned, rejoining network");
+                network_joined();
+            } else {
+                APP_LOGW("Rejoin failed, status: %s", esp_err_to_name(status));
+                network_retry(true);
+            }
+            return true;
+
+        case ESP_ZB_BDB_SIGNAL_STEERING:
+            if (status == ESP_OK) {
+                esp_zb_ieee_addr_t extended_pan_id;
+                esp_zb_get_extended_pan_id(extended_pan_id);
+                APP_LOGI("Joined network successfully!");
+                APP_LOGI("  Extended PAN ID: %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x",
+                         extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4],
+                         extended_pan_id[3], extended_pan_id[2], extended_pan_id[1], extended_pan_id[0]);
+                APP_LOGI("  PAN ID: 0x%04x", esp_zb_get_pan_id());
+                APP_LOGI("  Channel: %d", esp_zb_get_current_channel());
+                APP_LOGI("  Short Address: 0x%04x", esp_zb_get_short_address());
+                network_joined();
+            } else {
+                APP_LOGW("Network steering failed, status: %s", esp_err_to_name(status));
+                network_retry(false);
+            }
+            return true;
+
+        case ESP_ZB_ZDO_SIGNAL_LEAVE:
+            network_on_leave((const esp_zb_zdo_signal_leave_params_t *)params);
+            return true;
+
+        case ESP_ZB_ZDO_SIGNAL_DEVICE_UNAVAILABLE: {
+            const esp_zb_zdo_signal_device_unavailable_params_t *unavailable = params;
+            if (unavailable && unavailable->short_addr == NETWORK_COORDINATOR_ADDR) {
+                network_start_rejoin("Coordinator unavailable");
+            } else if (unavailable) {
+                APP_LOGI("Device 0x%04x unavailable", unavailable->short_addr);
+            }
+            return true;
+        }
+
+        case ESP_ZB_NLME_STATUS_INDICATION: {
+            const esp_zb_zdo_signal_nwk_status_indication_params_t *indication = params;
+            if (!indication) {
+                return false;
+            }
+            switch (indication->status) {
+                case ESP_ZB_NWK_COMMAND_STATUS_PARENT_LINK_FAILURE:
+                    network_parent_lost("Parent link failure");
+                    return true;
+                case ESP_ZB_NWK_COMMAND_STATUS_TREE_LINK_FAILURE:
+                case ESP_ZB_NWK_COMMAND_STATUS_NONE_TREE_LINK_FAILURE:
+                    network_link_failure(indication->network_addr);
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        case ESP_ZB_NWK_SIGNAL_NO_ACTIVE_LINKS_LEFT:
+            network_parent_lost("No active links left");
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void network_on_aps_indication(uint16_t dst_short_addr)
+{
+    if (dst_short_addr != esp_zb_get_short_address()) {
+        return;
+    }
+    s_parent_failures = 0;
+    metrics_set(METRIC_PARENT_FAILS, 0);
+    s_parent_ok_us = esp_timer_get_time();
+}
+
+void network_start_steering(void)
+{
+    APP_LOGI("Network steering requested");
+
+    bool locked = zigbee_handler_lock();
+    s_backoff_ms = NETWORK_BACKOFF_MIN_MS;
+    network_schedule(network_steer_cb, 0);
+    zigbee_handler_unlock(locked);
+}
+
+void network_rejoin(void)
+{
+    bool locked = zigbee_handler_lock();
+    network_start_rejoin("Rejoin requested");
+    zigbee_handler_unlock(locked);
+}
+
+void network_leave(void)
+{
+    APP_LOGW("Leaving the network");
+
+    bool locked = zigbee_handler_lock();
+    esp_zb_bdb_reset_via_local_action();
+    zigbee_handler_unlock(locked);
+}
+
+void network_factory_reset(void)
+{
+    APP_LOGW("Factory reset requested, erasing Zigbee network data");
+
+    /* Erases zb_storage and restarts the device */
+    bool locked = zigbee_handler_lock();
+    esp_zb_factory_reset();
+    zigbee_handler_unlock(locked);
+}
+
+network_state_t network_state(void)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    network_state_t state = (network_state_t)s_stats.state;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    return state;
+}
+
+void network_get_stats(network_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
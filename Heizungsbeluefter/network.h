@@ -0,0 +1,165 @@
+/**
+ * @file network.h
+ * @brief Network membership state machine for ESP32-C6 Zigbee Fan Switch
+ *
+ * Owns commissioning: steering, rejoin and leave. The ZDO signal handler
+ * passes the network signals on; each one moves the state machine:
+ *
+ *   STEERING  --joined-->  JOINED  --parent lost / unavailable-->  REJOINING
+ *       ^                    |                                        |
+ *       |                    +--leave (removed)--> LEFT --delay-------+--> STEERING
+ *       +--failed: BACKOFF --+                     rejoin failed: BACKOFF --> REJOINING
+ *
+ *   - Leave without rejoin (device removed in Zigbee2MQTT/ZHA): the stack
+ *     forgets the network; if it still reports network data, zb_storage is
+ *     erased by a factory reset (restart). The leave time is kept in RTC
+ *     memory across that restart, so the measurement below covers it. Otherwise steering starts again
+ *     after NETWORK_LEAVE_STEER_DELAY_MS, so the device can be paired again
+ *     without a power cycle. APP_EVENT_ZB_LEFT is published.
+ *   - Leave with rejoin, parent link failure, coordinator unavailable: the
+ *     network is kept and the device rejoins (BDB initialization).
+ *   - Parent loss: the stack reports failed polls as a parent link failure
+ *     after its own retries, which starts the rejoin. A frame the stack
+ *     could not hand to the next hop is reported as a (non-)tree link
+ *     failure; an end device only talks to its parent, so each one counts
+ *     against the parent, and NETWORK_PARENT_FAIL_THRESHOLD of them in a
+ *     row start the rejoin at once. A unicast received in between resets
+ *     the count. The rejoin scans for beacons and picks the best parent in
+ *     range. The detection and recovery times go to the Diagnostics
+ *     cluster.
+ *   - Failed steering and rejoin attempts are retried with an exponential
+ *     backoff from NETWORK_BACKOFF_MIN_MS to NETWORK_BACKOFF_MAX_MS.
+ *
+ * The time from leave to steering (re-pairable) and from leave to joined is
+ * measured, see network_get_stats(); re-pairable later than
+ * NETWORK_REPAIRABLE_MAX_MS logs a warning.
+ *
+ * Everything except the public request functions runs in the Zigbee task;
+ * timed steps use the Zigbee scheduler.
+ */
+
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief First retry delay after a failed steering or rejoin attempt */
+#define NETWORK_BACKOFF_MIN_MS          1000
+
+/** @brief Longest retry delay (doubles per failure up to this) */
+#define NETWORK_BACKOFF_MAX_MS          30000
+
+/** @brief Delay from a leave to the first steering attempt (stack cleanup) */
+#define NETWORK_LEAVE_STEER_DELAY_MS    500
+
+/** @brief Bound for leave to re-pairable, exceeding it logs a warning */
+#define NETWORK_REPAIRABLE_MAX_MS       2000
+
+/** @brief Link failures in a row until the parent counts as lost */
+#define NETWORK_PARENT_FAIL_THRESHOLD   3
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Network state
+ *
+ * Values are stored in the event trace, so only append new states.
+ */
+typedef enum {
+    NETWORK_STATE_IDLE = 0,         /**< Stack not started */
+    NETWORK_STATE_STEERING,         /**< Searching for a network to join */
+    NETWORK_STATE_JOINED,           /**< On a network */
+    NETWORK_STATE_REJOINING,        /**< Network kept, rejoin in progress */
+    NETWORK_STATE_BACKOFF,          /**< Waiting before the next steering or rejoin attempt */
+    NETWORK_STATE_LEFT,             /**< Removed from the network, steering follows */
+} network_state_t;
+
+/**
+ * @brief Counters and timings
+ */
+typedef struct {
+    uint8_t state;                      /**< network_state_t */
+    uint16_t leaves;                    /**< Leaves without rejoin (removed) */
+    uint16_t rejoins;                   /**< Rejoin procedures started */
+    uint16_t failures;                  /**< Failed steering or rejoin attempts */
+    uint32_t backoff_ms;                /**< Delay before the next retry */
+    uint32_t leave_to_steering_ms;      /**< Last leave until steering started (re-pairable) */
+    uint32_t leave_to_joined_ms;        /**< Last leave until joined again, 0 = not yet */
+} network_stats_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Handle a ZDO/BDB signal (Zigbee task)
+ *
+ * @param type Signal type (esp_zb_app_signal_type_t)
+ * @param status Signal status
+ * @param params Signal parameters (esp_zb_app_signal_get_params())
+ * @return true if the signal was a network signal and has been handled
+ */
+bool network_on_signal(uint32_t type, esp_err_t status, void *params);
+
+/**
+ * @brief Account for a received frame (Zigbee task)
+ *
+ * A unicast to this device came through the parent, so the parent is alive.
+ * Broadcasts may be overheard from other routers and are ignored.
+ *
+ * @param dst_short_addr Destination short address of the frame
+ */
+void network_on_aps_indication(uint16_t dst_short_addr);
+
+/**
+ * @brief Start network steering (join or re-join), any task
+ */
+void network_start_steering(void);
+
+/**
+ * @brief Rejoin the current network as after a parent loss, any task
+ *
+ * Ignored unless joined.
+ */
+void network_rejoin(void);
+
+/**
+ * @brief Leave the network, any task
+ *
+ * The device erases the network data and starts steering again, so it can
+ * be paired anew.
+ */
+void network_leave(void);
+
+/**
+ * @brief Leave the network, erase zb_storage and restart, any task
+ */
+void network_factory_reset(void);
+
+/**
+ * @brief Current state
+ */
+network_state_t network_state(void);
+
+/**
+ * @brief Copy the counters and timings
+ */
+void network_get_stats(network_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_H */
@@ -0,0 +1,144 @@
+/**
+ * @file perf_trace.c
+ * @brief Timeline instrumentation implementation
+ *
+ * The recorder only fills a static buffer. A small low-priority task notices
+ * a full capture and prints it, so no logging happens on the traced paths.
+ */
+
+#include "perf_trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#define APP_LOG_MODULE_LEVEL    PERF_TRACE_LOG_LEVEL
+#include "app_log.h"
+
+static const char *TAG = "PERF_TRACE";
+
+#if PERF_TRACE_ENABLE
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+/** Interval at which the dump task checks for a full capture */
+#define PERF_TRACE_POLL_MS      1000
+
+/**
+ * @brief One recorded event (16 bytes)
+ */
+typedef struct {
+    uint32_t timestamp_us;  /* Low 32 bits of esp_timer_get_time() */
+    const char *name;       /* String literal */
+    TaskHandle_t task;      /* Recording task, NULL in ISR context */
+    uint8_t phase;          /* perf_trace_phase_t */
+} perf_trace_event_t;
+
+static perf_trace_event_t s_events[PERF_TRACE_CAPACITY];
+static volatile uint16_t s_event_count = 0;
+static volatile bool s_dumped = false;
+
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/**
+ * @brief Print each full capture once
+ */
+static void perf_trace_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(PERF_TRACE_POLL_MS));
+        if (s_event_count >= PERF_TRACE_CAPACITY && !s_dumped) {
+            perf_trace_dump();
+            s_dumped = true;
+        }
+    }
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+void IRAM_ATTR perf_trace_record(const char *name, perf_trace_phase_t phase)
+{
+    TaskHandle_t task = xPortInIsrContext() ? NULL : xTaskGetCurrentTaskHandle();
+
+    /* Timestamp inside the lock, so the events are stored in time order */
+    portENTER_CRITICAL_SAFE(&s_trace_lock);
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint16_t i = s_event_count;
+    if (i < PERF_TRACE_CAPACITY) {
+        s_events[i].timestamp_us = now;
+        s_events[i].name = name;
+        s_events[i].task = task;
+        s_events[i].phase = (uint8_t)phase;
+        s_event_count = i + 1;
+    }
+    portEXIT_CRITICAL_SAFE(&s_trace_lock);
+}
+
+void perf_trace_scope_end(const char *const *name)
+{
+    perf_trace_record(*name, PERF_TRACE_PHASE_END);
+}
+
+void perf_trace_restart(void)
+{
+    static TaskHandle_t s_task = NULL;
+
+    if (!s_task) {
+        xTaskCreate(perf_trace_task, "perf_trace", 3072, NULL, 1, &s_task);
+    }
+
+    portENTER_CRITICAL(&s_trace_lock);
+    s_event_count = 0;
+    s_dumped = false;
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    APP_LOGI("Capture started (%d events)", PERF_TRACE_CAPACITY);
+}
+
+void perf_trace_dump(void)
+{
+    uint16_t count = s_event_count;
+
+    ESP_LOGI(TAG, "---- perf trace: %u events ----", count);
+    for (uint16_t i = 0; i < count; i++) {
+        const perf_trace_event_t *ev = &s_events[i];
+        /* Task names are resolved at dump time; the firmware never deletes its tasks */
+        const char *task_name = ev->task ? pcTaskGetName(ev->task) : "ISR";
+        ESP_LOGI(TAG, "PT %lu %c %p %s %s", (unsigned long)ev->timestamp_us, ev->phase,
+                 (void *)ev->task, task_name, ev->name);
+    }
+    ESP_LOGI(TAG, "---- end of perf trace ----");
+}
+
+#else /* !PERF_TRACE_ENABLE */
+
+void perf_trace_record(const char *name, perf_trace_phase_t phase)
+{
+    (void)name;
+    (void)phase;
+}
+
+void perf_trace_scope_end(const char *const *name)
+{
+    (void)name;
+}
+
+void perf_trace_restart(void)
+{
+}
+
+void perf_trace_dump(void)
+{
+    ESP_LOGW(TAG, "Not compiled in (build with PERF_TRACE_ENABLE=1)");
+}
+
+#endif /* PERF_TRACE_ENABLE */
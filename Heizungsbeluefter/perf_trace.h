@@ -0,0 +1,118 @@
+/**
+ * @file perf_trace.h
+ * @brief Timeline instrumentation for ESP32-C6 Zigbee Fan Switch
+ *
+ * Scoped begin/end events with microsecond timestamps and the recording
+ * task are written to an in-RAM buffer. Once the buffer is full, recording
+ * stops and the capture is printed to the serial log, one "PT" line per
+ * event. tools/perf_trace_to_json.py turns a saved log into a Chrome /
+ * Perfetto JSON trace (open with ui.perfetto.dev or chrome://tracing).
+ *
+ * Disabled by default. Build with PERF_TRACE_ENABLE=1 to compile the
+ * instrumentation in; otherwise all macros expand to nothing.
+ *
+ * Usage:
+ *   void handler(void)
+ *   {
+ *       PERF_TRACE_SCOPE("handler");    // ends automatically on return
+ *       ...
+ *       PERF_TRACE_INSTANT("relay_on");
+ *   }
+ *
+ * Names must be string literals (only the pointer is stored).
+ */
+
+#ifndef PERF_TRACE_H
+#define PERF_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Compile the timeline instrumentation in (1) or out (0) */
+#ifndef PERF_TRACE_ENABLE
+#define PERF_TRACE_ENABLE       0
+#endif
+
+/** @brief Number of events per capture (16 bytes each) */
+#define PERF_TRACE_CAPACITY     512
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/** @brief Event phases, using the Chrome trace event letters */
+typedef enum {
+    PERF_TRACE_PHASE_BEGIN = 'B',
+    PERF_TRACE_PHASE_END = 'E',
+    PERF_TRACE_PHASE_INSTANT = 'i',
+} perf_trace_phase_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Record an event (task and ISR safe)
+ *
+ * @param name Event name (string literal)
+ * @param phase Event phase
+ */
+void perf_trace_record(const char *name, perf_trace_phase_t phase);
+
+/**
+ * @brief Cleanup handler used by PERF_TRACE_SCOPE
+ *
+ * @param name Pointer to the scope's name variable
+ */
+void perf_trace_scope_end(const char *const *name);
+
+/**
+ * @brief Start a new capture, discarding the current one
+ */
+void perf_trace_restart(void);
+
+/**
+ * @brief Print the current capture to the log ("PT" lines)
+ */
+void perf_trace_dump(void);
+
+/* =============================================================================
+ * Instrumentation Macros
+ * ============================================================================= */
+
+#if PERF_TRACE_ENABLE
+
+#define PERF_TRACE_CONCAT_(a, b)    a##b
+#define PERF_TRACE_CONCAT(a, b)     PERF_TRACE_CONCAT_(a, b)
+
+/** Begin an event that ends when the enclosing block is left */
+#define PERF_TRACE_SCOPE(name)                                                  \
+    const char *const PERF_TRACE_CONCAT(perf_trace_scope_, __LINE__)            \
+        __attribute__((cleanup(perf_trace_scope_end), unused)) =                \
+        (perf_trace_record((name), PERF_TRACE_PHASE_BEGIN), (name))
+
+#define PERF_TRACE_BEGIN(name)      perf_trace_record((name), PERF_TRACE_PHASE_BEGIN)
+#define PERF_TRACE_END(name)        perf_trace_record((name), PERF_TRACE_PHASE_END)
+#define PERF_TRACE_INSTANT(name)    perf_trace_record((name), PERF_TRACE_PHASE_INSTANT)
+
+#else
+
+#define PERF_TRACE_SCOPE(name)
+#define PERF_TRACE_BEGIN(name)      ((void)0)
+#define PERF_TRACE_END(name)        ((void)0)
+#define PERF_TRACE_INSTANT(name)    ((void)0)
+
+#endif /* PERF_TRACE_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_TRACE_H */
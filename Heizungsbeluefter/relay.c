@@ -3,11 +3,36 @@
  * @brief Relay control module implementation for ESP32-C6 Zigbee Fan Switch
  * 
  * This module implements GPIO-based relay control for switching a fan ON/OFF.
+ * 
+ * The state decision, GPIO write and journal update happen in one short
+ * critical section, so concurrent requests from the Zigbee task and the
+ * button task cannot both see a transition for the same change.
+ * 
+ * Deferred transitions are executed by a timer wheel timer. Only one
+ * transition can be pending: with two states it always leads away from the
+ * current one, so a newer request either keeps it or cancels it.
+ * 
+ * The lifetime counters are updated in the same critical section as the
+ * transition. Saving them to NVS happens in the timer_wheel task.
  */
 
 #include "relay.h"
+#include "event_trace.h"
+#include "perf_trace.h"
+#include "timer_wheel.h"
+#include "hw_profile.h"
 #include "driver/gpio.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include <string.h>
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#define APP_LOG_MODULE_LEVEL    RELAY_LOG_LEVEL
+#include "app_log.h"
 
 /* =============================================================================
  * Private Constants and Variables
@@ -15,8 +40,360 @@
 
 static const char *TAG = "RELAY";
 
-/** Current relay state (true = ON, false = OFF) */
-static bool s_relay_state = false;
+#define RELAY_JOURNAL_MASK      (RELAY_JOURNAL_SIZE - 1)
+
+#define RELAY_HOUR_MS           (3600UL * 1000UL)
+
+/** Current relay state */
+static relay_state_t s_relay_state = RELAY_STATE_OFF;
+
+/** Output register masks per relay_state_t, resolved from the hardware profile */
+static uint32_t s_set_mask[2];
+static uint32_t s_clr_mask[2];
+
+static relay_stats_t s_stats;
+
+/** Duplicates since the last transition, stored with the next journal entry */
+static uint32_t s_pending_duplicates = 0;
+
+static relay_journal_entry_t s_journal[RELAY_JOURNAL_SIZE];
+static uint16_t s_journal_head = 0;
+static uint16_t s_journal_count = 0;
+
+static relay_protection_t s_protection = {
+    .min_on_s = RELAY_DEFAULT_MIN_ON_S,
+    .min_off_s = RELAY_DEFAULT_MIN_OFF_S,
+    .max_switches_h = RELAY_DEFAULT_MAX_SWITCHES_H,
+};
+
+/** A transition away from s_relay_state is waiting for the lockout to end */
+static bool s_pending = false;
+static uint8_t s_pending_source = APP_EVENT_SRC_LOCAL;
+static timer_wheel_timer_t s_deferred_timer;
+
+static portMUX_TYPE s_relay_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define RELAY_COUNTERS_MAGIC    0x52434E54  /* "RCNT" */
+
+/** Lifetime counters of closed ON periods, plus the sub-second remainder */
+static relay_counters_t s_counters;
+static uint32_t s_runtime_rem_us = 0;
+static int64_t s_on_since_us = 0;
+
+/** Last state written to NVS */
+static relay_counters_t s_counters_saved;
+static int64_t s_counters_saved_us = 0;
+static timer_wheel_timer_t s_counters_timer;
+
+/** Mirror in RTC memory, survives every reset except power loss */
+typedef struct {
+    uint32_t magic;
+    relay_counters_t counters;
+    uint32_t check;
+} relay_rtc_counters_t;
+
+static RTC_NOINIT_ATTR relay_rtc_counters_t s_rtc_counters;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static inline void relay_gpio_write(relay_state_t state);
+static uint64_t relay_resolve_outputs(const hw_profile_t *profile);
+static void relay_journal_append(relay_state_t from, relay_state_t to, uint8_t source,
+                                 uint32_t now_ms);
+static uint32_t relay_lockout_ms(relay_state_t from, uint32_t now_ms);
+static void relay_publish_desired(bool on, app_event_source_t source);
+static void relay_reschedule_pending(void);
+static void relay_deferred_cb(void *arg);
+static uint32_t relay_counters_check(const relay_counters_t *counters);
+static void relay_counters_snapshot(relay_counters_t *counters, int64_t now_us);
+static void relay_counters_update(relay_state_t from, relay_state_t to, int64_t now_us);
+static void relay_counters_save(const relay_counters_t *counters);
+static void relay_counters_load(void);
+static void relay_counters_cb(void *arg);
+static void relay_counters_shutdown(void);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/** Drive all relay outputs to a state: one set and one clear register write */
+static inline void relay_gpio_write(relay_state_t state)
+{
+    REG_WRITE(GPIO_OUT_W1TS_REG, s_set_mask[state]);
+    REG_WRITE(GPIO_OUT_W1TC_REG, s_clr_mask[state]);
+}
+
+/**
+ * @brief Turn the outputs and polarities of the profile into register masks
+ * 
+ * @return Pin mask of the outputs for gpio_config()
+ */
+static uint64_t relay_resolve_outputs(const hw_profile_t *profile)
+{
+    uint32_t on_high = 0;
+    uint32_t on_low = 0;
+    
+    for (uint8_t i = 0; i < profile->output_count; i++) {
+        uint32_t bit = 1UL << profile->output_pins[i];
+        if (profile->output_active_high & (1U << i)) {
+            on_high |= bit;
+        } else {
+            on_low |= bit;
+        }
+    }
+    
+    s_set_mask[RELAY_STATE_ON] = on_high;
+    s_clr_mask[RELAY_STATE_ON] = on_low;
+    s_set_mask[RELAY_STATE_OFF] = on_low;
+    s_clr_mask[RELAY_STATE_OFF] = on_high;
+    
+    return (uint64_t)(on_high | on_low);
+}
+
+/** Called with s_relay_lock held */
+static void relay_journal_append(relay_state_t from, relay_state_t to, uint8_t source,
+                                 uint32_t now_ms)
+{
+    relay_journal_entry_t *entry = &s_journal[s_journal_head];
+    
+    entry->timestamp_ms = now_ms;
+    entry->from = (uint8_t)from;
+    entry->to = (uint8_t)to;
+    entry->source = source;
+    entry->duplicates = s_pending_duplicates > UINT8_MAX ? UINT8_MAX : (uint8_t)s_pending_duplicates;
+    
+    s_journal_head = (s_journal_head + 1) & RELAY_JOURNAL_MASK;
+    if (s_journal_count < RELAY_JOURNAL_SIZE) {
+        s_journal_count++;
+    }
+}
+
+/**
+ * @brief Time until a transition away from `from` is allowed
+ * 
+ * Called with s_relay_lock held.
+ * 
+ * @return 0 if the transition may happen now, else the remaining lockout
+ */
+static uint32_t relay_lockout_ms(relay_state_t from, uint32_t now_ms)
+{
+    uint32_t wait_ms = 0;
+    
+    /* How long the relay has been in its state before boot is unknown */
+    if (s_stats.transitions == 0) {
+        return 0;
+    }
+    
+    uint32_t min_ms = 1000UL * (from == RELAY_STATE_ON ? s_protection.min_on_s : s_protection.min_off_s);
+    uint32_t since_ms = now_ms - s_stats.last_change_ms;
+    if (since_ms < min_ms) {
+        wait_ms = min_ms - since_ms;
+    }
+    
+    /* The max-th newest transition has to leave the one-hour window first */
+    uint8_t max = s_protection.max_switches_h;
+    if (max > 0 && s_journal_count >= max) {
+        const relay_journal_entry_t *entry = &s_journal[(s_journal_head - max) & RELAY_JOURNAL_MASK];
+        uint32_t age_ms = now_ms - entry->timestamp_ms;
+        if (age_ms < RELAY_HOUR_MS && RELAY_HOUR_MS - age_ms > wait_ms) {
+            wait_ms = RELAY_HOUR_MS - age_ms;
+        }
+    }
+    
+    return wait_ms;
+}
+
+static void relay_publish_desired(bool on, app_event_source_t source)
+{
+    app_event_t event = {
+        .type = APP_EVENT_RELAY_DESIRED,
+        .source = source,
+        .relay = { .on = on, .timestamp_us = 0 },
+    };
+    app_event_publish(&event);
+}
+
+/**
+ * @brief Switch the pending transition if allowed, else re-arm its timer
+ * 
+ * Not a new request, so nothing is counted as deferred or collapsed.
+ */
+static void relay_reschedule_pending(void)
+{
+    portENTER_CRITICAL(&s_relay_lock);
+    bool pending = s_pending;
+    relay_state_t from = s_relay_state;
+    app_event_source_t source = (app_event_source_t)s_pending_source;
+    uint32_t wait_ms = pending ? relay_lockout_ms(from, esp_log_timestamp()) : 0;
+    portEXIT_CRITICAL(&s_relay_lock);
+    
+    if (!pending) {
+        return;
+    }
+    if (wait_ms > 0) {
+        /* +1 ms: esp_log_timestamp() truncates */
+        timer_wheel_arm(&s_deferred_timer, wait_ms + 1, relay_deferred_cb, NULL);
+        APP_LOGD("Pending transition in %lu ms", (unsigned long)wait_ms);
+        return;
+    }
+    relay_set_from(from != RELAY_STATE_ON, source);
+}
+
+/**
+ * @brief Lockout over: retry the pending transition (timer_wheel task)
+ */
+static void relay_deferred_cb(void *arg)
+{
+    (void)arg;
+    
+    relay_reschedule_pending();
+}
+
+static uint32_t relay_counters_check(const relay_counters_t *counters)
+{
+    return ~(counters->runtime_s ^ (counters->cycles * 2654435761UL));
+}
+
+/** Counters including the running ON period, called with s_relay_lock held */
+static void relay_counters_snapshot(relay_counters_t *counters, int64_t now_us)
+{
+    *counters = s_counters;
+    if (s_relay_state == RELAY_STATE_ON) {
+        counters->runtime_s += (uint32_t)((now_us - s_on_since_us + s_runtime_rem_us) / 1000000);
+    }
+}
+
+/** Account a transition and refresh the RTC mirror, called with s_relay_lock held */
+static void relay_counters_update(relay_state_t from, relay_state_t to, int64_t now_us)
+{
+    if (to == RELAY_STATE_ON) {
+        s_counters.cycles++;
+        s_on_since_us = now_us;
+    } else if (from == RELAY_STATE_ON) {
+        uint64_t on_us = (uint64_t)(now_us - s_on_since_us) + s_runtime_rem_us;
+        s_counters.runtime_s += (uint32_t)(on_us / 1000000);
+        s_runtime_rem_us = (uint32_t)(on_us % 1000000);
+    }
+    
+    s_rtc_counters.counters = s_counters;
+    s_rtc_counters.check = relay_counters_check(&s_counters);
+    s_rtc_counters.magic = RELAY_COUNTERS_MAGIC;
+}
+
+static void relay_counters_save(const relay_counters_t *counters)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(RELAY_COUNTERS_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, RELAY_COUNTERS_NVS_KEY, counters, sizeof(*counters));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        APP_LOGW("Failed to store counters: %s", esp_err_to_name(ret));
+        return;
+    }
+    
+    s_counters_saved = *counters;
+    s_counters_saved_us = esp_timer_get_time();
+    APP_LOGD("Counters saved: %lu s on, %lu cycles",
+             (unsigned long)counters->runtime_s, (unsigned long)counters->cycles);
+}
+
+/**
+ * @brief Load the counters from NVS, or from the RTC mirror if it is newer
+ * 
+ * The mirror is only newer after a reset without a save before it, i.e. a
+ * brown-out, watchdog or panic reset; it is written to NVS right away.
+ */
+static void relay_counters_load(void)
+{
+    nvs_handle_t handle;
+    size_t size = sizeof(s_counters);
+    
+    esp_err_t ret = nvs_open(RELAY_COUNTERS_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, RELAY_COUNTERS_NVS_KEY, &s_counters, &size);
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK || size != sizeof(s_counters)) {
+        memset(&s_counters, 0, sizeof(s_counters));
+    }
+    s_counters_saved = s_counters;
+    
+    const relay_counters_t *rtc = &s_rtc_counters.counters;
+    if (esp_reset_reason() != ESP_RST_POWERON && s_rtc_counters.magic == RELAY_COUNTERS_MAGIC &&
+        s_rtc_counters.check == relay_counters_check(rtc) &&
+        rtc->runtime_s >= s_counters.runtime_s && rtc->cycles >= s_counters.cycles &&
+        (rtc->runtime_s != s_counters.runtime_s || rtc->cycles != s_counters.cycles)) {
+        APP_LOGW("Counters recovered after reset (reason %d): +%lu s, +%lu cycles",
+                 esp_reset_reason(), (unsigned long)(rtc->runtime_s - s_counters.runtime_s),
+                 (unsigned long)(rtc->cycles - s_counters.cycles));
+        s_counters = *rtc;
+        relay_counters_save(&s_counters);
+    }
+    
+    s_rtc_counters.counters = s_counters;
+    s_rtc_counters.check = relay_counters_check(&s_counters);
+    s_rtc_counters.magic = RELAY_COUNTERS_MAGIC;
+}
+
+/**
+ * @brief Refresh the RTC mirror and save to NVS when due (timer_wheel task)
+ * 
+ * Runs after every transition and every RELAY_COUNTERS_RTC_INTERVAL_MS
+ * while ON. NVS is written at most once per RELAY_COUNTERS_SAVE_INTERVAL_MS.
+ */
+static void relay_counters_cb(void *arg)
+{
+    (void)arg;
+    relay_counters_t counters;
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&s_relay_lock);
+    relay_counters_snapshot(&counters, now_us);
+    bool on = s_relay_state == RELAY_STATE_ON;
+    s_rtc_counters.counters = counters;
+    s_rtc_counters.check = relay_counters_check(&counters);
+    portEXIT_CRITICAL(&s_relay_lock);
+    
+    bool dirty = counters.runtime_s != s_counters_saved.runtime_s ||
+                 counters.cycles != s_counters_saved.cycles;
+    uint32_t since_save_ms = (uint32_t)((now_us - s_counters_saved_us) / 1000);
+    if (dirty && since_save_ms >= RELAY_COUNTERS_SAVE_INTERVAL_MS) {
+        relay_counters_save(&counters);
+        dirty = false;
+        since_save_ms = 0;
+    }
+    
+    if (on) {
+        timer_wheel_arm(&s_counters_timer, RELAY_COUNTERS_RTC_INTERVAL_MS, relay_counters_cb, NULL);
+    } else if (dirty) {
+        timer_wheel_arm(&s_counters_timer, RELAY_COUNTERS_SAVE_INTERVAL_MS - since_save_ms,
+                        relay_counters_cb, NULL);
+    }
+}
+
+/**
+ * @brief Save unsaved counters before a software restart
+ */
+static void relay_counters_shutdown(void)
+{
+    relay_counters_t counters;
+    
+    portENTER_CRITICAL(&s_relay_lock);
+    relay_counters_snapshot(&counters, esp_timer_get_time());
+    portEXIT_CRITICAL(&s_relay_lock);
+    
+    if (counters.runtime_s != s_counters_saved.runtime_s || counters.cycles != s_counters_saved.cycles) {
+        relay_counters_save(&counters);
+    }
+}
 
 /* =============================================================================
  * Public Function Implementations
@@ -24,11 +401,18 @@ static bool s_relay_state = false;
 
 esp_err_t relay_init(void)
 {
-    ESP_LOGI(TAG, "Initializing relay on GPIO%d", RELAY_GPIO_PIN);
+    const hw_profile_t *profile = hw_profile_get();
+    uint64_t pins = relay_resolve_outputs(profile);
+    
+    APP_LOGI("Initializing relay on %u output(s), GPIO mask 0x%08lx",
+             profile->output_count, (unsigned long)pins);
+    
+    /* Latch OFF before the pins become outputs, so they never glitch ON */
+    relay_gpio_write(RELAY_STATE_OFF);
     
     /* Configure GPIO as output */
     gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << RELAY_GPIO_PIN),
+        .pin_bit_mask = pins,
         .mode = GPIO_MODE_OUTPUT,
         .pull_up_en = GPIO_PULLUP_DISABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
@@ -37,54 +421,201 @@ esp_err_t relay_init(void)
     
     esp_err_t ret = gpio_config(&io_conf);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to configure GPIO%d: %s", RELAY_GPIO_PIN, esp_err_to_name(ret));
+        APP_LOGE("Failed to configure relay outputs: %s", esp_err_to_name(ret));
         return ret;
     }
     
+    relay_counters_load();
+    if (esp_register_shutdown_handler(relay_counters_shutdown) != ESP_OK) {
+        APP_LOGW("Counters are not saved on restart");
+    }
+    APP_LOGI("Lifetime: %lu h on, %lu switch cycles",
+             (unsigned long)(s_counters.runtime_s / 3600), (unsigned long)s_counters.cycles);
+    
     /* Set initial state to OFF (failsafe - fan should not start unexpectedly) */
-    s_relay_state = false;
+    s_relay_state = RELAY_STATE_OFF;
     
     /* Apply the initial state to GPIO */
-    uint32_t level = RELAY_ACTIVE_LEVEL ? 0 : 1;  /* OFF state */
-    gpio_set_level(RELAY_GPIO_PIN, level);
+    relay_gpio_write(RELAY_STATE_OFF);
     
-    ESP_LOGI(TAG, "Relay initialized - initial state: OFF (failsafe)");
+    APP_LOGI("Relay initialized - initial state: OFF (failsafe)");
     
     return ESP_OK;
 }
 
 void relay_set(bool on)
 {
-    /* Calculate the GPIO level based on active level configuration */
-    uint32_t level;
+    relay_set_from(on, APP_EVENT_SRC_LOCAL);
+}
+
+relay_result_t relay_set_from(bool on, app_event_source_t source)
+{
+    PERF_TRACE_SCOPE("relay_set");
+    
+    relay_state_t target = on ? RELAY_STATE_ON : RELAY_STATE_OFF;
+    uint32_t now_ms = esp_log_timestamp();
+    uint32_t switched_us = 0;
     
-    if (RELAY_ACTIVE_LEVEL) {
-        /* Active-high: HIGH = ON, LOW = OFF */
-        level = on ? 1 : 0;
-    } else {
-        /* Active-low: LOW = ON, HIGH = OFF */
-        level = on ? 0 : 1;
+    portENTER_CRITICAL(&s_relay_lock);
+    relay_state_t from = s_relay_state;
+    if (from == target) {
+        /* No-op transition: no GPIO write, no event; drops a pending transition */
+        bool cancelled = s_pending;
+        s_pending = false;
+        s_stats.duplicates++;
+        s_pending_duplicates++;
+        if (cancelled) {
+            s_stats.collapsed++;
+        }
+        portEXIT_CRITICAL(&s_relay_lock);
+        
+        if (cancelled) {
+            timer_wheel_cancel(&s_deferred_timer);
+            APP_LOGI("Pending transition cancelled, relay stays %s", on ? "ON" : "OFF");
+            relay_publish_desired(on, source);
+        } else {
+            APP_LOGD("Relay already %s, duplicate request ignored", on ? "ON" : "OFF");
+        }
+        return RELAY_RESULT_DUPLICATE;
     }
     
+    uint32_t wait_ms = relay_lockout_ms(from, now_ms);
+    if (wait_ms > 0) {
+        /* Keep one pending transition, owned by the latest request */
+        bool was_pending = s_pending;
+        if (was_pending) {
+            s_stats.collapsed++;
+        }
+        s_pending = true;
+        s_pending_source = (uint8_t)source;
+        s_stats.deferred++;
+        portEXIT_CRITICAL(&s_relay_lock);
+        
+        /* +1 ms: esp_log_timestamp() truncates */
+        timer_wheel_arm(&s_deferred_timer, wait_ms + 1, relay_deferred_cb, NULL);
+        
+        APP_LOGI("Relay %s deferred by %lu ms (short-cycle protection)",
+                 on ? "ON" : "OFF", (unsigned long)wait_ms);
+        if (!was_pending) {
+            relay_publish_desired(on, source);
+        }
+        return RELAY_RESULT_DEFERRED;
+    }
+    s_pending = false;
+    
     /* Apply to GPIO */
-    gpio_set_level(RELAY_GPIO_PIN, level);
+    relay_gpio_write(target);
+    int64_t now_us = esp_timer_get_time();
+    switched_us = (uint32_t)now_us;
+    
+    relay_counters_update(from, target, now_us);
+    s_relay_state = target;
+    relay_journal_append(from, target, (uint8_t)source, now_ms);
+    s_pending_duplicates = 0;
+    s_stats.transitions++;
+    s_stats.last_change_ms = now_ms;
+    portEXIT_CRITICAL(&s_relay_lock);
+    
+    /* Counter bookkeeping off the switching path */
+    timer_wheel_arm(&s_counters_timer, 0, relay_counters_cb, NULL);
+    
+    PERF_TRACE_INSTANT(on ? "relay_gpio_on" : "relay_gpio_off");
+    event_trace_log(EVT_RELAY, on, 0);
     
-    /* Update state tracking */
-    s_relay_state = on;
+    APP_LOGI("Relay set to %s", on ? "ON" : "OFF");
     
-    ESP_LOGI(TAG, "Relay set to %s (GPIO%d = %lu)", 
-             on ? "ON" : "OFF", RELAY_GPIO_PIN, level);
+    /* Notify subscribers (Zigbee attribute, ...) */
+    app_event_t event = {
+        .type = APP_EVENT_RELAY_CHANGED,
+        .source = source,
+        .relay = { .on = on, .timestamp_us = switched_us },
+    };
+    app_event_publish(&event);
+    
+    return RELAY_RESULT_SWITCHED;
 }
 
 void relay_toggle(void)
 {
-    /* Invert current state */
-    relay_set(!s_relay_state);
+    /* Invert the desired state: cancels a pending transition */
+    bool on = !relay_get_desired_state();
+    relay_result_t result = relay_set_from(on, APP_EVENT_SRC_LOCAL);
     
-    ESP_LOGI(TAG, "Relay toggled to %s", s_relay_state ? "ON" : "OFF");
+    APP_LOGI("Relay toggled to %s%s", on ? "ON" : "OFF",
+             result == RELAY_RESULT_DEFERRED ? " (deferred)" : "");
 }
 
 bool relay_get_state(void)
 {
-    return s_relay_state;
+    return s_relay_state == RELAY_STATE_ON;
+}
+
+bool relay_get_desired_state(void)
+{
+    portENTER_CRITICAL(&s_relay_lock);
+    bool on = (s_relay_state == RELAY_STATE_ON) != s_pending;
+    portEXIT_CRITICAL(&s_relay_lock);
+    
+    return on;
+}
+
+void relay_set_protection(const relay_protection_t *protection)
+{
+    relay_protection_t clamped = *protection;
+    
+    if (clamped.min_on_s > RELAY_MIN_TIME_MAX_S) {
+        clamped.min_on_s = RELAY_MIN_TIME_MAX_S;
+    }
+    if (clamped.min_off_s > RELAY_MIN_TIME_MAX_S) {
+        clamped.min_off_s = RELAY_MIN_TIME_MAX_S;
+    }
+    if (clamped.max_switches_h > RELAY_MAX_SWITCHES_H_LIMIT) {
+        clamped.max_switches_h = RELAY_MAX_SWITCHES_H_LIMIT;
+    }
+    
+    portENTER_CRITICAL(&s_relay_lock);
+    s_protection = clamped;
+    portEXIT_CRITICAL(&s_relay_lock);
+    
+    APP_LOGI("Protection: min on %u s, min off %u s, max %u switches/h",
+             clamped.min_on_s, clamped.min_off_s, clamped.max_switches_h);
+    
+    /* The lockout of a pending transition may have changed */
+    relay_reschedule_pending();
+}
+
+void relay_get_protection(relay_protection_t *protection)
+{
+    portENTER_CRITICAL(&s_relay_lock);
+    *protection = s_protection;
+    portEXIT_CRITICAL(&s_relay_lock);
+}
+
+void relay_get_stats(relay_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_relay_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_relay_lock);
+}
+
+void relay_get_counters(relay_counters_t *counters)
+{
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&s_relay_lock);
+    relay_counters_snapshot(counters, now_us);
+    portEXIT_CRITICAL(&s_relay_lock);
+}
+
+size_t relay_journal_copy(relay_journal_entry_t *entries, size_t max_entries)
+{
+    portENTER_CRITICAL(&s_relay_lock);
+    size_t count = s_journal_count < max_entries ? s_journal_count : max_entries;
+    uint16_t first = (s_journal_head - count) & RELAY_JOURNAL_MASK;
+    for (size_t n = 0; n < count; n++) {
+        entries[n] = s_journal[(first + n) & RELAY_JOURNAL_MASK];
+    }
+    portEXIT_CRITICAL(&s_relay_lock);
+    
+    return count;
 }
@@ -6,20 +6,45 @@
  * The relay is used to switch a 230V fan ON/OFF.
  * 
  * Hardware Configuration:
- *   - GPIO8 is used as the default relay control pin
- *   - HIGH level (1) = Relay ON = Fan running
- *   - LOW level (0) = Relay OFF = Fan stopped
+ *   - Output pins and polarity come from the hardware profile (hw_profile.h),
+ *     up to HW_PROFILE_MAX_OUTPUTS outputs switched together
+ *   - Default: GPIO8, HIGH level (1) = Relay ON = Fan running
+ *   - relay_init() resolves the profile into GPIO set/clear masks per state,
+ *     so a transition is two register writes without per-pin branches
  * 
  * Note: Most relay modules are active-low (LOW = relay energized), but we assume
- *       active-high logic here. If your relay module is active-low, change
- *       RELAY_ACTIVE_LEVEL to 0.
+ *       active-high logic by default. For an active-low module, store a
+ *       hardware profile with the output's active-high bit cleared.
+ * 
+ * State machine:
+ *   The relay has two states, OFF and ON. A request for the current state is
+ *   a no-op: it is counted as a duplicate and touches neither the GPIO nor
+ *   the subscribers. Real transitions are recorded in a small journal with
+ *   timestamps and published as APP_EVENT_RELAY_CHANGED.
+ * 
+ * Short-cycle protection:
+ *   A transition that would violate the minimum on-time, the minimum
+ *   off-time or the switch limit per hour is deferred until it is allowed.
+ *   Further requests during the lockout collapse into one pending transition
+ *   to the latest desired state; requesting the current state cancels it.
+ *   Deferrals and cancellations are published as APP_EVENT_RELAY_DESIRED.
+ *   The limits do not apply to the first transition after boot.
+ * 
+ * Lifetime counters:
+ *   Total ON time and switch cycles (OFF -> ON) are counted in RAM and
+ *   mirrored to RTC memory, which survives brown-out and watchdog resets.
+ *   NVS is written at most every RELAY_COUNTERS_SAVE_INTERVAL_MS, before a
+ *   software restart, and at boot after a brown-out (from the RTC mirror).
  */
 
 #ifndef RELAY_H
 #define RELAY_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
+#include "app_event.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,22 +55,118 @@ extern "C" {
  * ============================================================================= */
 
 /**
- * @brief GPIO pin number for relay control
+ * @brief Default GPIO pin number for relay control (no hardware profile stored)
  * 
  * GPIO8 is chosen because:
  *   - It's a general-purpose GPIO on ESP32-C6
  *   - No special boot-time functions
  *   - Directly accessible on most DevKit boards
  */
-#define RELAY_GPIO_PIN          8
+#define RELAY_DEFAULT_GPIO_PIN      8
 
 /**
- * @brief Active level for relay
+ * @brief Default active level for relay (no hardware profile stored)
  * 
  * Set to 1 for active-high relay modules (HIGH = relay energized)
  * Set to 0 for active-low relay modules (LOW = relay energized)
  */
-#define RELAY_ACTIVE_LEVEL      1
+#define RELAY_DEFAULT_ACTIVE_LEVEL  1
+
+/**
+ * @brief Number of transitions kept in the journal (power of two)
+ */
+#define RELAY_JOURNAL_SIZE      32
+
+/*
+ * The short-cycle protection is off by default, so the relay follows every
+ * command at once as before. Enable it through the Relay Settings cluster
+ * (relay_settings.h); 30 s / 30 s / 20 per hour suit most fan motors.
+ */
+
+/** @brief Default minimum time the relay stays ON (seconds, 0 = no limit) */
+#define RELAY_DEFAULT_MIN_ON_S          0
+
+/** @brief Default minimum time the relay stays OFF (seconds, 0 = no limit) */
+#define RELAY_DEFAULT_MIN_OFF_S         0
+
+/** @brief Default switch limit per hour (0 = no limit) */
+#define RELAY_DEFAULT_MAX_SWITCHES_H    0
+
+/** @brief Upper bound for the minimum on/off times */
+#define RELAY_MIN_TIME_MAX_S            3600
+
+/** @brief Upper bound for the switch limit (counted from the journal) */
+#define RELAY_MAX_SWITCHES_H_LIMIT      RELAY_JOURNAL_SIZE
+
+/** @brief Shortest time between two NVS writes of the lifetime counters */
+#define RELAY_COUNTERS_SAVE_INTERVAL_MS (30UL * 60UL * 1000UL)
+
+/** @brief Runtime update of the RTC mirror while the relay is ON */
+#define RELAY_COUNTERS_RTC_INTERVAL_MS  60000
+
+/** @brief NVS namespace and key of the lifetime counters */
+#define RELAY_COUNTERS_NVS_NAMESPACE    "relay"
+#define RELAY_COUNTERS_NVS_KEY          "counters"
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Relay states
+ */
+typedef enum {
+    RELAY_STATE_OFF = 0,
+    RELAY_STATE_ON = 1,
+} relay_state_t;
+
+/**
+ * @brief Lifetime counters (persistent)
+ */
+typedef struct {
+    uint32_t runtime_s;             /**< Total time the relay was ON */
+    uint32_t cycles;                /**< OFF -> ON transitions */
+} relay_counters_t;
+
+/**
+ * @brief Outcome of a state request
+ */
+typedef enum {
+    RELAY_RESULT_SWITCHED = 0,  /**< Transition executed */
+    RELAY_RESULT_DUPLICATE,     /**< Already in the requested state, nothing done */
+    RELAY_RESULT_DEFERRED,      /**< Lockout active, transition pending */
+} relay_result_t;
+
+/**
+ * @brief Short-cycle protection settings
+ */
+typedef struct {
+    uint16_t min_on_s;          /**< Minimum ON time in seconds, 0 = off */
+    uint16_t min_off_s;         /**< Minimum OFF time in seconds, 0 = off */
+    uint8_t max_switches_h;     /**< Transitions per rolling hour, 0 = off */
+} relay_protection_t;
+
+/**
+ * @brief One journal entry (8 bytes)
+ */
+typedef struct {
+    uint32_t timestamp_ms;      /**< Milliseconds since boot */
+    uint8_t from;               /**< relay_state_t */
+    uint8_t to;                 /**< relay_state_t */
+    uint8_t source;             /**< app_event_source_t */
+    uint8_t duplicates;         /**< Duplicates suppressed before this transition (saturating) */
+} relay_journal_entry_t;
+
+/**
+ * @brief Relay counters
+ */
+typedef struct {
+    uint32_t transitions;       /**< Real state changes */
+    uint32_t duplicates;        /**< Suppressed no-op requests */
+    uint32_t deferred;          /**< Requests delayed by the protection */
+    uint32_t collapsed;         /**< Pending transitions replaced or cancelled by a newer request */
+    uint32_t last_change_ms;    /**< Time of the last transition */
+} relay_stats_t;
 
 /* =============================================================================
  * Public Functions
@@ -54,8 +175,10 @@ extern "C" {
 /**
  * @brief Initialize the relay GPIO
  * 
- * Configures the relay GPIO as output and sets initial state to OFF (failsafe).
- * Must be called once at startup before using other relay functions.
+ * Configures the relay GPIOs of the hardware profile as outputs and sets
+ * initial state to OFF (failsafe). Must be called once at startup before
+ * using other relay functions. Loads the lifetime counters, so call it
+ * after nvs_flash_init() and hw_profile_init().
  * 
  * @return ESP_OK on success, ESP_FAIL on error
  */
@@ -64,14 +187,31 @@ esp_err_t relay_init(void);
 /**
  * @brief Set the relay state
  * 
+ * Publishes APP_EVENT_RELAY_CHANGED with source APP_EVENT_SRC_LOCAL, so the
+ * Zigbee On/Off attribute follows local changes.
+ * 
  * @param on true = Relay ON (fan running), false = Relay OFF (fan stopped)
  */
 void relay_set(bool on);
 
+/**
+ * @brief Set the relay state on behalf of a given source
+ * 
+ * Same as relay_set(), but the published event carries the given source.
+ * Subscribers use it to avoid echoing a change back to where it came from.
+ * 
+ * @param on true = Relay ON (fan running), false = Relay OFF (fan stopped)
+ * @param source Origin of the change
+ * @return RELAY_RESULT_SWITCHED, RELAY_RESULT_DUPLICATE if the relay already
+ *         was in that state, RELAY_RESULT_DEFERRED if a lockout delays it
+ */
+relay_result_t relay_set_from(bool on, app_event_source_t source);
+
 /**
  * @brief Toggle the relay state
  * 
- * Switches the relay from ON to OFF or from OFF to ON.
+ * Switches the relay from ON to OFF or from OFF to ON. While a transition
+ * is pending, toggling cancels it instead.
  */
 void relay_toggle(void);
 
@@ -82,6 +222,53 @@ void relay_toggle(void);
  */
 bool relay_get_state(void);
 
+/**
+ * @brief Get the state the relay is in or is heading to
+ * 
+ * @return Pending target if a transition is deferred, else the current state
+ */
+bool relay_get_desired_state(void);
+
+/**
+ * @brief Set the short-cycle protection
+ * 
+ * Values are clamped to RELAY_MIN_TIME_MAX_S and RELAY_MAX_SWITCHES_H_LIMIT.
+ * A pending transition is re-evaluated with the new settings.
+ * 
+ * @param protection New settings
+ */
+void relay_set_protection(const relay_protection_t *protection);
+
+/**
+ * @brief Get the short-cycle protection
+ * 
+ * @param[out] protection Destination
+ */
+void relay_get_protection(relay_protection_t *protection);
+
+/**
+ * @brief Get the transition and duplicate counters
+ * 
+ * @param[out] stats Destination
+ */
+void relay_get_stats(relay_stats_t *stats);
+
+/**
+ * @brief Get the lifetime counters, including the current ON period
+ * 
+ * @param[out] counters Destination
+ */
+void relay_get_counters(relay_counters_t *counters);
+
+/**
+ * @brief Copy the newest journal entries, oldest first
+ * 
+ * @param[out] entries Destination array
+ * @param max_entries Capacity of entries
+ * @return Number of entries copied
+ */
+size_t relay_journal_copy(relay_journal_entry_t *entries, size_t max_entries);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,214 @@
+/**
+ * @file relay_settings.c
+ * @brief Short-cycle protection settings implementation
+ *
+ * Attribute writes arrive as APP_EVENT_ZB_ATTR_WRITTEN in the Zigbee task,
+ * which may set attributes directly. Counter updates come from relay
+ * events and the timer wheel in other tasks and take the Zigbee lock.
+ */
+
+#include "relay_settings.h"
+#include "relay.h"
+#include "app_event.h"
+#include "zigbee_handler.h"
+#include "timer_wheel.h"
+#include "zcl_codec.h"
+#include "nvs.h"
+#define APP_LOG_MODULE_LEVEL    RELAY_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "RELAY_CFG";
+
+/** Attribute start values, loaded before the endpoint is created */
+static uint16_t s_attr_min_on = RELAY_DEFAULT_MIN_ON_S;
+static uint16_t s_attr_min_off = RELAY_DEFAULT_MIN_OFF_S;
+static uint8_t s_attr_max_switches = RELAY_DEFAULT_MAX_SWITCHES_H;
+static uint32_t s_attr_runtime_h = 0;
+static uint32_t s_attr_cycles = 0;
+
+static timer_wheel_timer_t s_counters_timer;
+
+#define RELAY_SETTINGS_ACCESS_REPORTED  (ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING)
+
+const zb_ep_attr_desc_t relay_settings_zcl_attrs[RELAY_SETTINGS_ZCL_ATTR_COUNT] = {
+    { RELAY_SETTINGS_ATTR_MIN_ON_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &s_attr_min_on },
+    { RELAY_SETTINGS_ATTR_MIN_OFF_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &s_attr_min_off },
+    { RELAY_SETTINGS_ATTR_MAX_SWITCHES_ID, ESP_ZB_ZCL_ATTR_TYPE_U8, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &s_attr_max_switches },
+    { RELAY_SETTINGS_ATTR_RUNTIME_H_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, RELAY_SETTINGS_ACCESS_REPORTED, &s_attr_runtime_h },
+    { RELAY_SETTINGS_ATTR_CYCLES_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, RELAY_SETTINGS_ACCESS_REPORTED, &s_attr_cycles },
+};
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void relay_settings_save(const relay_protection_t *protection);
+static void relay_settings_set_attr(uint16_t attr_id, void *value);
+static void relay_settings_on_attr_written(const app_event_t *event, void *ctx);
+static void relay_settings_update_counters(void);
+static void relay_settings_on_relay_changed(const app_event_t *event, void *ctx);
+static void relay_settings_counters_cb(void *arg);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static void relay_settings_save(const relay_protection_t *protection)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(RELAY_SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, RELAY_SETTINGS_NVS_KEY, protection, sizeof(*protection));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        APP_LOGW("Failed to store settings: %s", esp_err_to_name(ret));
+    }
+}
+
+static void relay_settings_set_attr(uint16_t attr_id, void *value)
+{
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(
+        ZIGBEE_ENDPOINT, RELAY_SETTINGS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        attr_id, value, false);
+
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        APP_LOGW("Failed to set attribute 0x%04x, status: 0x%x", attr_id, status);
+    }
+}
+
+/**
+ * @brief Apply, clamp and store a written setting (Zigbee task)
+ */
+static void relay_settings_on_attr_written(const app_event_t *event, void *ctx)
+{
+    (void)ctx;
+
+    if (event->zcl.cluster != RELAY_SETTINGS_CLUSTER_ID || !event->zcl.value) {
+        return;
+    }
+
+    relay_protection_t protection;
+    uint32_t value;
+
+    if (zcl_codec_read_uint(event->zcl.attr_type, event->zcl.value, &value) != ESP_OK) {
+        return;
+    }
+    relay_get_protection(&protection);
+
+    /* Out-of-range values are clamped by the relay */
+    switch (event->zcl.attr_id) {
+        case RELAY_SETTINGS_ATTR_MIN_ON_ID:
+            protection.min_on_s = value > UINT16_MAX ? UINT16_MAX : (uint16_t)value;
+            break;
+        case RELAY_SETTINGS_ATTR_MIN_OFF_ID:
+            protection.min_off_s = value > UINT16_MAX ? UINT16_MAX : (uint16_t)value;
+            break;
+        case RELAY_SETTINGS_ATTR_MAX_SWITCHES_ID:
+            protection.max_switches_h = value > UINT8_MAX ? UINT8_MAX : (uint8_t)value;
+            break;
+        default:
+            return;
+    }
+
+    relay_set_protection(&protection);
+
+    /* Write back what the relay accepted */
+    relay_protection_t applied;
+    relay_get_protection(&applied);
+    if (applied.min_on_s != protection.min_on_s) {
+        relay_settings_set_attr(RELAY_SETTINGS_ATTR_MIN_ON_ID, &applied.min_on_s);
+    }
+    if (applied.min_off_s != protection.min_off_s) {
+        relay_settings_set_attr(RELAY_SETTINGS_ATTR_MIN_OFF_ID, &applied.min_off_s);
+    }
+    if (applied.max_switches_h != protection.max_switches_h) {
+        relay_settings_set_attr(RELAY_SETTINGS_ATTR_MAX_SWITCHES_ID, &applied.max_switches_h);
+    }
+
+    relay_settings_save(&applied);
+}
+
+/**
+ * @brief Copy the lifetime counters into the attributes (any task)
+ */
+static void relay_settings_update_counters(void)
+{
+    relay_counters_t counters;
+    relay_get_counters(&counters);
+
+    uint32_t runtime_h = counters.runtime_s / 3600;
+    uint32_t cycles = counters.cycles;
+
+    bool locked = zigbee_handler_lock();
+    relay_settings_set_attr(RELAY_SETTINGS_ATTR_RUNTIME_H_ID, &runtime_h);
+    relay_settings_set_attr(RELAY_SETTINGS_ATTR_CYCLES_ID, &cycles);
+    zigbee_handler_unlock(locked);
+}
+
+static void relay_settings_on_relay_changed(const app_event_t *event, void *ctx)
+{
+    (void)event;
+    (void)ctx;
+    relay_settings_update_counters();
+}
+
+/** Runtime grows between relay changes (timer_wheel task) */
+static void relay_settings_counters_cb(void *arg)
+{
+    (void)arg;
+    relay_settings_update_counters();
+    timer_wheel_arm(&s_counters_timer, RELAY_SETTINGS_COUNTERS_UPDATE_MS, relay_settings_counters_cb, NULL);
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t relay_settings_init(void)
+{
+    relay_protection_t protection;
+    nvs_handle_t handle;
+    size_t size = sizeof(protection);
+
+    relay_get_protection(&protection);
+
+    esp_err_t ret = nvs_open(RELAY_SETTINGS_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, RELAY_SETTINGS_NVS_KEY, &protection, &size);
+        nvs_close(handle);
+    }
+
+    if (ret == ESP_OK && size == sizeof(protection)) {
+        relay_set_protection(&protection);
+    } else {
+        /* First boot or older layout: keep the defaults */
+        APP_LOGI("No stored settings, using defaults");
+    }
+
+    relay_get_protection(&protection);
+    s_attr_min_on = protection.min_on_s;
+    s_attr_min_off = protection.min_off_s;
+    s_attr_max_switches = protection.max_switches_h;
+
+    relay_counters_t counters;
+    relay_get_counters(&counters);
+    s_attr_runtime_h = counters.runtime_s / 3600;
+    s_attr_cycles = counters.cycles;
+    timer_wheel_arm(&s_counters_timer, RELAY_SETTINGS_COUNTERS_UPDATE_MS, relay_settings_counters_cb, NULL);
+
+    ret = app_event_subscribe(APP_EVENT_MASK(APP_EVENT_RELAY_CHANGED), relay_settings_on_relay_changed, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return app_event_subscribe(APP_EVENT_MASK(APP_EVENT_ZB_ATTR_WRITTEN),
+                               relay_settings_on_attr_written, NULL);
+}
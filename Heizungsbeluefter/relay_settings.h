@@ -0,0 +1,75 @@
+/**
+ * @file relay_settings.h
+ * @brief Short-cycle protection settings for ESP32-C6 Zigbee Fan Switch
+ *
+ * Exposes the relay protection (see relay.h) as writable attributes of a
+ * manufacturer-specific cluster on the fan endpoint and keeps it in NVS, so
+ * settings written from Zigbee2MQTT survive reboots.
+ *
+ * Manufacturer-specific Relay Settings cluster (RELAY_SETTINGS_CLUSTER_ID):
+ *   0x0000  Minimum ON time            (uint16, seconds, read/write)
+ *   0x0001  Minimum OFF time           (uint16, seconds, read/write)
+ *   0x0002  Maximum switches per hour  (uint8, read/write, 0 = no limit)
+ *   0x0010  Runtime                    (uint32, hours, read-only, reportable)
+ *   0x0011  Switch cycles              (uint32, OFF -> ON, read-only, reportable)
+ *
+ * Out-of-range writes are clamped and the clamped value is written back.
+ * The lifetime counters (see relay.h) are copied into the attributes on
+ * every relay change and every RELAY_SETTINGS_COUNTERS_UPDATE_MS.
+ */
+
+#ifndef RELAY_SETTINGS_H
+#define RELAY_SETTINGS_H
+
+#include "esp_err.h"
+#include "zb_endpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Manufacturer-specific Relay Settings cluster ID */
+#define RELAY_SETTINGS_CLUSTER_ID           0xFC11
+
+/* Relay Settings cluster attribute IDs */
+#define RELAY_SETTINGS_ATTR_MIN_ON_ID       0x0000
+#define RELAY_SETTINGS_ATTR_MIN_OFF_ID      0x0001
+#define RELAY_SETTINGS_ATTR_MAX_SWITCHES_ID 0x0002
+#define RELAY_SETTINGS_ATTR_RUNTIME_H_ID    0x0010
+#define RELAY_SETTINGS_ATTR_CYCLES_ID       0x0011
+
+#define RELAY_SETTINGS_ZCL_ATTR_COUNT       5
+
+/** @brief Refresh interval of the counter attributes */
+#define RELAY_SETTINGS_COUNTERS_UPDATE_MS   (10UL * 60UL * 1000UL)
+
+/** @brief NVS namespace and key of the stored settings */
+#define RELAY_SETTINGS_NVS_NAMESPACE        "relay"
+#define RELAY_SETTINGS_NVS_KEY              "protection"
+
+/** @brief Attribute table for zb_endpoint_add_clusters() */
+extern const zb_ep_attr_desc_t relay_settings_zcl_attrs[RELAY_SETTINGS_ZCL_ATTR_COUNT];
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Load the settings from NVS, apply them and follow attribute writes
+ *
+ * Call after nvs_flash_init() and relay_init(), before zigbee_handler_init()
+ * so the attributes start with the stored values.
+ *
+ * @return ESP_OK on success (missing settings are not an error)
+ */
+esp_err_t relay_settings_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RELAY_SETTINGS_H */
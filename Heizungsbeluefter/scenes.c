@@ -0,0 +1,339 @@
+/**
+ * @file scenes.c
+ * @brief Scene storage and recall implementation
+ *
+ * All functions except scenes_init() run in the Zigbee task, so the table
+ * needs no lock. The table is kept in insertion order: new scenes are
+ * appended and, when it is full, the first entry is dropped.
+ */
+
+#include "scenes.h"
+#include "relay.h"
+#include "app_event.h"
+#include "zigbee_handler.h"
+#include "esp_check.h"
+#include "nvs.h"
+#include <string.h>
+#define APP_LOG_MODULE_LEVEL    SCENES_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "SCENES";
+
+/* ZCL header: frame control, sequence number, command ID */
+#define SCENES_ZCL_HEADER_LEN           3
+#define SCENES_ZCL_FC_FILTER_MASK       0x0F    /* frame type, manufacturer specific, direction */
+#define SCENES_ZCL_FC_CLUSTER_TO_SRV    0x01    /* cluster command, standard, client to server */
+
+/* Commands that remove scenes, payload starts with the group ID */
+#define SCENES_CMD_REMOVE_SCENE         0x02
+#define SCENES_CMD_REMOVE_ALL_SCENES    0x03
+#define GROUPS_CMD_REMOVE_GROUP         0x03
+#define GROUPS_CMD_REMOVE_ALL_GROUPS    0x04
+
+/** Broadcast endpoint of unicast frames */
+#define SCENES_ENDPOINT_BROADCAST       0xFF
+
+_Static_assert(sizeof(scenes_entry_t) == 6, "scene entry layout is stored in NVS");
+
+static scenes_entry_t s_table[SCENES_MAX_ENTRIES];
+static uint8_t s_count = 0;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static scenes_entry_t *scenes_find(uint16_t group_id, uint8_t scene_id);
+static scenes_entry_t *scenes_add(uint16_t group_id, uint8_t scene_id);
+static uint8_t scenes_remove(uint16_t group_id, uint8_t scene_id, bool all_scenes, bool all_groups);
+static void scenes_save(void);
+static bool scenes_field_on_off(const esp_zb_zcl_scenes_extension_field_t *field, bool *on);
+static void scenes_set_attr(uint16_t attr_id, void *value);
+static void scenes_update_attrs(uint16_t group_id, uint8_t scene_id, bool valid);
+static void scenes_on_left(const app_event_t *event, void *ctx);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static scenes_entry_t *scenes_find(uint16_t group_id, uint8_t scene_id)
+{
+    for (uint8_t i = 0; i < s_count; i++) {
+        if (s_table[i].group_id == group_id && s_table[i].scene_id == scene_id) {
+            return &s_table[i];
+        }
+    }
+    return NULL;
+}
+
+/** Find or append an entry, dropping the oldest one if the table is full */
+static scenes_entry_t *scenes_add(uint16_t group_id, uint8_t scene_id)
+{
+    scenes_entry_t *entry = scenes_find(group_id, scene_id);
+
+    if (entry) {
+        return entry;
+    }
+    if (s_count == SCENES_MAX_ENTRIES) {
+        APP_LOGW("Table full, dropping scene %u of group 0x%04x",
+                 s_table[0].scene_id, s_table[0].group_id);
+        memmove(&s_table[0], &s_table[1], (SCENES_MAX_ENTRIES - 1) * sizeof(s_table[0]));
+        s_count--;
+    }
+
+    entry = &s_table[s_count++];
+    *entry = (scenes_entry_t){
+        .group_id = group_id,
+        .scene_id = scene_id,
+        .valid = 1,
+        .level = SCENES_LEVEL_NONE,
+    };
+    return entry;
+}
+
+/**
+ * Remove one scene, all scenes of a group or the scenes of all groups
+ * (group 0 holds scenes without a group and is kept)
+ *
+ * @return Number of entries removed
+ */
+static uint8_t scenes_remove(uint16_t group_id, uint8_t scene_id, bool all_scenes, bool all_groups)
+{
+    uint8_t kept = 0;
+
+    for (uint8_t i = 0; i < s_count; i++) {
+        const scenes_entry_t *entry = &s_table[i];
+        bool remove = all_groups ? entry->group_id != 0 :
+                      entry->group_id == group_id && (all_scenes || entry->scene_id == scene_id);
+        if (!remove) {
+            s_table[kept++] = *entry;
+        }
+    }
+
+    uint8_t removed = s_count - kept;
+    s_count = kept;
+    return removed;
+}
+
+static void scenes_save(void)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(SCENES_NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+    if (ret == ESP_OK) {
+        if (s_count > 0) {
+            ret = nvs_set_blob(handle, SCENES_NVS_KEY, s_table, s_count * sizeof(s_table[0]));
+        } else {
+            ret = nvs_erase_key(handle, SCENES_NVS_KEY);
+            if (ret == ESP_ERR_NVS_NOT_FOUND) {
+                ret = ESP_OK;
+            }
+        }
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        APP_LOGW("Failed to store scenes: %s", esp_err_to_name(ret));
+    }
+}
+
+/** On/Off value from the extension fields of a recalled scene */
+static bool scenes_field_on_off(const esp_zb_zcl_scenes_extension_field_t *field, bool *on)
+{
+    for (; field; field = field->next) {
+        if (field->cluster_id == ESP_ZB_ZCL_CLUSTER_ID_ON_OFF && field->length >= 1 &&
+            field->extension_field_attribute_value_list) {
+            *on = field->extension_field_attribute_value_list[0] != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void scenes_set_attr(uint16_t attr_id, void *value)
+{
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(
+        ZIGBEE_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_SCENES, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        attr_id, value, false);
+
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        APP_LOGW("Failed to set attribute 0x%04x, status: 0x%x", attr_id, status);
+    }
+}
+
+static void scenes_update_attrs(uint16_t group_id, uint8_t scene_id, bool valid)
+{
+    scenes_set_attr(ESP_ZB_ZCL_ATTR_SCENES_SCENE_COUNT_ID, &s_count);
+    scenes_set_attr(ESP_ZB_ZCL_ATTR_SCENES_CURRENT_GROUP_ID, &group_id);
+    scenes_set_attr(ESP_ZB_ZCL_ATTR_SCENES_CURRENT_SCENE_ID, &scene_id);
+    scenes_set_attr(ESP_ZB_ZCL_ATTR_SCENES_SCENE_VALID_ID, &valid);
+}
+
+/**
+ * @brief Forget the scenes when the device is removed (Zigbee task)
+ *
+ * Their groups belong to the old network; the stack drops its copy with the
+ * network data.
+ */
+static void scenes_on_left(const app_event_t *event, void *ctx)
+{
+    (void)event;
+    (void)ctx;
+
+    if (s_count == 0) {
+        return;
+    }
+    APP_LOGI("Left the network, clearing %u scenes", s_count);
+    s_count = 0;
+    scenes_save();
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t scenes_init(void)
+{
+    nvs_handle_t handle;
+    size_t size = sizeof(s_table);
+
+    esp_err_t ret = nvs_open(SCENES_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, SCENES_NVS_KEY, s_table, &size);
+        nvs_close(handle);
+    }
+
+    if (ret == ESP_OK && size % sizeof(s_table[0]) == 0) {
+        s_count = (uint8_t)(size / sizeof(s_table[0]));
+        APP_LOGI("Loaded %u scenes", s_count);
+    } else {
+        s_count = 0;
+        APP_LOGI("No stored scenes");
+    }
+    return app_event_subscribe(APP_EVENT_MASK(APP_EVENT_ZB_LEFT), scenes_on_left, NULL);
+}
+
+void scenes_start(void)
+{
+    for (uint8_t i = 0; i < s_count; i++) {
+        const scenes_entry_t *entry = &s_table[i];
+        uint8_t on_off = entry->on_off;
+        esp_zb_zcl_scenes_extension_field_t field = {
+            .cluster_id = ESP_ZB_ZCL_CLUSTER_ID_ON_OFF,
+            .length = sizeof(on_off),
+            .extension_field_attribute_value_list = &on_off,
+            .next = NULL,
+        };
+
+        esp_err_t ret = esp_zb_zcl_scenes_table_store(ZIGBEE_ENDPOINT, entry->group_id,
+                                                      entry->scene_id, 0, &field);
+        if (ret != ESP_OK) {
+            APP_LOGW("Failed to restore scene %u of group 0x%04x: %s",
+                     entry->scene_id, entry->group_id, esp_err_to_name(ret));
+        }
+    }
+    scenes_set_attr(ESP_ZB_ZCL_ATTR_SCENES_SCENE_COUNT_ID, &s_count);
+}
+
+esp_err_t scenes_on_store(const esp_zb_zcl_store_scene_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+
+    scenes_entry_t *entry = scenes_add(message->group_id, message->scene_id);
+    entry->on_off = relay_get_desired_state() ? 1 : 0;
+    scenes_save();
+    scenes_update_attrs(message->group_id, message->scene_id, true);
+
+    APP_LOGI("Stored scene %u of group 0x%04x: %s", message->scene_id, message->group_id,
+             entry->on_off ? "ON" : "OFF");
+    return ESP_OK;
+}
+
+esp_err_t scenes_on_recall(const esp_zb_zcl_recall_scene_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+
+    scenes_entry_t *entry = scenes_find(message->group_id, message->scene_id);
+    bool on;
+
+    /* The stack's copy is the newest (Add Scene), ours covers reboots */
+    if (scenes_field_on_off(message->field_set, &on)) {
+        if (!entry || entry->on_off != on) {
+            entry = scenes_add(message->group_id, message->scene_id);
+            entry->on_off = on ? 1 : 0;
+            scenes_save();
+        }
+    } else if (entry) {
+        on = entry->on_off != 0;
+    } else {
+        APP_LOGW("Unknown scene %u of group 0x%04x", message->scene_id, message->group_id);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    relay_result_t result = relay_set_from(on, APP_EVENT_SRC_ZIGBEE);
+    zigbee_handler_set_on_off_attribute(on);
+    scenes_update_attrs(message->group_id, message->scene_id, true);
+
+    APP_LOGI("Recalled scene %u of group 0x%04x: %s%s", message->scene_id, message->group_id,
+             on ? "ON" : "OFF", result == RELAY_RESULT_DEFERRED ? " (deferred)" : "");
+    return ESP_OK;
+}
+
+void scenes_on_aps_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    const uint8_t *asdu = ind->asdu;
+    uint16_t group_id = 0;
+    uint8_t scene_id = 0;
+    uint8_t removed = 0;
+
+    if ((ind->cluster_id != ESP_ZB_ZCL_CLUSTER_ID_SCENES &&
+         ind->cluster_id != ESP_ZB_ZCL_CLUSTER_ID_GROUPS) ||
+        !asdu || ind->asdu_length < SCENES_ZCL_HEADER_LEN ||
+        (asdu[0] & SCENES_ZCL_FC_FILTER_MASK) != SCENES_ZCL_FC_CLUSTER_TO_SRV) {
+        return;
+    }
+    if (ind->dst_addr_mode != ESP_ZB_APS_ADDR_MODE_16_GROUP_ENDP_NOT_PRESENT &&
+        ind->dst_endpoint != ZIGBEE_ENDPOINT && ind->dst_endpoint != SCENES_ENDPOINT_BROADCAST) {
+        return;
+    }
+
+    uint8_t command = asdu[2];
+    const uint8_t *payload = asdu + SCENES_ZCL_HEADER_LEN;
+    uint32_t payload_len = ind->asdu_length - SCENES_ZCL_HEADER_LEN;
+    if (payload_len >= 2) {
+        group_id = (uint16_t)(payload[0] | (payload[1] << 8));
+    }
+    if (payload_len >= 3) {
+        scene_id = payload[2];
+    }
+
+    if (ind->cluster_id == ESP_ZB_ZCL_CLUSTER_ID_SCENES) {
+        if (command == SCENES_CMD_REMOVE_SCENE && payload_len >= 3) {
+            removed = scenes_remove(group_id, scene_id, false, false);
+        } else if (command == SCENES_CMD_REMOVE_ALL_SCENES && payload_len >= 2) {
+            removed = scenes_remove(group_id, 0, true, false);
+        }
+    } else {
+        if (command == GROUPS_CMD_REMOVE_GROUP && payload_len >= 2) {
+            removed = scenes_remove(group_id, 0, true, false);
+        } else if (command == GROUPS_CMD_REMOVE_ALL_GROUPS) {
+            removed = scenes_remove(0, 0, true, true);
+        }
+    }
+
+    if (removed > 0) {
+        scenes_save();
+        APP_LOGI("Removed %u scenes (cluster 0x%04x, command 0x%02x, group 0x%04x)",
+                 removed, ind->cluster_id, command, group_id);
+    }
+}
+
+uint8_t scenes_count(void)
+{
+    return s_count;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file scenes.h
+ * @brief Scene storage and recall for ESP32-C6 Zigbee Fan Switch
+ *
+ * Keeps the scenes of the fan endpoint in a fixed table of
+ * SCENES_MAX_ENTRIES entries in NVS, so a "ventilation boost" scene stored
+ * on a room group is one group-cast Recall Scene for all fans instead of a
+ * unicast per device, and survives power cuts.
+ *
+ * The stack parses the Scenes cluster commands and keeps its own scene
+ * membership; this module adds the part it leaves to the application:
+ *   - Store Scene captures the desired relay state (and a level, reserved
+ *     for a future Level Control cluster) into the table and NVS
+ *   - Recall Scene applies the stored state with relay_set_from() right in
+ *     the Zigbee task, without a round trip through the On/Off attribute
+ *   - at start the table is handed back to the stack, whose scene table is
+ *     not persistent, so recalls keep working after a reboot
+ * Scenes added with extension fields (Add Scene) are taken over on their
+ * first recall. Remove Scene, Remove All Scenes, Remove Group and Remove
+ * All Groups are not reported by the stack; scenes_on_aps_indication()
+ * picks them out of the incoming frames, so removed scenes do not come
+ * back after a reboot. Group membership itself is kept by the stack in
+ * zb_storage.
+ *
+ * When the table is full, the oldest entry is replaced.
+ */
+
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Number of scenes kept */
+#define SCENES_MAX_ENTRIES          16
+
+/** @brief Level of entries without one */
+#define SCENES_LEVEL_NONE           0xFF
+
+/** @brief NVS namespace and key of the stored table */
+#define SCENES_NVS_NAMESPACE        "scenes"
+#define SCENES_NVS_KEY              "table"
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief One scene (6 bytes in NVS)
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t group_id;
+    uint8_t scene_id;
+    uint8_t valid;
+    uint8_t on_off;             /**< Relay state */
+    uint8_t level;              /**< SCENES_LEVEL_NONE until Level Control exists */
+} scenes_entry_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Load the table from NVS
+ *
+ * Call after nvs_flash_init().
+ *
+ * @return ESP_OK on success (a missing table is not an error)
+ */
+esp_err_t scenes_init(void);
+
+/**
+ * @brief Register the stored scenes with the stack (Zigbee task)
+ *
+ * Called by zigbee_handler_start() once the stack runs.
+ */
+void scenes_start(void);
+
+/**
+ * @brief Handle Store Scene (Zigbee task)
+ */
+esp_err_t scenes_on_store(const esp_zb_zcl_store_scene_message_t *message);
+
+/**
+ * @brief Handle Recall Scene (Zigbee task)
+ */
+esp_err_t scenes_on_recall(const esp_zb_zcl_recall_scene_message_t *message);
+
+/**
+ * @brief Drop the scenes removed by an incoming command (Zigbee task)
+ *
+ * Looks at Scenes and Groups cluster commands to the fan endpoint; the
+ * stack still processes the frame itself.
+ *
+ * @param ind APS data indication
+ */
+void scenes_on_aps_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/**
+ * @brief Number of stored scenes
+ */
+uint8_t scenes_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCENES_H */
@@ -0,0 +1,418 @@
+/**
+ * @file schedule.c
+ * @brief On-device weekly schedule implementation
+ *
+ * Attribute write and clock sync events arrive in the Zigbee task. The
+ * timer callback runs in the timer_wheel task and takes the Zigbee lock, so
+ * all schedule state is only touched with the stack held.
+ */
+
+#include "schedule.h"
+#include "time_sync.h"
+#include "relay.h"
+#include "app_event.h"
+#include "zigbee_handler.h"
+#include "timer_wheel.h"
+#include "zcl_codec.h"
+#include "nvs.h"
+#include <string.h>
+#define APP_LOG_MODULE_LEVEL    SCHEDULE_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "SCHEDULE";
+
+_Static_assert(sizeof(schedule_entry_t) == 4, "schedule entry layout is part of the ZCL format");
+
+#define SCHEDULE_ENTRIES_BYTES  (SCHEDULE_MAX_ENTRIES * sizeof(schedule_entry_t))
+_Static_assert(SCHEDULE_ENTRIES_BYTES <= 254, "schedule does not fit into a ZCL octet string");
+
+#define SECONDS_PER_DAY         86400
+#define MINUTES_PER_DAY         1440
+#define DAYS_MASK_ALL           0x7F
+
+/** Seconds between 1970-01-01 (Unix) and 2000-01-01 (ZCL UTCTime) */
+#define ZCL_UTC_EPOCH_OFFSET    946684800LL
+#define ZCL_UTC_INVALID         0xFFFFFFFFUL
+
+/** NVS layout */
+typedef struct {
+    uint8_t enabled;
+    uint8_t reserved[3];
+    schedule_entry_t entries[SCHEDULE_MAX_ENTRIES];
+} schedule_table_t;
+
+static schedule_table_t s_table = { .enabled = 1 };
+
+/** Next armed entry */
+static timer_wheel_timer_t s_timer;
+static bool s_armed = false;
+static int64_t s_next_local_s = 0;
+static uint8_t s_next_index = 0;
+
+static bool s_started = false;
+static bool s_caught_up = false;
+
+/* -----------------------------------------------------------------------------
+ * ZCL attribute start values
+ *
+ * The SDK sizes string attribute storage from the initial value, so the
+ * entries attribute always has its full length.
+ * ----------------------------------------------------------------------------- */
+
+static uint8_t s_attr_entries[1 + SCHEDULE_ENTRIES_BYTES] = { SCHEDULE_ENTRIES_BYTES };
+static bool s_attr_enabled = true;
+static const uint8_t s_attr_time_status = TIME_SYNC_NONE;
+static const uint32_t s_attr_next_event = ZCL_UTC_INVALID;
+
+const zb_ep_attr_desc_t schedule_zcl_attrs[SCHEDULE_ZCL_ATTR_COUNT] = {
+    { SCHEDULE_ATTR_ENTRIES_ID, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE,
+      s_attr_entries },
+    { SCHEDULE_ATTR_ENABLED_ID, ESP_ZB_ZCL_ATTR_TYPE_BOOL, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &s_attr_enabled },
+    { SCHEDULE_ATTR_TIME_STATUS_ID, ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING, &s_attr_time_status },
+    { SCHEDULE_ATTR_NEXT_EVENT_ID, ESP_ZB_ZCL_ATTR_TYPE_UTC_TIME,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING, &s_attr_next_event },
+};
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static bool schedule_entry_valid(const schedule_entry_t *entry);
+static uint8_t schedule_sanitize(void);
+static int64_t schedule_find_next(int64_t now_local_s, uint8_t *index);
+static int64_t schedule_find_last(int64_t now_local_s, uint8_t *index);
+static void schedule_apply(uint8_t index);
+static void schedule_catch_up(void);
+static void schedule_arm(void);
+static void schedule_timer_cb(void *arg);
+static void schedule_set_attr(uint16_t attr_id, void *value);
+static void schedule_save(void);
+static void schedule_on_event(const app_event_t *event, void *ctx);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static bool schedule_entry_valid(const schedule_entry_t *entry)
+{
+    return entry->minute_of_day < MINUTES_PER_DAY && entry->action <= 1 &&
+           (entry->days & ~DAYS_MASK_ALL) == 0;
+}
+
+/**
+ * @brief Disable invalid entries
+ *
+ * @return Number of disabled entries
+ */
+static uint8_t schedule_sanitize(void)
+{
+    uint8_t disabled = 0;
+
+    for (uint8_t i = 0; i < SCHEDULE_MAX_ENTRIES; i++) {
+        schedule_entry_t *entry = &s_table.entries[i];
+        if (entry->days != 0 && !schedule_entry_valid(entry)) {
+            APP_LOGW("Entry %u invalid (minute %u, days 0x%02x, action %u), disabled",
+                     i, entry->minute_of_day, entry->days, entry->action);
+            memset(entry, 0, sizeof(*entry));
+            disabled++;
+        }
+    }
+    return disabled;
+}
+
+/**
+ * @brief Find the first occurrence strictly after now
+ *
+ * @return Local time of the occurrence, or -1 if no entry is active
+ */
+static int64_t schedule_find_next(int64_t now_local_s, uint8_t *index)
+{
+    int64_t day = now_local_s / SECONDS_PER_DAY;
+    int32_t second_of_day = (int32_t)(now_local_s - day * SECONDS_PER_DAY);
+    uint8_t weekday = (uint8_t)((day + 4) % 7);  /* 1970-01-01 was a Thursday */
+    int64_t best = -1;
+
+    for (uint8_t i = 0; i < SCHEDULE_MAX_ENTRIES; i++) {
+        const schedule_entry_t *entry = &s_table.entries[i];
+        int32_t at = (int32_t)entry->minute_of_day * 60;
+
+        if (entry->days == 0) {
+            continue;
+        }
+        /* Offset 7 covers an entry for today's weekday that already passed */
+        for (uint8_t offset = 0; offset <= 7; offset++) {
+            if (!(entry->days & (1U << ((weekday + offset) % 7)))) {
+                continue;
+            }
+            if (offset == 0 && at <= second_of_day) {
+                continue;
+            }
+            int64_t candidate = (day + offset) * SECONDS_PER_DAY + at;
+            if (best < 0 || candidate < best) {
+                best = candidate;
+                *index = i;
+            }
+            break;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Find the latest occurrence at or before now (within one week)
+ *
+ * @return Local time of the occurrence, or -1 if no entry is active
+ */
+static int64_t schedule_find_last(int64_t now_local_s, uint8_t *index)
+{
+    int64_t day = now_local_s / SECONDS_PER_DAY;
+    int32_t second_of_day = (int32_t)(now_local_s - day * SECONDS_PER_DAY);
+    uint8_t weekday = (uint8_t)((day + 4) % 7);
+    int64_t best = -1;
+
+    for (uint8_t i = 0; i < SCHEDULE_MAX_ENTRIES; i++) {
+        const schedule_entry_t *entry = &s_table.entries[i];
+        int32_t at = (int32_t)entry->minute_of_day * 60;
+
+        if (entry->days == 0) {
+            continue;
+        }
+        for (uint8_t offset = 0; offset <= 7; offset++) {
+            if (!(entry->days & (1U << ((weekday + 7 - offset) % 7)))) {
+                continue;
+            }
+            if (offset == 0 && at > second_of_day) {
+                continue;
+            }
+            int64_t candidate = (day - offset) * SECONDS_PER_DAY + at;
+            if (candidate > best) {
+                best = candidate;
+                *index = i;
+            }
+            break;
+        }
+    }
+    return best;
+}
+
+static void schedule_apply(uint8_t index)
+{
+    const schedule_entry_t *entry = &s_table.entries[index];
+    bool on = entry->action != 0;
+
+    relay_result_t result = relay_set_from(on, APP_EVENT_SRC_SCHEDULE);
+    APP_LOGI("Entry %u (%02u:%02u): %s%s", index,
+             entry->minute_of_day / 60, entry->minute_of_day % 60, on ? "ON" : "OFF",
+             result == RELAY_RESULT_DEFERRED ? " (deferred by protection)" : "");
+}
+
+/**
+ * @brief Apply the most recent entry once the clock is first trusted
+ */
+static void schedule_catch_up(void)
+{
+    time_t now_local;
+    uint8_t index;
+
+    if (s_caught_up || !s_table.enabled || !time_sync_get_local(&now_local)) {
+        return;
+    }
+    s_caught_up = true;
+
+    if (schedule_find_last(now_local, &index) >= 0) {
+        APP_LOGI("Catching up with the program");
+        schedule_apply(index);
+    }
+}
+
+/**
+ * @brief Arm the timer for the next entry and publish it
+ */
+static void schedule_arm(void)
+{
+    time_t now_local;
+    uint32_t next_utc = ZCL_UTC_INVALID;
+
+    timer_wheel_cancel(&s_timer);
+    s_armed = false;
+
+    if (s_table.enabled && time_sync_get_local(&now_local)) {
+        int64_t next = schedule_find_next(now_local, &s_next_index);
+        if (next >= 0) {
+            /* At most one week ahead, fits the 32-bit milliseconds */
+            uint32_t delay_ms = (uint32_t)(next - now_local) * 1000;
+            timer_wheel_arm(&s_timer, delay_ms, schedule_timer_cb, NULL);
+            s_armed = true;
+            s_next_local_s = next;
+            next_utc = (uint32_t)(next - time_sync_utc_offset() - ZCL_UTC_EPOCH_OFFSET);
+            APP_LOGD("Next: entry %u in %lu s", s_next_index, (unsigned long)(delay_ms / 1000));
+        }
+    }
+
+    schedule_set_attr(SCHEDULE_ATTR_NEXT_EVENT_ID, &next_utc);
+}
+
+/**
+ * @brief Timer for the armed entry (timer_wheel task)
+ */
+static void schedule_timer_cb(void *arg)
+{
+    (void)arg;
+    time_t now_local;
+    bool locked = zigbee_handler_lock();
+
+    if (!s_armed || !s_table.enabled || !time_sync_get_local(&now_local)) {
+        /* Disarmed meanwhile */
+    } else if (now_local < s_next_local_s) {
+        /* Fired early, e.g. after the clock was corrected backwards */
+        schedule_arm();
+    } else {
+        schedule_apply(s_next_index);
+        schedule_arm();
+    }
+
+    zigbee_handler_unlock(locked);
+}
+
+static void schedule_set_attr(uint16_t attr_id, void *value)
+{
+    if (!s_started) {
+        return;
+    }
+
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(
+        ZIGBEE_ENDPOINT, SCHEDULE_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        attr_id, value, false);
+
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        APP_LOGW("Failed to set attribute 0x%04x, status: 0x%x", attr_id, status);
+    }
+}
+
+static void schedule_save(void)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(SCHEDULE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, SCHEDULE_NVS_KEY, &s_table, sizeof(s_table));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        APP_LOGW("Failed to store table: %s", esp_err_to_name(ret));
+    }
+}
+
+/**
+ * @brief Follow table writes and clock syncs (Zigbee task)
+ */
+static void schedule_on_event(const app_event_t *event, void *ctx)
+{
+    (void)ctx;
+
+    if (!s_started) {
+        return;
+    }
+
+    if (event->type == APP_EVENT_TIME_CHANGED) {
+        uint8_t status = time_sync_status();
+        schedule_set_attr(SCHEDULE_ATTR_TIME_STATUS_ID, &status);
+
+        schedule_catch_up();
+        schedule_arm();
+        return;
+    }
+
+    /* APP_EVENT_ZB_ATTR_WRITTEN */
+    if (event->zcl.cluster != SCHEDULE_CLUSTER_ID || !event->zcl.value) {
+        return;
+    }
+
+    if (event->zcl.attr_id == SCHEDULE_ATTR_ENTRIES_ID) {
+        const uint8_t *data;
+        uint16_t written;
+        if (zcl_codec_read_string(event->zcl.attr_type, event->zcl.value, &data, &written) != ESP_OK) {
+            return;
+        }
+        size_t len = written > SCHEDULE_ENTRIES_BYTES ? SCHEDULE_ENTRIES_BYTES : written;
+
+        /* Shorter writes clear the remaining entries */
+        memset(s_table.entries, 0, sizeof(s_table.entries));
+        memcpy(s_table.entries, data, len - len % sizeof(schedule_entry_t));
+
+        if (schedule_sanitize() > 0 || len != SCHEDULE_ENTRIES_BYTES) {
+            memcpy(&s_attr_entries[1], s_table.entries, SCHEDULE_ENTRIES_BYTES);
+            schedule_set_attr(SCHEDULE_ATTR_ENTRIES_ID, s_attr_entries);
+        }
+        APP_LOGI("Table written");
+    } else if (event->zcl.attr_id == SCHEDULE_ATTR_ENABLED_ID) {
+        bool enabled;
+        if (zcl_codec_read_bool(event->zcl.attr_type, event->zcl.value, &enabled) != ESP_OK) {
+            return;
+        }
+        s_table.enabled = enabled;
+        APP_LOGI("Schedule %s", s_table.enabled ? "enabled" : "disabled");
+    } else {
+        return;
+    }
+
+    schedule_save();
+    schedule_arm();
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t schedule_init(void)
+{
+    nvs_handle_t handle;
+    size_t size = sizeof(s_table);
+
+    esp_err_t ret = nvs_open(SCHEDULE_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, SCHEDULE_NVS_KEY, &s_table, &size);
+        nvs_close(handle);
+    }
+
+    if (ret != ESP_OK || size != sizeof(s_table)) {
+        /* First boot or older layout: empty table */
+        memset(&s_table, 0, sizeof(s_table));
+        s_table.enabled = 1;
+        APP_LOGI("No stored schedule");
+    }
+    schedule_sanitize();
+
+    memcpy(&s_attr_entries[1], s_table.entries, SCHEDULE_ENTRIES_BYTES);
+    s_attr_enabled = s_table.enabled != 0;
+
+    return app_event_subscribe(APP_EVENT_MASK(APP_EVENT_ZB_ATTR_WRITTEN) |
+                               APP_EVENT_MASK(APP_EVENT_TIME_CHANGED),
+                               schedule_on_event, NULL);
+}
+
+void schedule_start(void)
+{
+    uint8_t status = time_sync_status();
+
+    s_started = true;
+    schedule_set_attr(SCHEDULE_ATTR_TIME_STATUS_ID, &status);
+
+    /* Clock kept across a reset: catch up right away */
+    schedule_catch_up();
+    schedule_arm();
+}
+
+bool schedule_get_next(int64_t *local_s)
+{
+    *local_s = s_next_local_s;
+    return s_armed;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file schedule.h
+ * @brief On-device weekly schedule for ESP32-C6 Zigbee Fan Switch
+ *
+ * Up to SCHEDULE_MAX_ENTRIES switch times per week run on the device, so the
+ * fan follows its program even while the coordinator or Home Assistant is
+ * down. Each entry switches the relay ON or OFF at a local time of day on a
+ * set of weekdays; the relay's short-cycle protection still applies.
+ *
+ * Execution is timer driven: a single timer wheel timer is armed for the
+ * next due entry, there is no per-minute polling. The timer is re-armed
+ * after it fired, after a clock sync (APP_EVENT_TIME_CHANGED) and after the
+ * table was written. Entries only run while the clock is trusted (see
+ * time_sync.h). When the clock becomes trusted after boot, the most recent
+ * entry of the past week is applied once, so a power cut does not leave the
+ * fan in the wrong state until the next switch time.
+ *
+ * Manufacturer-specific Schedule cluster (SCHEDULE_CLUSTER_ID):
+ *   0x0000  Entries       (octet string, read/write, 4 bytes per entry:
+ *                          uint16 LE minute of day, uint8 weekday mask with
+ *                          bit 0 = Sunday, uint8 action 0 = OFF / 1 = ON;
+ *                          entries with an empty weekday mask are unused)
+ *   0x0001  Enabled       (bool, read/write)
+ *   0x0002  Time status   (enum8, read-only, time_sync_status_t)
+ *   0x0003  Next event    (UTCTime, read-only, 0xFFFFFFFF = none)
+ *
+ * Table and enable flag are kept in NVS. Invalid entries are disabled and
+ * the cleaned table is written back to the attribute.
+ */
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "zb_endpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Manufacturer-specific Schedule cluster ID */
+#define SCHEDULE_CLUSTER_ID             0xFC12
+
+/* Schedule cluster attribute IDs */
+#define SCHEDULE_ATTR_ENTRIES_ID        0x0000
+#define SCHEDULE_ATTR_ENABLED_ID        0x0001
+#define SCHEDULE_ATTR_TIME_STATUS_ID    0x0002
+#define SCHEDULE_ATTR_NEXT_EVENT_ID     0x0003
+
+#define SCHEDULE_ZCL_ATTR_COUNT         4
+
+/** @brief Number of entries in the weekly table */
+#define SCHEDULE_MAX_ENTRIES            16
+
+/** @brief NVS namespace and key of the stored table */
+#define SCHEDULE_NVS_NAMESPACE          "schedule"
+#define SCHEDULE_NVS_KEY                "table"
+
+/** @brief Attribute table for zb_endpoint_add_clusters() */
+extern const zb_ep_attr_desc_t schedule_zcl_attrs[SCHEDULE_ZCL_ATTR_COUNT];
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief One switch time (same layout as in the Entries attribute)
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t minute_of_day;     /**< 0 .. 1439, local time */
+    uint8_t days;               /**< Weekday mask, bit 0 = Sunday .. bit 6 = Saturday */
+    uint8_t action;             /**< 0 = OFF, 1 = ON */
+} schedule_entry_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Load the table from NVS and follow attribute writes and clock syncs
+ *
+ * Call after nvs_flash_init() and time_sync_init(), before
+ * zigbee_handler_init() so the attributes start with the stored values.
+ *
+ * @return ESP_OK on success (a missing table is not an error)
+ */
+esp_err_t schedule_init(void);
+
+/**
+ * @brief Arm the first timer (Zigbee task)
+ *
+ * Called by zigbee_handler_start() once the stack runs.
+ */
+void schedule_start(void);
+
+/**
+ * @brief Get the local time of the next entry
+ *
+ * @param[out] local_s Seconds since 1970-01-01 in local time
+ * @return true if an entry is armed
+ */
+bool schedule_get_next(int64_t *local_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHEDULE_H */
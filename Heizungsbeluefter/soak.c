@@ -0,0 +1,278 @@
+/**
+ * @file soak.c
+ * @brief Soak test mode implementation
+ *
+ * All injection and checking runs in the soak task. Actions go through the
+ * same entry points as real input (attribute handler under the Zigbee lock,
+ * relay_set_from()), so the subscribers, the short-cycle protection and the
+ * timer wheel run exactly as in normal operation.
+ */
+
+#include "soak.h"
+
+#if SOAK_ENABLE
+
+#include "relay.h"
+#include "network.h"
+#include "timer_wheel.h"
+#include "zigbee_handler.h"
+#include "zb_endpoint.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_zigbee_core.h"
+#define APP_LOG_MODULE_LEVEL    SOAK_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "SOAK";
+
+/** Below the Zigbee task, like the console */
+#define SOAK_TASK_PRIORITY      1
+#define SOAK_TASK_STACK         3072
+
+/** Action mix per 1000 draws, the rest are On/Off writes */
+#define SOAK_REJOIN_PER_MILLE       1
+#define SOAK_MALFORMED_PER_MILLE    100
+#define SOAK_LOCAL_PER_MILLE        300
+
+/** Number of malformed write variants in soak_inject_malformed() */
+#define SOAK_MALFORMED_KINDS    4
+
+static TaskHandle_t s_task;
+
+/* Written by the soak task, read by any task */
+static soak_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Soak task only */
+static zb_heap_snapshot_t s_heap_baseline;
+static bool s_have_baseline = false;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void soak_inject_malformed(uint32_t kind);
+static void soak_step(void);
+static void soak_violation(void);
+static void soak_check(void);
+static void soak_report(int64_t started_us);
+static void soak_task(void *arg);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/** Feed a write the codec must reject; a handler that accepts it is a violation */
+static void soak_inject_malformed(uint32_t kind)
+{
+    uint8_t bad_bool = 2;
+    uint8_t short_u16 = 0;
+    uint8_t bad_string[2] = { 8, 0 };    /* Length 8 in a 2-byte value */
+    esp_err_t ret;
+
+    switch (kind % SOAK_MALFORMED_KINDS) {
+        case 0:
+            ret = zigbee_handler_inject_write(ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+                                              ESP_ZB_ZCL_ATTR_TYPE_BOOL, NULL, 1);
+            break;
+        case 1:
+            ret = zigbee_handler_inject_write(ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+                                              ESP_ZB_ZCL_ATTR_TYPE_BOOL, &bad_bool, sizeof(bad_bool));
+            break;
+        case 2:
+            ret = zigbee_handler_inject_write(ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+                                              ESP_ZB_ZCL_ATTR_TYPE_U16, &short_u16, sizeof(short_u16));
+            break;
+        default:
+            ret = zigbee_handler_inject_write(ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+                                              ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, bad_string, sizeof(bad_string));
+            break;
+    }
+
+    if (ret == ESP_OK) {
+        APP_LOGE("Malformed write %lu accepted", (unsigned long)(kind % SOAK_MALFORMED_KINDS));
+        soak_violation();
+    }
+}
+
+/** Inject one random action */
+static void soak_step(void)
+{
+    uint32_t draw = esp_random();
+    uint32_t per_mille = draw % 1000;
+    bool on = (draw >> 16) & 1;
+
+    if (per_mille < SOAK_REJOIN_PER_MILLE) {
+        network_rejoin();
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.rejoins++;
+        portEXIT_CRITICAL(&s_stats_lock);
+    } else if (per_mille < SOAK_REJOIN_PER_MILLE + SOAK_MALFORMED_PER_MILLE) {
+        soak_inject_malformed(draw >> 17);
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.malformed++;
+        portEXIT_CRITICAL(&s_stats_lock);
+    } else if (per_mille < SOAK_REJOIN_PER_MILLE + SOAK_MALFORMED_PER_MILLE + SOAK_LOCAL_PER_MILLE) {
+        relay_set_from(on, APP_EVENT_SRC_LOCAL);
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.local_changes++;
+        portEXIT_CRITICAL(&s_stats_lock);
+    } else {
+        zigbee_handler_inject_write(ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+                                    ESP_ZB_ZCL_ATTR_TYPE_BOOL, &on, sizeof(on));
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.zigbee_writes++;
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.actions++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void soak_violation(void)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.violations++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/** Check the invariants, log and count each failed one */
+static void soak_check(void)
+{
+    zb_heap_snapshot_t heap;
+    timer_wheel_stats_t timers;
+
+    /* Attribute and desired state are both changed under the Zigbee lock */
+    bool locked = zigbee_handler_lock();
+    esp_zb_zcl_attr_t *attr = esp_zb_zcl_get_attribute(ZIGBEE_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_ON_OFF,
+                                                       ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                                       ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID);
+    bool attr_on = attr && attr->data_p && *(const uint8_t *)attr->data_p != 0;
+    bool desired = relay_get_desired_state();
+    zigbee_handler_unlock(locked);
+
+    if (!attr || attr_on != desired) {
+        APP_LOGE("On/Off attribute %s, desired relay state %s",
+                 attr ? (attr_on ? "ON" : "OFF") : "missing", desired ? "ON" : "OFF");
+        soak_violation();
+    }
+
+    zb_heap_snapshot(&heap);
+    if (!s_have_baseline) {
+        s_heap_baseline = heap;
+        s_have_baseline = true;
+    } else if (heap.free_bytes + SOAK_HEAP_SLACK_BYTES < s_heap_baseline.free_bytes ||
+               heap.allocated_blocks > s_heap_baseline.allocated_blocks + SOAK_HEAP_SLACK_BLOCKS) {
+        APP_LOGE("Heap creep: free %u (start %u), blocks %u (start %u)",
+                 (unsigned)heap.free_bytes, (unsigned)s_heap_baseline.free_bytes,
+                 (unsigned)heap.allocated_blocks, (unsigned)s_heap_baseline.allocated_blocks);
+        soak_violation();
+    }
+
+    timer_wheel_get_stats(&timers);
+    if (timers.pending > SOAK_TIMERS_MAX) {
+        APP_LOGE("%lu timers pending (max %d)", (unsigned long)timers.pending, SOAK_TIMERS_MAX);
+        soak_violation();
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.checks++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/** Print one "SOAK" line: throughput, equivalent days, invariants */
+static void soak_report(int64_t started_us)
+{
+    soak_stats_t stats;
+    zb_heap_snapshot_t heap;
+    relay_stats_t relay;
+
+    soak_get_stats(&stats);
+    zb_heap_snapshot(&heap);
+    relay_get_stats(&relay);
+
+    uint32_t elapsed_s = (uint32_t)((esp_timer_get_time() - started_us) / 1000000);
+
+    /* Always printed, whatever the log threshold (like "BENCH") */
+    ESP_LOGI(TAG, "SOAK t=%lus actions=%lu rate=%lu/s equiv_days=%lu transitions=%lu deferred=%lu "
+             "malformed=%lu rejoins=%lu checks=%lu violations=%lu heap_free=%u blocks=%u",
+             (unsigned long)elapsed_s, (unsigned long)stats.actions,
+             (unsigned long)(elapsed_s ? stats.actions / elapsed_s : 0),
+             (unsigned long)(stats.actions / SOAK_ACTIONS_PER_DAY),
+             (unsigned long)relay.transitions, (unsigned long)relay.deferred,
+             (unsigned long)stats.malformed, (unsigned long)stats.rejoins,
+             (unsigned long)stats.checks, (unsigned long)stats.violations,
+             (unsigned)heap.free_bytes, (unsigned)heap.allocated_blocks);
+}
+
+static void soak_task(void *arg)
+{
+    (void)arg;
+
+    vTaskDelay(pdMS_TO_TICKS(SOAK_WARMUP_MS));
+    APP_LOGW("Soak test running, the relay switches at random");
+
+    int64_t started_us = esp_timer_get_time();
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t step = 0;
+
+    for (;;) {
+        soak_step();
+        step++;
+
+        if (step % (SOAK_CHECK_MS / SOAK_STEP_MS) == 0) {
+            soak_check();
+        }
+        if (step % (SOAK_REPORT_MS / SOAK_STEP_MS) == 0) {
+            soak_report(started_us);
+        }
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SOAK_STEP_MS));
+    }
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t soak_start(void)
+{
+    BaseType_t created = xTaskCreate(soak_task, "soak", SOAK_TASK_STACK, NULL,
+                                     SOAK_TASK_PRIORITY, &s_task);
+    if (created != pdPASS) {
+        APP_LOGE("Failed to create task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    APP_LOGW("Soak test starts in %d s", SOAK_WARMUP_MS / 1000);
+    return ESP_OK;
+}
+
+void soak_get_stats(soak_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+#else /* !SOAK_ENABLE */
+
+#include <string.h>
+
+esp_err_t soak_start(void)
+{
+    return ESP_OK;
+}
+
+void soak_get_stats(soak_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+#endif /* SOAK_ENABLE */
@@ -0,0 +1,115 @@
+/**
+ * @file soak.h
+ * @brief Soak test mode for ESP32-C6 Zigbee Fan Switch
+ *
+ * Runs the firmware under a steady stream of random input on the real
+ * device, for hours or days, to find what only shows after a long time:
+ * heap creep, timers piling up, relay and attribute drifting apart.
+ *
+ * Every SOAK_STEP_MS the "soak" task injects one random action:
+ *   - an On/Off write through the attribute handler, as from the network
+ *   - a local relay change, as from the button
+ *   - a malformed write (wrong type, size or missing value), which must be
+ *     dropped without touching the relay
+ *   - a network rejoin (rare)
+ *
+ * Every SOAK_CHECK_MS the invariants are checked:
+ *   - the On/Off attribute equals the desired relay state
+ *   - heap: free bytes and live blocks stay within SOAK_HEAP_SLACK_BYTES /
+ *     SOAK_HEAP_SLACK_BLOCKS of the level at the first check
+ *   - every malformed write was rejected by the attribute handler
+ *   - queues: pending timer wheel timers stay at or below SOAK_TIMERS_MAX
+ * A violation is logged as an error and counted; the run continues.
+ *
+ * Every SOAK_REPORT_MS a "SOAK" line reports the actions per second and the
+ * equivalent days of normal use (SOAK_ACTIONS_PER_DAY).
+ *
+ * The relay really switches, within the short-cycle protection: run the
+ * soak test with the fan disconnected. Disabled by default. Build with
+ * SOAK_ENABLE=1 to compile it in.
+ */
+
+#ifndef SOAK_H
+#define SOAK_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Compile the soak test in (1) or out (0) */
+#ifndef SOAK_ENABLE
+#define SOAK_ENABLE             0
+#endif
+
+/** @brief Wait after the start, so the stack has started and joined */
+#define SOAK_WARMUP_MS          60000
+
+/** @brief Interval between two injected actions */
+#define SOAK_STEP_MS            50
+
+/** @brief Interval between two invariant checks */
+#define SOAK_CHECK_MS           1000
+
+/** @brief Interval between two reports */
+#define SOAK_REPORT_MS          60000
+
+/** @brief Actions of a normal day, for the equivalent days in the report */
+#define SOAK_ACTIONS_PER_DAY    50
+
+/** @brief Allowed drop of free heap below the first check */
+#define SOAK_HEAP_SLACK_BYTES   4096
+
+/** @brief Allowed growth of live heap blocks above the first check */
+#define SOAK_HEAP_SLACK_BLOCKS  16
+
+/** @brief Most pending timer wheel timers */
+#define SOAK_TIMERS_MAX         16
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Soak test counters
+ */
+typedef struct {
+    uint32_t actions;           /**< Injected actions */
+    uint32_t zigbee_writes;     /**< On/Off writes through the attribute handler */
+    uint32_t local_changes;     /**< Local relay changes */
+    uint32_t malformed;         /**< Malformed writes, all must be rejected */
+    uint32_t rejoins;           /**< Rejoin requests */
+    uint32_t checks;            /**< Invariant checks */
+    uint32_t violations;        /**< Failed invariant checks */
+} soak_stats_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Start the soak task
+ *
+ * Call at the end of setup(), before zigbee_handler_start(). Does nothing
+ * unless built with SOAK_ENABLE=1.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the task could not be created
+ */
+esp_err_t soak_start(void);
+
+/**
+ * @brief Copy the counters
+ */
+void soak_get_stats(soak_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOAK_H */
@@ -0,0 +1,300 @@
+/**
+ * @file status_led.c
+ * @brief Status LED and Identify effects implementation
+ *
+ * Inputs (network state, relay events, identify) only record what should be
+ * shown and kick the LED timer; the timer callback, in the timer_wheel task,
+ * is the only code that selects patterns and writes the GPIO.
+ */
+
+#include "status_led.h"
+#include "app_event.h"
+#include "timer_wheel.h"
+#include "hw_profile.h"
+#include "driver/gpio.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#define APP_LOG_MODULE_LEVEL    STATUS_LED_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "LED";
+
+/* Trigger Effect identifiers (ZCL Identify cluster) */
+#define STATUS_LED_EFFECT_BLINK             0x00
+#define STATUS_LED_EFFECT_BREATHE           0x01
+#define STATUS_LED_EFFECT_OKAY              0x02
+#define STATUS_LED_EFFECT_CHANNEL_CHANGE    0x0B
+#define STATUS_LED_EFFECT_FINISH            0xFE
+#define STATUS_LED_EFFECT_STOP              0xFF
+
+/**
+ * A pattern: durations in ms, alternating on and off starting with on,
+ * played @c cycles times (0 = until replaced)
+ */
+typedef struct {
+    const uint16_t *steps;
+    uint8_t count;
+    uint8_t cycles;
+} status_led_pattern_t;
+
+#define STATUS_LED_PATTERN(steps_, cycles_) \
+    { (steps_), sizeof(steps_) / sizeof((steps_)[0]), (cycles_) }
+
+static const uint16_t s_half_second[] = { 500, 500 };
+static const uint16_t s_fast[] = { 100, 100 };
+static const uint16_t s_flash[] = { 50, 1950 };
+static const uint16_t s_quarter_second[] = { 250, 250 };
+static const uint16_t s_channel_change[] = { 500, 7500 };
+
+static const status_led_pattern_t s_pattern_identify = STATUS_LED_PATTERN(s_half_second, 0);
+static const status_led_pattern_t s_pattern_steering = STATUS_LED_PATTERN(s_fast, 0);
+static const status_led_pattern_t s_pattern_offline = STATUS_LED_PATTERN(s_flash, 0);
+static const status_led_pattern_t s_pattern_blink = STATUS_LED_PATTERN(s_half_second, 1);
+static const status_led_pattern_t s_pattern_breathe = STATUS_LED_PATTERN(s_half_second, 15);
+static const status_led_pattern_t s_pattern_okay = STATUS_LED_PATTERN(s_quarter_second, 2);
+static const status_led_pattern_t s_pattern_channel_change = STATUS_LED_PATTERN(s_channel_change, 1);
+
+/* Requested state, written by any task under s_lock */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static status_led_net_t s_net = STATUS_LED_NET_OFFLINE;
+static bool s_relay_on = false;
+static bool s_identify = false;
+static const status_led_pattern_t *s_effect = NULL;
+static bool s_finish = false;
+static bool s_changed = false;
+
+/** Pin and active level from the hardware profile, fixed in status_led_init() */
+static uint8_t s_pin = HW_PROFILE_PIN_NONE;
+static uint32_t s_active_level = STATUS_LED_ACTIVE_LEVEL;
+
+/* Playback, timer_wheel task only */
+static timer_wheel_timer_t s_timer;
+static const status_led_pattern_t *s_active = NULL;
+static uint8_t s_step = 0;
+static uint8_t s_cycle = 0;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void status_led_write(bool on);
+static void status_led_kick(void);
+static const status_led_pattern_t *status_led_select(bool *steady_on);
+static void status_led_timer_cb(void *arg);
+static void status_led_on_relay_changed(const app_event_t *event, void *ctx);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static void status_led_write(bool on)
+{
+    gpio_set_level((gpio_num_t)s_pin, on ? s_active_level : !s_active_level);
+}
+
+/** Let the timer callback pick up a changed request (any task) */
+static void status_led_kick(void)
+{
+    if (s_pin == HW_PROFILE_PIN_NONE) {
+        /* No LED fitted, nothing to play */
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_changed = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    timer_wheel_arm(&s_timer, 0, status_led_timer_cb, NULL);
+}
+
+/**
+ * @brief Highest-priority pattern for the requested state (called with s_lock held)
+ *
+ * @param[out] steady_on LED level if no pattern is returned
+ * @return Pattern, or NULL for a steady LED
+ */
+static const status_led_pattern_t *status_led_select(bool *steady_on)
+{
+    *steady_on = false;
+
+    if (s_effect) {
+        return s_effect;
+    }
+    if (s_identify) {
+        return &s_pattern_identify;
+    }
+    switch (s_net) {
+        case STATUS_LED_NET_STEERING:
+            return &s_pattern_steering;
+        case STATUS_LED_NET_JOINED:
+            *steady_on = s_relay_on;
+            return NULL;
+        case STATUS_LED_NET_OFFLINE:
+        default:
+            return &s_pattern_offline;
+    }
+}
+
+/** Play the next step (timer_wheel task) */
+static void status_led_timer_cb(void *arg)
+{
+    (void)arg;
+    const status_led_pattern_t *pattern;
+    bool steady_on;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_changed) {
+        s_changed = false;
+        pattern = status_led_select(&steady_on);
+        if (pattern != s_active) {
+            s_active = pattern;
+            s_step = 0;
+            s_cycle = 0;
+        }
+    } else if (s_active && ++s_step == s_active->count) {
+        s_step = 0;
+        s_cycle++;
+        if (s_active == s_effect && (s_finish || (s_active->cycles && s_cycle >= s_active->cycles))) {
+            /* Effect played, fall back to the state below it */
+            s_effect = NULL;
+            s_finish = false;
+        }
+        pattern = status_led_select(&steady_on);
+        if (pattern != s_active) {
+            s_active = pattern;
+            s_cycle = 0;
+        }
+    } else {
+        status_led_select(&steady_on);
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!s_active) {
+        status_led_write(steady_on);
+        return;
+    }
+
+    /* Even steps are on, odd steps off */
+    status_led_write((s_step & 1) == 0);
+    timer_wheel_arm(&s_timer, s_active->steps[s_step], status_led_timer_cb, NULL);
+
+    /* A request that raced with the arm above must not wait for this step */
+    portENTER_CRITICAL(&s_lock);
+    bool changed = s_changed;
+    portEXIT_CRITICAL(&s_lock);
+    if (changed) {
+        timer_wheel_arm(&s_timer, 0, status_led_timer_cb, NULL);
+    }
+}
+
+static void status_led_on_relay_changed(const app_event_t *event, void *ctx)
+{
+    (void)ctx;
+
+    portENTER_CRITICAL(&s_lock);
+    s_relay_on = event->relay.on;
+    portEXIT_CRITICAL(&s_lock);
+
+    status_led_kick();
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t status_led_init(void)
+{
+    const hw_profile_t *profile = hw_profile_get();
+
+    if (profile->led_pin == HW_PROFILE_PIN_NONE) {
+        APP_LOGI("No status LED in the hardware profile");
+        return ESP_OK;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << profile->led_pin),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    ESP_RETURN_ON_ERROR(gpio_config(&io_conf), TAG, "Failed to configure GPIO%u", profile->led_pin);
+    s_pin = profile->led_pin;
+    s_active_level = profile->led_active_level;
+    status_led_write(false);
+
+    ESP_RETURN_ON_ERROR(app_event_subscribe(APP_EVENT_MASK(APP_EVENT_RELAY_CHANGED),
+                                            status_led_on_relay_changed, NULL),
+                        TAG, "Failed to subscribe to relay events");
+
+    status_led_kick();
+    APP_LOGI("Status LED on GPIO%u", s_pin);
+    return ESP_OK;
+}
+
+void status_led_set_network(status_led_net_t state)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_net = state;
+    portEXIT_CRITICAL(&s_lock);
+
+    status_led_kick();
+}
+
+void status_led_identify(uint8_t identify_on)
+{
+    APP_LOGI("Identify %s", identify_on ? "started" : "stopped");
+
+    portENTER_CRITICAL(&s_lock);
+    s_identify = identify_on != 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    status_led_kick();
+}
+
+esp_err_t status_led_on_identify_effect(const esp_zb_zcl_identify_effect_message_t *message)
+{
+    const status_led_pattern_t *effect;
+
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    APP_LOGI("Identify effect 0x%02x", message->effect_id);
+
+    switch (message->effect_id) {
+        case STATUS_LED_EFFECT_BLINK:
+            effect = &s_pattern_blink;
+            break;
+        case STATUS_LED_EFFECT_BREATHE:
+            effect = &s_pattern_breathe;
+            break;
+        case STATUS_LED_EFFECT_OKAY:
+            effect = &s_pattern_okay;
+            break;
+        case STATUS_LED_EFFECT_CHANNEL_CHANGE:
+            effect = &s_pattern_channel_change;
+            break;
+        case STATUS_LED_EFFECT_FINISH:
+            /* Ends after the current cycle, no restart needed */
+            portENTER_CRITICAL(&s_lock);
+            s_finish = s_effect != NULL;
+            portEXIT_CRITICAL(&s_lock);
+            return ESP_OK;
+        case STATUS_LED_EFFECT_STOP:
+            effect = NULL;
+            break;
+        default:
+            APP_LOGW("Unknown effect 0x%02x", message->effect_id);
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_effect = effect;
+    s_finish = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    status_led_kick();
+    return ESP_OK;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file status_led.h
+ * @brief Status LED and Identify effects for ESP32-C6 Zigbee Fan Switch
+ *
+ * Drives one plain LED on a GPIO. Which pattern runs depends on, from the
+ * highest priority down:
+ *   1. Identify (Zigbee2MQTT "identify", Identify Time > 0): 0.5 s on/off
+ *      until the identify time runs out; Trigger Effect commands play their
+ *      effect once (blink, breathe, okay, channel change), "finish effect"
+ *      ends it after the current cycle and "stop effect" at once
+ *   2. Network steering: fast blink (100 ms on/off)
+ *   3. Not on a network: short flash every 2 s
+ *   4. On a network: the LED shows the relay state (ON = lit)
+ *
+ * Patterns are lists of on/off durations played by a timer wheel timer, so
+ * nothing polls or busy-waits and nothing runs while the LED is steady.
+ *
+ * Hardware note: the addressable RGB LED of the ESP32-C6-DevKitC sits on
+ * GPIO8, which this project uses for the relay, so it cannot be used for
+ * status; connect a LED (with series resistor) to the pin of the hardware
+ * profile (default STATUS_LED_GPIO_PIN).
+ * An on/off LED cannot fade, so "breathe" is played as slow blinking.
+ */
+
+#ifndef STATUS_LED_H
+#define STATUS_LED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Default GPIO pin of the status LED (used without a stored hardware profile) */
+#ifndef STATUS_LED_GPIO_PIN
+#define STATUS_LED_GPIO_PIN         15
+#endif
+
+/** @brief Default level that lights the LED (1 = active high) */
+#ifndef STATUS_LED_ACTIVE_LEVEL
+#define STATUS_LED_ACTIVE_LEVEL     1
+#endif
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Network state shown while no identify effect runs
+ */
+typedef enum {
+    STATUS_LED_NET_OFFLINE = 0,     /**< Not on a network */
+    STATUS_LED_NET_STEERING,        /**< Searching for a network */
+    STATUS_LED_NET_JOINED,          /**< On a network, LED follows the relay */
+} status_led_net_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Configure the GPIO and follow relay changes
+ *
+ * Call after timer_wheel_init() and relay_init().
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t status_led_init(void);
+
+/**
+ * @brief Set the network state (any task)
+ */
+void status_led_set_network(status_led_net_t state);
+
+/**
+ * @brief Identify notification from the stack (Zigbee task)
+ *
+ * Has the esp_zb_identify_notify_callback_t signature.
+ *
+ * @param identify_on Non-zero while Identify Time is running
+ */
+void status_led_identify(uint8_t identify_on);
+
+/**
+ * @brief Handle a Trigger Effect command (Zigbee task)
+ */
+esp_err_t status_led_on_identify_effect(const esp_zb_zcl_identify_effect_message_t *message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATUS_LED_H */
@@ -0,0 +1,229 @@
+/**
+ * @file telemetry.c
+ * @brief Heap and stack telemetry implementation
+ *
+ * Sampling is driven by esp_zb_scheduler_alarm(), so every sample and every
+ * attribute update happens in the Zigbee task.
+ */
+
+#include "telemetry.h"
+#include "zigbee_handler.h"
+#include "event_trace.h"
+#include "esp_timer.h"
+#define APP_LOG_MODULE_LEVEL    TELEMETRY_LOG_LEVEL
+#include "app_log.h"
+#include <string.h>
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "TELEMETRY";
+
+/** Size of the history attribute payload (without the length byte) */
+#define HISTORY_BYTES   (TELEMETRY_RING_SIZE * sizeof(telemetry_sample_t))
+
+/** Size of the event trace attribute payload (without the length byte) */
+#define TRACE_BYTES     (TELEMETRY_TRACE_EVENTS * sizeof(event_trace_entry_t))
+
+_Static_assert(HISTORY_BYTES <= 254, "history does not fit into a ZCL octet string");
+_Static_assert(TRACE_BYTES <= 254, "event trace does not fit into a ZCL octet string");
+
+/** Ring buffer of samples */
+static telemetry_sample_t s_ring[TELEMETRY_RING_SIZE];
+static uint8_t s_ring_head = 0;     /* Next slot to write */
+static uint8_t s_ring_count = 0;
+
+/** Protects the ring against readers outside the Zigbee task */
+static portMUX_TYPE s_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** Watched tasks */
+static TaskHandle_t s_zb_task = NULL;
+static TaskHandle_t s_tasks[TELEMETRY_MAX_TASKS];
+static uint8_t s_task_count = 0;
+
+/** Scratch buffer for the string attributes (length byte + payload) */
+static uint8_t s_string_attr[1 + (HISTORY_BYTES > TRACE_BYTES ? HISTORY_BYTES : TRACE_BYTES)];
+
+/* -----------------------------------------------------------------------------
+ * ZCL attribute defaults (flash-resident)
+ *
+ * The SDK sizes string attribute storage from the initial value, so the
+ * history and trace defaults have their full length.
+ * ----------------------------------------------------------------------------- */
+
+static const uint32_t s_zero_u32 = 0;
+static const uint8_t s_history_default[1 + HISTORY_BYTES] = { HISTORY_BYTES };
+static const uint8_t s_trace_default[1 + TRACE_BYTES] = { TRACE_BYTES };
+
+#define TELEMETRY_ACCESS_REPORTED   (ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING)
+
+const zb_ep_attr_desc_t telemetry_zcl_attrs[TELEMETRY_ZCL_ATTR_COUNT] = {
+    { TELEMETRY_ATTR_HEAP_FREE_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, TELEMETRY_ACCESS_REPORTED, &s_zero_u32 },
+    { TELEMETRY_ATTR_HEAP_MIN_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, TELEMETRY_ACCESS_REPORTED, &s_zero_u32 },
+    { TELEMETRY_ATTR_HEAP_LARGEST_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, TELEMETRY_ACCESS_REPORTED, &s_zero_u32 },
+    { TELEMETRY_ATTR_ZB_STACK_FREE_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, TELEMETRY_ACCESS_REPORTED, &s_zero_u32 },
+    { TELEMETRY_ATTR_TASK_STACK_FREE_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, TELEMETRY_ACCESS_REPORTED, &s_zero_u32 },
+    { TELEMETRY_ATTR_UPTIME_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u32 },
+    { TELEMETRY_ATTR_HISTORY_ID, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY,
+      s_history_default },
+    { TELEMETRY_ATTR_EVENT_TRACE_ID, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY,
+      s_trace_default },
+};
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void telemetry_take_sample(telemetry_sample_t *sample);
+static void telemetry_publish(const telemetry_sample_t *sample);
+static void telemetry_alarm_cb(uint8_t param);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/**
+ * @brief Fill a sample from the heap allocator and the watched tasks
+ */
+static void telemetry_take_sample(telemetry_sample_t *sample)
+{
+    zb_heap_snapshot_t heap;
+    zb_heap_snapshot(&heap);
+
+    sample->uptime_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    sample->heap_free = heap.free_bytes;
+    sample->heap_min = heap.min_free_bytes;
+    sample->heap_largest = heap.largest_block;
+
+    /* ESP-IDF reports the high-water mark in bytes */
+    sample->zb_stack_free = s_zb_task ? (uint16_t)uxTaskGetStackHighWaterMark(s_zb_task) : 0;
+
+    UBaseType_t lowest = UINT16_MAX;
+    for (uint8_t i = 0; i < s_task_count; i++) {
+        UBaseType_t hwm = uxTaskGetStackHighWaterMark(s_tasks[i]);
+        if (hwm < lowest) {
+            lowest = hwm;
+        }
+    }
+    sample->task_stack_free = s_task_count ? (uint16_t)lowest : 0;
+}
+
+/**
+ * @brief Write a sample, the history and the event trace into the Telemetry cluster
+ */
+static void telemetry_publish(const telemetry_sample_t *sample)
+{
+    uint32_t values[] = {
+        sample->heap_free, sample->heap_min, sample->heap_largest,
+        sample->zb_stack_free, sample->task_stack_free, sample->uptime_s,
+    };
+
+    for (uint16_t id = TELEMETRY_ATTR_HEAP_FREE_ID; id <= TELEMETRY_ATTR_UPTIME_ID; id++) {
+        esp_zb_zcl_set_attribute_val(ZIGBEE_ENDPOINT, TELEMETRY_CLUSTER_ID,
+                                     ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, id, &values[id], false);
+    }
+
+    size_t count = telemetry_get_history((telemetry_sample_t *)&s_string_attr[1],
+                                         TELEMETRY_RING_SIZE);
+    s_string_attr[0] = (uint8_t)(count * sizeof(telemetry_sample_t));
+    esp_zb_zcl_set_attribute_val(ZIGBEE_ENDPOINT, TELEMETRY_CLUSTER_ID,
+                                 ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, TELEMETRY_ATTR_HISTORY_ID,
+                                 s_string_attr, false);
+    
+    count = event_trace_copy_recent((event_trace_entry_t *)&s_string_attr[1], TELEMETRY_TRACE_EVENTS);
+    s_string_attr[0] = (uint8_t)(count * sizeof(event_trace_entry_t));
+    esp_zb_zcl_set_attribute_val(ZIGBEE_ENDPOINT, TELEMETRY_CLUSTER_ID,
+                                 ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, TELEMETRY_ATTR_EVENT_TRACE_ID,
+                                 s_string_attr, false);
+}
+
+/**
+ * @brief Periodic sampler, runs in the Zigbee task
+ */
+static void telemetry_alarm_cb(uint8_t param)
+{
+    (void)param;
+    telemetry_sample_t sample;
+
+    telemetry_take_sample(&sample);
+
+    portENTER_CRITICAL(&s_ring_lock);
+    s_ring[s_ring_head] = sample;
+    s_ring_head = (s_ring_head + 1) % TELEMETRY_RING_SIZE;
+    if (s_ring_count < TELEMETRY_RING_SIZE) {
+        s_ring_count++;
+    }
+    portEXIT_CRITICAL(&s_ring_lock);
+
+    telemetry_publish(&sample);
+
+    APP_LOGD("Heap free %lu, min %lu, largest %lu; stack free zb %u, tasks %u",
+             (unsigned long)sample.heap_free, (unsigned long)sample.heap_min,
+             (unsigned long)sample.heap_largest, sample.zb_stack_free, sample.task_stack_free);
+
+    if (sample.heap_min < TELEMETRY_HEAP_WARN_BYTES) {
+        APP_LOGW("Low heap: minimum free %lu bytes, largest block %lu bytes",
+                 (unsigned long)sample.heap_min, (unsigned long)sample.heap_largest);
+    }
+
+    esp_zb_scheduler_alarm(telemetry_alarm_cb, 0, TELEMETRY_SAMPLE_INTERVAL_MS);
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t telemetry_register_task(TaskHandle_t task, bool is_zigbee_task)
+{
+    if (!task) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (is_zigbee_task) {
+        s_zb_task = task;
+        return ESP_OK;
+    }
+
+    if (s_task_count >= TELEMETRY_MAX_TASKS) {
+        APP_LOGW("Task table full, not watching %s", pcTaskGetName(task));
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_tasks[s_task_count++] = task;
+    return ESP_OK;
+}
+
+void telemetry_start(void)
+{
+    APP_LOGI("Sampling every %d s (%d samples kept)",
+             TELEMETRY_SAMPLE_INTERVAL_MS / 1000, TELEMETRY_RING_SIZE);
+    telemetry_alarm_cb(0);
+}
+
+bool telemetry_get_latest(telemetry_sample_t *sample)
+{
+    bool available;
+
+    portENTER_CRITICAL(&s_ring_lock);
+    available = s_ring_count > 0;
+    if (available) {
+        *sample = s_ring[(s_ring_head + TELEMETRY_RING_SIZE - 1) % TELEMETRY_RING_SIZE];
+    }
+    portEXIT_CRITICAL(&s_ring_lock);
+
+    return available;
+}
+
+size_t telemetry_get_history(telemetry_sample_t *samples, size_t max_samples)
+{
+    portENTER_CRITICAL(&s_ring_lock);
+    size_t count = s_ring_count < max_samples ? s_ring_count : max_samples;
+    size_t first = (s_ring_head + TELEMETRY_RING_SIZE - count) % TELEMETRY_RING_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(&samples[i], &s_ring[(first + i) % TELEMETRY_RING_SIZE], sizeof(telemetry_sample_t));
+    }
+    portEXIT_CRITICAL(&s_ring_lock);
+
+    return count;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file telemetry.h
+ * @brief Heap and stack telemetry for ESP32-C6 Zigbee Fan Switch
+ *
+ * A periodic sampler records free heap, minimum free heap, largest free
+ * block and the stack high-water marks of the Zigbee main loop and other
+ * registered tasks. The samples are kept in a small ring buffer and published
+ * through a manufacturer-specific cluster on the fan endpoint, so they can be
+ * trended from Zigbee2MQTT.
+ *
+ * The sampler runs from the Zigbee scheduler, i.e. in the Zigbee task, and
+ * therefore may update ZCL attributes without taking the Zigbee lock.
+ *
+ * Manufacturer-specific Telemetry cluster (TELEMETRY_CLUSTER_ID):
+ *   0x0000  Heap free bytes            (uint32, reportable)
+ *   0x0001  Heap minimum free bytes    (uint32, reportable)
+ *   0x0002  Heap largest free block    (uint32, reportable)
+ *   0x0003  Zigbee task stack free     (uint32, bytes, reportable)
+ *   0x0004  Lowest other task stack    (uint32, bytes, reportable)
+ *   0x0005  Uptime                     (uint32, seconds)
+ *   0x0006  Sample history             (octet string, packed samples)
+ *   0x0007  Event trace                (octet string, newest events, see event_trace.h)
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "zb_endpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Sampling interval in milliseconds */
+#define TELEMETRY_SAMPLE_INTERVAL_MS    60000
+
+/** @brief Number of samples kept in the ring buffer */
+#define TELEMETRY_RING_SIZE             12
+
+/** @brief Maximum number of tasks whose stack is watched (besides Zigbee) */
+#define TELEMETRY_MAX_TASKS             6
+
+/** @brief Minimum free heap below which a warning is logged */
+#define TELEMETRY_HEAP_WARN_BYTES       (16 * 1024)
+
+/** @brief Manufacturer-specific Telemetry cluster ID */
+#define TELEMETRY_CLUSTER_ID            0xFC10
+
+/* Telemetry cluster attribute IDs */
+#define TELEMETRY_ATTR_HEAP_FREE_ID         0x0000
+#define TELEMETRY_ATTR_HEAP_MIN_ID          0x0001
+#define TELEMETRY_ATTR_HEAP_LARGEST_ID      0x0002
+#define TELEMETRY_ATTR_ZB_STACK_FREE_ID     0x0003
+#define TELEMETRY_ATTR_TASK_STACK_FREE_ID   0x0004
+#define TELEMETRY_ATTR_UPTIME_ID            0x0005
+#define TELEMETRY_ATTR_HISTORY_ID           0x0006
+#define TELEMETRY_ATTR_EVENT_TRACE_ID       0x0007
+
+/** @brief Number of trace events published in TELEMETRY_ATTR_EVENT_TRACE_ID */
+#define TELEMETRY_TRACE_EVENTS              30
+
+/** @brief Number of attributes in telemetry_zcl_attrs */
+#define TELEMETRY_ZCL_ATTR_COUNT            8
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief One telemetry sample (20 bytes, packed as sent in the history)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t uptime_s;          /**< Seconds since boot */
+    uint32_t heap_free;         /**< Free heap in bytes */
+    uint32_t heap_min;          /**< Minimum free heap since boot in bytes */
+    uint32_t heap_largest;      /**< Largest free block in bytes */
+    uint16_t zb_stack_free;     /**< Unused stack of the Zigbee task in bytes */
+    uint16_t task_stack_free;   /**< Lowest unused stack of other tasks in bytes */
+} telemetry_sample_t;
+
+/** Attribute table of the Telemetry cluster (see zb_endpoint.h) */
+extern const zb_ep_attr_desc_t telemetry_zcl_attrs[TELEMETRY_ZCL_ATTR_COUNT];
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Register a task whose stack high-water mark is sampled
+ *
+ * @param task Task handle
+ * @param is_zigbee_task true for the Zigbee main loop task
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the task table is full
+ */
+esp_err_t telemetry_register_task(TaskHandle_t task, bool is_zigbee_task);
+
+/**
+ * @brief Start periodic sampling
+ *
+ * Must be called from the Zigbee task after the stack has been started.
+ * Takes a first sample immediately.
+ */
+void telemetry_start(void);
+
+/**
+ * @brief Get the most recent sample
+ *
+ * @param[out] sample Sample to fill
+ * @return true if a sample was available
+ */
+bool telemetry_get_latest(telemetry_sample_t *sample);
+
+/**
+ * @brief Copy the sample history, oldest first
+ *
+ * @param[out] samples Destination array
+ * @param max_samples Capacity of samples
+ * @return Number of samples copied
+ */
+size_t telemetry_get_history(telemetry_sample_t *samples, size_t max_samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
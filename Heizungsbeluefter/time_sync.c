@@ -0,0 +1,258 @@
+/**
+ * @file time_sync.c
+ * @brief Wall clock from the coordinator's Time cluster, implementation
+ */
+
+#include "time_sync.h"
+#include "app_event.h"
+#include "zigbee_handler.h"
+#include "timer_wheel.h"
+#include "zcl_codec.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include <sys/time.h>
+#define APP_LOG_MODULE_LEVEL    TIME_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "TIME";
+
+/** Seconds between 1970-01-01 (Unix) and 2000-01-01 (ZCL UTCTime) */
+#define ZCL_UTC_EPOCH_OFFSET    946684800UL
+
+/** ZCL invalid value for UTCTime and uint32 */
+#define ZCL_TIME_INVALID        0xFFFFFFFFUL
+
+#define TIME_RTC_MAGIC          0x54494D31  /* "TIM1" */
+
+#define TIME_NVS_NAMESPACE      "time"
+#define TIME_NVS_KEY            "last_sync"
+
+/** Survives software resets together with the system clock */
+typedef struct {
+    uint32_t magic;
+    int32_t utc_offset_s;
+} time_rtc_state_t;
+
+static RTC_NOINIT_ATTR time_rtc_state_t s_rtc;
+
+/** Last sync, kept in NVS for power-on */
+typedef struct {
+    uint32_t unix_s;
+    int32_t utc_offset_s;
+} time_nvs_state_t;
+
+static timer_wheel_timer_t s_request_timer;
+static time_sync_status_t s_status = TIME_SYNC_NONE;
+static int32_t s_utc_offset_s = 0;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void time_sync_request_cb(void *arg);
+static void time_sync_on_joined(const app_event_t *event, void *ctx);
+static void time_sync_save(uint32_t unix_s, int32_t utc_offset_s);
+static bool time_sync_load(time_nvs_state_t *state);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static void time_sync_save(uint32_t unix_s, int32_t utc_offset_s)
+{
+    time_nvs_state_t state = { .unix_s = unix_s, .utc_offset_s = utc_offset_s };
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(TIME_NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, TIME_NVS_KEY, &state, sizeof(state));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        APP_LOGW("Failed to store sync time: %s", esp_err_to_name(ret));
+    }
+}
+
+static bool time_sync_load(time_nvs_state_t *state)
+{
+    nvs_handle_t handle;
+    size_t size = sizeof(*state);
+    esp_err_t ret = nvs_open(TIME_NVS_NAMESPACE, NVS_READONLY, &handle);
+
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, TIME_NVS_KEY, state, &size);
+        nvs_close(handle);
+    }
+    return ret == ESP_OK && size == sizeof(*state);
+}
+
+/**
+ * @brief Read Time and LocalTime from the coordinator (timer_wheel task)
+ */
+static void time_sync_request_cb(void *arg)
+{
+    (void)arg;
+    uint16_t attrs[] = { ESP_ZB_ZCL_ATTR_TIME_TIME_ID, ESP_ZB_ZCL_ATTR_TIME_LOCAL_TIME_ID };
+    esp_zb_zcl_read_attr_cmd_t read_cmd = {
+        .zcl_basic_cmd = {
+            .dst_addr_u.addr_short = 0x0000,  /* Coordinator */
+            .dst_endpoint = TIME_SYNC_SERVER_ENDPOINT,
+            .src_endpoint = ZIGBEE_ENDPOINT,
+        },
+        .address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .clusterID = ESP_ZB_ZCL_CLUSTER_ID_TIME,
+        .attr_number = sizeof(attrs) / sizeof(attrs[0]),
+        .attr_field = attrs,
+    };
+
+    APP_LOGD("Requesting time from coordinator");
+    bool locked = zigbee_handler_lock();
+    esp_zb_zcl_read_attr_cmd_req(&read_cmd);
+    zigbee_handler_unlock(locked);
+
+    /* Also acts as the retry until an answer arrives */
+    timer_wheel_arm(&s_request_timer,
+                    s_status == TIME_SYNC_SYNCED ? TIME_SYNC_INTERVAL_MS : TIME_SYNC_RETRY_MS,
+                    time_sync_request_cb, NULL);
+}
+
+static void time_sync_on_joined(const app_event_t *event, void *ctx)
+{
+    (void)event;
+    (void)ctx;
+
+    timer_wheel_arm(&s_request_timer, TIME_SYNC_JOIN_DELAY_MS, time_sync_request_cb, NULL);
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+void time_sync_init(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+
+    if (reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT &&
+        s_rtc.magic == TIME_RTC_MAGIC && now.tv_sec >= TIME_SYNC_VALID_MIN_UNIX) {
+        /* The system clock kept running through the reset */
+        s_utc_offset_s = s_rtc.utc_offset_s;
+        s_status = TIME_SYNC_RTC;
+        APP_LOGI("Clock kept across reset: %lld (UTC%+ld s)",
+                 (long long)now.tv_sec, (long)s_utc_offset_s);
+    } else {
+        time_nvs_state_t state;
+
+        s_rtc.magic = 0;
+        if (time_sync_load(&state) && state.unix_s >= TIME_SYNC_VALID_MIN_UNIX) {
+            struct timeval tv = { .tv_sec = state.unix_s, .tv_usec = 0 };
+            settimeofday(&tv, NULL);
+            s_utc_offset_s = state.utc_offset_s;
+            s_status = TIME_SYNC_ESTIMATED;
+            APP_LOGI("Clock estimated from last sync: %lu, waiting for coordinator",
+                     (unsigned long)state.unix_s);
+        } else {
+            APP_LOGI("Clock not set, waiting for coordinator");
+        }
+    }
+
+    if (app_event_subscribe(APP_EVENT_MASK(APP_EVENT_ZB_JOINED), time_sync_on_joined, NULL) != ESP_OK) {
+        APP_LOGE("Failed to subscribe to join events");
+    }
+}
+
+void time_sync_on_read_attr_resp(const esp_zb_zcl_cmd_read_attr_resp_message_t *message)
+{
+    uint32_t utc = ZCL_TIME_INVALID;
+    uint32_t local = ZCL_TIME_INVALID;
+
+    if (!message || message->info.cluster != ESP_ZB_ZCL_CLUSTER_ID_TIME) {
+        return;
+    }
+
+    for (const esp_zb_zcl_read_attr_resp_variable_t *var = message->variables; var; var = var->next) {
+        uint32_t value;
+
+        /* Time is UTC time, LocalTime uint32; anything else is ignored */
+        if (var->status != ESP_ZB_ZCL_STATUS_SUCCESS ||
+            zcl_codec_validate(var->attribute.data.type, var->attribute.data.value,
+                               var->attribute.data.size) != ESP_OK ||
+            zcl_codec_read_uint(var->attribute.data.type, var->attribute.data.value,
+                                &value) != ESP_OK) {
+            continue;
+        }
+        if (var->attribute.id == ESP_ZB_ZCL_ATTR_TIME_TIME_ID) {
+            utc = value;
+        } else if (var->attribute.id == ESP_ZB_ZCL_ATTR_TIME_LOCAL_TIME_ID) {
+            local = value;
+        }
+    }
+
+    if (utc == ZCL_TIME_INVALID || utc + ZCL_UTC_EPOCH_OFFSET < TIME_SYNC_VALID_MIN_UNIX) {
+        APP_LOGW("Coordinator time not set");
+        return;
+    }
+
+    struct timeval before;
+    gettimeofday(&before, NULL);
+
+    uint32_t unix_s = utc + ZCL_UTC_EPOCH_OFFSET;
+    struct timeval tv = { .tv_sec = unix_s, .tv_usec = 0 };
+    settimeofday(&tv, NULL);
+
+    int32_t offset_s = local != ZCL_TIME_INVALID ? (int32_t)(local - utc) : 0;
+    bool first = s_status != TIME_SYNC_SYNCED;
+    s_utc_offset_s = offset_s;
+    s_status = TIME_SYNC_SYNCED;
+    s_rtc.utc_offset_s = offset_s;
+    s_rtc.magic = TIME_RTC_MAGIC;
+
+    time_sync_save(unix_s, offset_s);
+
+    int32_t step_s = (int32_t)((int64_t)unix_s - before.tv_sec);
+    if (first) {
+        APP_LOGI("Clock synced: %lu (UTC%+ld s), step %ld s",
+                 (unsigned long)unix_s, (long)offset_s, (long)step_s);
+        /* Switch from the retry to the regular interval */
+        timer_wheel_arm(&s_request_timer, TIME_SYNC_INTERVAL_MS, time_sync_request_cb, NULL);
+    } else {
+        APP_LOGD("Clock re-synced, step %ld s", (long)step_s);
+    }
+
+    app_event_t event = {
+        .type = APP_EVENT_TIME_CHANGED,
+        .source = APP_EVENT_SRC_ZIGBEE,
+        .time = { .status = TIME_SYNC_SYNCED, .step_s = step_s },
+    };
+    app_event_publish(&event);
+}
+
+time_sync_status_t time_sync_status(void)
+{
+    return s_status;
+}
+
+bool time_sync_get_local(time_t *local_s)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    *local_s = now.tv_sec + s_utc_offset_s;
+
+    return s_status == TIME_SYNC_RTC || s_status == TIME_SYNC_SYNCED;
+}
+
+int32_t time_sync_utc_offset(void)
+{
+    return s_utc_offset_s;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file time_sync.h
+ * @brief Wall clock from the coordinator's Time cluster
+ *
+ * The fan endpoint has a Time cluster client. After joining, and every
+ * TIME_SYNC_INTERVAL_MS afterwards, Time (UTC) and LocalTime are read from
+ * the coordinator. UTC goes into the system clock (settimeofday), the
+ * difference to LocalTime is kept as the UTC offset (time zone plus DST).
+ *
+ * Across reboots:
+ *   - Software, watchdog and panic resets keep the system clock, which runs
+ *     from the RTC timer. A marker in RTC no-init memory says whether it was
+ *     synced before, so the clock is trusted right away (TIME_SYNC_RTC).
+ *   - After power loss only the last sync (stored in NVS) is known. The clock
+ *     is set to it as a lower bound (TIME_SYNC_ESTIMATED) and not trusted
+ *     for schedules until the next sync.
+ *
+ * Every sync is published as APP_EVENT_TIME_CHANGED.
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Re-sync interval once synced */
+#define TIME_SYNC_INTERVAL_MS           (6UL * 3600UL * 1000UL)
+
+/** @brief Retry interval while no answer was received */
+#define TIME_SYNC_RETRY_MS              60000
+
+/** @brief Delay of the first request after joining */
+#define TIME_SYNC_JOIN_DELAY_MS         5000
+
+/** @brief Coordinator endpoint serving the Time cluster */
+#define TIME_SYNC_SERVER_ENDPOINT       1
+
+/** @brief Clock values below this (2024-01-01) are treated as unset */
+#define TIME_SYNC_VALID_MIN_UNIX        1704067200
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief How trustworthy the clock is
+ */
+typedef enum {
+    TIME_SYNC_NONE = 0,         /**< Never synced */
+    TIME_SYNC_ESTIMATED,        /**< Last sync before power loss, clock is behind */
+    TIME_SYNC_RTC,              /**< Carried across a reset by the RTC */
+    TIME_SYNC_SYNCED,           /**< Synced from the coordinator since boot */
+} time_sync_status_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Restore the clock after a reset and follow network joins
+ *
+ * Call after nvs_flash_init(), before zigbee_handler_start().
+ */
+void time_sync_init(void);
+
+/**
+ * @brief Handle a read attributes response (Zigbee task)
+ *
+ * Called by the Zigbee handler for every read attributes response; only
+ * Time cluster responses are used.
+ *
+ * @param message Response from the stack
+ */
+void time_sync_on_read_attr_resp(const esp_zb_zcl_cmd_read_attr_resp_message_t *message);
+
+/**
+ * @brief Get the clock status
+ */
+time_sync_status_t time_sync_status(void);
+
+/**
+ * @brief Get the local time (UTC plus offset)
+ *
+ * @param[out] local_s Seconds since 1970-01-01 in local time
+ * @return true if the clock can be trusted (TIME_SYNC_RTC or TIME_SYNC_SYNCED)
+ */
+bool time_sync_get_local(time_t *local_s);
+
+/**
+ * @brief Get the UTC offset of local time in seconds
+ */
+int32_t time_sync_utc_offset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIME_SYNC_H */
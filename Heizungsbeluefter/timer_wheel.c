@@ -0,0 +1,469 @@
+/**
+ * @file timer_wheel.c
+ * @brief Hierarchical timer wheel implementation
+ *
+ * The wheel core (wheel_*) works on a wheel_t and knows nothing about time
+ * sources or locking, so the benchmark can run it on a private instance.
+ * The driver around it owns the live wheel, the mutex, the esp_timer and
+ * the callback task.
+ *
+ * Slot lists are intrusive and doubly linked. Expired timers are moved to
+ * one extra list and handed to their callbacks one by one, so cancelling a
+ * timer that already expired but did not run yet still stops it.
+ */
+
+#include "timer_wheel.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+#define APP_LOG_MODULE_LEVEL    TIMER_LOG_LEVEL
+#include "app_log.h"
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+static const char *TAG = "TIMER";
+
+#define WHEEL_BITS              6
+#define WHEEL_SLOTS             (1U << WHEEL_BITS)
+#define WHEEL_MASK              (WHEEL_SLOTS - 1)
+
+/** Slot lists of all levels, plus the expired list */
+#define WHEEL_EXPIRED           (TIMER_WHEEL_LEVELS * WHEEL_SLOTS)
+#define WHEEL_LISTS             (WHEEL_EXPIRED + 1)
+
+#define TIMER_WHEEL_TICK_US     (TIMER_WHEEL_TICK_MS * 1000)
+
+/** Above the Zigbee task, callbacks are short */
+#define TIMER_WHEEL_TASK_PRIORITY   6
+#define TIMER_WHEEL_TASK_STACK      4096
+
+/** Bench pool, a power of two */
+#define TIMER_WHEEL_BENCH_POOL      256
+
+typedef struct {
+    uint32_t now;                               /**< Last processed tick */
+    uint64_t occupied[TIMER_WHEEL_LEVELS];      /**< Non-empty slots per level */
+    timer_wheel_timer_t *lists[WHEEL_LISTS];
+    uint32_t pending;
+    uint32_t cascaded;
+} wheel_t;
+
+static wheel_t s_wheel;
+static SemaphoreHandle_t s_mutex = NULL;
+static esp_timer_handle_t s_hw_timer = NULL;
+static TaskHandle_t s_task = NULL;
+
+/** Tick the hardware timer is armed for */
+static bool s_hw_armed = false;
+static uint32_t s_hw_target = 0;
+
+static timer_wheel_stats_t s_stats;
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static void wheel_push(wheel_t *w, uint16_t list, timer_wheel_timer_t *timer);
+static void wheel_unlink(wheel_t *w, timer_wheel_timer_t *timer);
+static void wheel_insert(wheel_t *w, timer_wheel_timer_t *timer);
+static void wheel_cascade(wheel_t *w, uint8_t level);
+static bool wheel_next_event(const wheel_t *w, uint32_t *delta);
+static void wheel_advance(wheel_t *w, uint32_t target);
+static uint32_t timer_wheel_ticks(uint32_t delay_ms);
+static uint32_t timer_wheel_now(void);
+static void timer_wheel_program(void);
+static void timer_wheel_hw_cb(void *arg);
+static void timer_wheel_task(void *arg);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+static void wheel_push(wheel_t *w, uint16_t list, timer_wheel_timer_t *timer)
+{
+    timer_wheel_timer_t *head = w->lists[list];
+
+    timer->prev = NULL;
+    timer->next = head;
+    if (head) {
+        head->prev = timer;
+    }
+    w->lists[list] = timer;
+    timer->slot = list + 1;
+
+    if (list < WHEEL_EXPIRED) {
+        w->occupied[list / WHEEL_SLOTS] |= 1ULL << (list % WHEEL_SLOTS);
+    }
+}
+
+static void wheel_unlink(wheel_t *w, timer_wheel_timer_t *timer)
+{
+    uint16_t list = timer->slot - 1;
+
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        w->lists[list] = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->slot = 0;
+
+    if (list < WHEEL_EXPIRED && !w->lists[list]) {
+        w->occupied[list / WHEEL_SLOTS] &= ~(1ULL << (list % WHEEL_SLOTS));
+    }
+}
+
+/**
+ * @brief Put a timer into the slot for its distance to now
+ *
+ * Level L takes distances below 64^(L+1); the slot is the expiry's digit of
+ * that level, so a slot comes up exactly when its timers are 64^L or less
+ * ticks away.
+ */
+static void wheel_insert(wheel_t *w, timer_wheel_timer_t *timer)
+{
+    uint32_t delta = timer->expires - w->now;
+    uint8_t level = delta ? (uint8_t)((31 - __builtin_clz(delta)) / WHEEL_BITS) : 0;
+
+    if (level >= TIMER_WHEEL_LEVELS) {
+        level = TIMER_WHEEL_LEVELS - 1;
+    }
+    uint16_t index = (timer->expires >> (level * WHEEL_BITS)) & WHEEL_MASK;
+    wheel_push(w, level * WHEEL_SLOTS + index, timer);
+}
+
+/**
+ * @brief Move the current slot of a level one or more levels down
+ */
+static void wheel_cascade(wheel_t *w, uint8_t level)
+{
+    uint16_t list = level * WHEEL_SLOTS + ((w->now >> (level * WHEEL_BITS)) & WHEEL_MASK);
+    timer_wheel_timer_t *timer = w->lists[list];
+
+    w->lists[list] = NULL;
+    w->occupied[level] &= ~(1ULL << (list % WHEEL_SLOTS));
+
+    while (timer) {
+        timer_wheel_timer_t *next = timer->next;
+        wheel_insert(w, timer);
+        w->cascaded++;
+        timer = next;
+    }
+}
+
+/**
+ * @brief Ticks from now to the next expiry or cascade
+ *
+ * Per level, the next occupied slot after the current one is found by
+ * rotating the bitmap and counting trailing zeros.
+ *
+ * @return false if the wheel is empty
+ */
+static bool wheel_next_event(const wheel_t *w, uint32_t *delta)
+{
+    bool found = false;
+
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t bits = w->occupied[level];
+        if (!bits) {
+            continue;
+        }
+
+        uint8_t shift = level * WHEEL_BITS;
+        uint8_t current = (w->now >> shift) & WHEEL_MASK;
+        uint8_t rotate = (current + 1) & WHEEL_MASK;
+        uint64_t rotated = rotate ? (bits >> rotate) | (bits << (WHEEL_SLOTS - rotate)) : bits;
+        uint32_t slots_ahead = (uint32_t)__builtin_ctzll(rotated) + 1;
+
+        /* Level 0 slots expire, higher ones cascade at their slot boundary */
+        uint32_t event = level ? (((w->now >> shift) + slots_ahead) << shift) - w->now : slots_ahead;
+        if (!found || event < *delta) {
+            *delta = event;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Process all ticks up to target, jumping over ticks without events
+ *
+ * Expired timers end up on the expired list.
+ */
+static void wheel_advance(wheel_t *w, uint32_t target)
+{
+    uint32_t delta;
+
+    while ((int32_t)(target - w->now) > 0) {
+        if (!wheel_next_event(w, &delta) || delta > target - w->now) {
+            w->now = target;
+            break;
+        }
+        w->now += delta;
+
+        for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (w->now & ((1UL << (level * WHEEL_BITS)) - 1)) {
+                break;
+            }
+            wheel_cascade(w, level);
+        }
+
+        uint16_t list = w->now & WHEEL_MASK;
+        timer_wheel_timer_t *timer = w->lists[list];
+        w->lists[list] = NULL;
+        w->occupied[0] &= ~(1ULL << list);
+
+        while (timer) {
+            timer_wheel_timer_t *next = timer->next;
+            wheel_push(w, WHEEL_EXPIRED, timer);
+            timer = next;
+        }
+    }
+}
+
+/** Round up, plus one tick because the current tick has partly passed */
+static uint32_t timer_wheel_ticks(uint32_t delay_ms)
+{
+    return delay_ms / TIMER_WHEEL_TICK_MS + (delay_ms % TIMER_WHEEL_TICK_MS ? 1 : 0) + 1;
+}
+
+static uint32_t timer_wheel_now(void)
+{
+    return (uint32_t)(esp_timer_get_time() / TIMER_WHEEL_TICK_US);
+}
+
+/**
+ * @brief Arm the hardware timer for the next wheel event (mutex held)
+ */
+static void timer_wheel_program(void)
+{
+    uint32_t delta;
+
+    if (!wheel_next_event(&s_wheel, &delta)) {
+        if (s_hw_armed) {
+            esp_timer_stop(s_hw_timer);
+            s_hw_armed = false;
+        }
+        return;
+    }
+
+    uint32_t target = s_wheel.now + delta;
+    if (s_hw_armed && target == s_hw_target) {
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t wait_us = (int64_t)(int32_t)(target - (uint32_t)(now_us / TIMER_WHEEL_TICK_US)) *
+                      TIMER_WHEEL_TICK_US - now_us % TIMER_WHEEL_TICK_US;
+
+    esp_timer_stop(s_hw_timer);
+    esp_timer_start_once(s_hw_timer, wait_us > 0 ? (uint64_t)wait_us : 0);
+    s_hw_armed = true;
+    s_hw_target = target;
+}
+
+/**
+ * @brief Hardware timer (esp_timer task): hand over to the wheel task
+ */
+static void timer_wheel_hw_cb(void *arg)
+{
+    (void)arg;
+    xTaskNotifyGive(s_task);
+}
+
+static void timer_wheel_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        s_stats.wakeups++;
+        s_hw_armed = false;
+        wheel_advance(&s_wheel, timer_wheel_now());
+
+        /* One at a time: a callback may cancel the next one */
+        timer_wheel_timer_t *timer;
+        while ((timer = s_wheel.lists[WHEEL_EXPIRED]) != NULL) {
+            timer_wheel_cb_t cb = timer->cb;
+            void *cb_arg = timer->arg;
+
+            wheel_unlink(&s_wheel, timer);
+            s_wheel.pending--;
+            s_stats.expired++;
+            xSemaphoreGive(s_mutex);
+
+            cb(cb_arg);
+
+            xSemaphoreTake(s_mutex, portMAX_DELAY);
+        }
+
+        timer_wheel_program();
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+esp_err_t timer_wheel_init(void)
+{
+    s_mutex = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(s_mutex, ESP_ERR_NO_MEM, TAG, "Failed to create mutex");
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = timer_wheel_hw_cb,
+        .name = "timer_wheel",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &s_hw_timer), TAG, "Failed to create timer");
+
+    BaseType_t created = xTaskCreate(timer_wheel_task, "timer_wheel", TIMER_WHEEL_TASK_STACK, NULL,
+                                     TIMER_WHEEL_TASK_PRIORITY, &s_task);
+    ESP_RETURN_ON_FALSE(created == pdPASS, ESP_ERR_NO_MEM, TAG, "Failed to create task");
+
+    s_wheel.now = timer_wheel_now();
+
+    APP_LOGI("Timer wheel ready: %d levels, %d ms tick", TIMER_WHEEL_LEVELS, TIMER_WHEEL_TICK_MS);
+
+    return ESP_OK;
+}
+
+void timer_wheel_arm(timer_wheel_timer_t *timer, uint32_t delay_ms, timer_wheel_cb_t cb, void *arg)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (timer->slot) {
+        wheel_unlink(&s_wheel, timer);
+    } else {
+        s_wheel.pending++;
+    }
+
+    timer->cb = cb;
+    timer->arg = arg;
+    timer->expires = timer_wheel_now() + timer_wheel_ticks(delay_ms);
+    wheel_insert(&s_wheel, timer);
+    s_stats.armed++;
+
+    /* Only an earlier deadline needs the hardware timer moved */
+    if (!s_hw_armed || (int32_t)(timer->expires - s_hw_target) < 0) {
+        timer_wheel_program();
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void timer_wheel_cancel(timer_wheel_timer_t *timer)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    /* The hardware timer stays armed, a spare wakeup costs less than reprogramming */
+    if (timer->slot) {
+        wheel_unlink(&s_wheel, timer);
+        s_wheel.pending--;
+        s_stats.cancelled++;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+bool timer_wheel_is_pending(const timer_wheel_timer_t *timer)
+{
+    return timer->slot != 0;
+}
+
+uint32_t timer_wheel_next_deadline_ms(void)
+{
+    uint32_t delta;
+    uint32_t deadline_ms = UINT32_MAX;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (wheel_next_event(&s_wheel, &delta)) {
+        int32_t ticks = (int32_t)(s_wheel.now + delta - timer_wheel_now());
+        deadline_ms = ticks > 0 ? (uint32_t)ticks * TIMER_WHEEL_TICK_MS : 0;
+    }
+    xSemaphoreGive(s_mutex);
+
+    return deadline_ms;
+}
+
+void timer_wheel_get_stats(timer_wheel_stats_t *stats)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    stats->cascaded = s_wheel.cascaded;
+    stats->pending = s_wheel.pending;
+    xSemaphoreGive(s_mutex);
+}
+
+esp_err_t timer_wheel_bench(uint32_t ops, timer_wheel_bench_t *result)
+{
+    wheel_t *w = calloc(1, sizeof(*w));
+    timer_wheel_timer_t *pool = calloc(TIMER_WHEEL_BENCH_POOL, sizeof(*pool));
+    uint64_t arm_total = 0;
+    uint64_t cancel_total = 0;
+    uint32_t cancels = 0;
+    uint32_t seed = 0x2545F491;
+
+    memset(result, 0, sizeof(*result));
+    if (!w || !pool) {
+        free(w);
+        free(pool);
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint32_t i = 0; i < ops; i++) {
+        timer_wheel_timer_t *timer = &pool[i & (TIMER_WHEEL_BENCH_POOL - 1)];
+
+        /* xorshift32, delays spread over all levels */
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        uint32_t ticks = ((seed >> (seed & 31)) & 0x3FFFFFFE) + 1;
+
+        if (timer->slot) {
+            esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+            wheel_unlink(w, timer);
+            uint32_t cycles = esp_cpu_get_cycle_count() - start;
+            cancel_total += cycles;
+            cancels++;
+            if (cycles > result->cancel_cycles_max) {
+                result->cancel_cycles_max = cycles;
+            }
+        }
+
+        esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+        timer->expires = w->now + ticks;
+        wheel_insert(w, timer);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        arm_total += cycles;
+        if (cycles > result->arm_cycles_max) {
+            result->arm_cycles_max = cycles;
+        }
+
+        /* Let time pass now and then, so slots cascade and expire */
+        if ((i & 63) == 63) {
+            wheel_advance(w, w->now + 1);
+            while (w->lists[WHEEL_EXPIRED]) {
+                wheel_unlink(w, w->lists[WHEEL_EXPIRED]);
+            }
+        }
+    }
+
+    result->arm_cycles_avg = ops ? (uint32_t)(arm_total / ops) : 0;
+    result->cancel_cycles_avg = cancels ? (uint32_t)(cancel_total / cancels) : 0;
+
+    free(w);
+    free(pool);
+    return ESP_OK;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file timer_wheel.h
+ * @brief Hierarchical timer wheel for ESP32-C6 Zigbee Fan Switch
+ *
+ * One place for all delayed application actions (relay lockouts, schedule,
+ * time sync, ...) instead of one esp_timer or Zigbee scheduler alarm each.
+ *
+ * The wheel has TIMER_WHEEL_LEVELS levels of 64 slots. Level 0 slots are one
+ * tick (TIMER_WHEEL_TICK_MS) wide, every level above is 64 times coarser.
+ * A timer is placed by its distance to the expiry and moves down a level when
+ * its slot comes up (cascade), so arm and cancel are O(1): a list insert or
+ * unlink plus a bit in the per-level occupancy bitmap.
+ *
+ * The wheel is driven by one esp_timer, armed one-shot for the next wheel
+ * event (expiry or cascade), which the bitmaps give in O(levels). Nothing
+ * ticks while no timer is due, so the chip can stay in automatic light sleep
+ * until timer_wheel_next_deadline_ms() from now.
+ *
+ * Callbacks run in the "timer_wheel" task, one at a time and without any
+ * lock held. They may arm and cancel timers, including their own. Code that
+ * touches the Zigbee stack must take zigbee_handler_lock().
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Tick length; timers fire on tick boundaries, never early */
+#define TIMER_WHEEL_TICK_MS         10
+
+/**
+ * @brief Number of levels
+ *
+ * 64^5 ticks of 10 ms are 124 days, so every uint32_t delay in milliseconds
+ * (up to 49 days) fits without clamping.
+ */
+#define TIMER_WHEEL_LEVELS          5
+
+/** @brief Arm/cancel pairs of timer_wheel_bench() in bench builds */
+#define TIMER_WHEEL_BENCH_OPS       100000
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+typedef void (*timer_wheel_cb_t)(void *arg);
+
+/**
+ * @brief A timer, owned by the caller
+ *
+ * Zero-initialized (static storage) it is idle; the fields are private to
+ * the wheel.
+ */
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer *next;
+    struct timer_wheel_timer *prev;
+    uint32_t expires;           /**< Tick */
+    uint16_t slot;              /**< Slot index + 1, 0 = idle */
+    timer_wheel_cb_t cb;
+    void *arg;
+} timer_wheel_timer_t;
+
+/**
+ * @brief Wheel counters
+ */
+typedef struct {
+    uint32_t armed;
+    uint32_t cancelled;
+    uint32_t expired;
+    uint32_t cascaded;          /**< Timers moved down a level */
+    uint32_t wakeups;           /**< Hardware timer callbacks */
+    uint32_t pending;           /**< Currently armed */
+} timer_wheel_stats_t;
+
+/**
+ * @brief Result of timer_wheel_bench()
+ */
+typedef struct {
+    uint32_t arm_cycles_avg;
+    uint32_t arm_cycles_max;
+    uint32_t cancel_cycles_avg;
+    uint32_t cancel_cycles_max;
+} timer_wheel_bench_t;
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Create the hardware timer and the callback task
+ *
+ * Call first in setup(), before any module arms a timer.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t timer_wheel_init(void);
+
+/**
+ * @brief Arm (or re-arm) a timer
+ *
+ * Not callable from ISRs.
+ *
+ * @param timer Timer, re-armed if already pending
+ * @param delay_ms Delay, rounded up to whole ticks
+ * @param cb Callback (timer_wheel task)
+ * @param arg Callback argument
+ */
+void timer_wheel_arm(timer_wheel_timer_t *timer, uint32_t delay_ms, timer_wheel_cb_t cb, void *arg);
+
+/**
+ * @brief Cancel a timer
+ *
+ * After return the callback will not start; a callback already running is
+ * not waited for. Cancelling an idle timer does nothing.
+ */
+void timer_wheel_cancel(timer_wheel_timer_t *timer);
+
+/**
+ * @brief Check whether a timer is armed
+ */
+bool timer_wheel_is_pending(const timer_wheel_timer_t *timer);
+
+/**
+ * @brief Time until the wheel needs the CPU next
+ *
+ * @return Milliseconds until the next expiry or cascade, UINT32_MAX if idle
+ */
+uint32_t timer_wheel_next_deadline_ms(void);
+
+/**
+ * @brief Get a copy of the wheel counters
+ *
+ * @param[out] stats Destination
+ */
+void timer_wheel_get_stats(timer_wheel_stats_t *stats);
+
+/**
+ * @brief Measure arm and cancel on a private wheel
+ *
+ * Arms @p ops timers with random delays over the whole range, cancelling
+ * each pool entry before it is re-armed. The live wheel is not touched; the
+ * bench wheel and its timers are allocated for the run only.
+ *
+ * @param ops Number of arm/cancel pairs
+ * @param[out] result CPU cycles per operation
+ * @return ESP_OK, or ESP_ERR_NO_MEM
+ */
+esp_err_t timer_wheel_bench(uint32_t ops, timer_wheel_bench_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,126 @@
+/**
+ * @file zb_endpoint.h
+ * @brief Table-driven Zigbee endpoint construction for ESP32-C6 Fan Switch
+ *
+ * The endpoint is described by constant tables (clusters and their
+ * attributes with default values). Declared `static const`, the tables are
+ * placed in flash (.rodata) and cost no RAM. The builder walks the tables
+ * once at boot and hands every cluster to the Zigbee SDK.
+ *
+ * The module also provides a small heap snapshot helper that is used to
+ * report how much heap the endpoint construction consumed.
+ */
+
+#ifndef ZB_ENDPOINT_H
+#define ZB_ENDPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Description of a single attribute
+ *
+ * The default value is copied by the Zigbee SDK when the attribute is added,
+ * so it may (and should) point into read-only memory.
+ */
+typedef struct {
+    uint16_t id;            /**< Attribute ID */
+    uint8_t type;           /**< ZCL data type (ESP_ZB_ZCL_ATTR_TYPE_*) */
+    uint8_t access;         /**< Access flags (ESP_ZB_ZCL_ATTR_ACCESS_*) */
+    const void *value;      /**< Default value */
+} zb_ep_attr_desc_t;
+
+/**
+ * @brief Signature shared by all esp_zb_cluster_list_add_*_cluster() functions
+ */
+typedef esp_err_t (*zb_ep_cluster_add_fn_t)(esp_zb_cluster_list_t *cluster_list,
+                                            esp_zb_attribute_list_t *attr_list,
+                                            uint8_t role_mask);
+
+/**
+ * @brief Description of a single cluster
+ */
+typedef struct {
+    uint16_t cluster_id;                /**< Cluster ID */
+    uint8_t role;                       /**< ESP_ZB_ZCL_CLUSTER_SERVER_ROLE / CLIENT_ROLE */
+    zb_ep_cluster_add_fn_t add;         /**< SDK function adding the cluster to a list */
+    const zb_ep_attr_desc_t *attrs;     /**< Attribute table */
+    uint8_t attr_count;                 /**< Number of entries in attrs */
+} zb_ep_cluster_desc_t;
+
+/**
+ * @brief Snapshot of the default heap
+ */
+typedef struct {
+    size_t free_bytes;          /**< Currently free bytes */
+    size_t min_free_bytes;      /**< Lowest free bytes since boot */
+    size_t largest_block;       /**< Largest allocatable block */
+    size_t allocated_blocks;    /**< Number of live allocations */
+} zb_heap_snapshot_t;
+
+/** First manufacturer-specific cluster ID */
+#define ZB_EP_MANUF_CLUSTER_ID_MIN  0xFC00
+
+/** First manufacturer-specific attribute ID within a standard cluster */
+#define ZB_EP_MANUF_ATTR_ID_MIN     0xF000
+
+/** Manufacturer code of manufacturer-specific attributes in standard clusters (Espressif) */
+#define ZB_EP_MANUF_CODE            0x131B
+
+/** Number of elements of a static table */
+#define ZB_EP_TABLE_LEN(table)  (sizeof(table) / sizeof((table)[0]))
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Add clusters described by a constant table to a cluster list
+ *
+ * Creates one attribute list per cluster, adds all attributes of the table
+ * and attaches the cluster to the list in one pass. Attributes of
+ * manufacturer-specific clusters (ID >= 0xFC00) are added as custom
+ * attributes. Attributes with ID >= 0xF000 in standard clusters are added
+ * as manufacturer-specific attributes with ZB_EP_MANUF_CODE, so they are
+ * only read with that code and never mixed with the standard ones.
+ *
+ * @param cluster_list Cluster list to extend
+ * @param clusters Cluster table
+ * @param cluster_count Number of entries in clusters
+ * @return ESP_OK on success, error code of the first failing cluster otherwise
+ */
+esp_err_t zb_endpoint_add_clusters(esp_zb_cluster_list_t *cluster_list,
+                                   const zb_ep_cluster_desc_t *clusters, size_t cluster_count);
+
+/**
+ * @brief Take a snapshot of the default heap
+ *
+ * @param[out] snapshot Snapshot to fill
+ */
+void zb_heap_snapshot(zb_heap_snapshot_t *snapshot);
+
+/**
+ * @brief Log the difference between two heap snapshots
+ *
+ * @param what Short description of the measured operation
+ * @param before Snapshot taken before the operation
+ * @param after Snapshot taken after the operation
+ */
+void zb_heap_report(const char *what, const zb_heap_snapshot_t *before,
+                    const zb_heap_snapshot_t *after);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZB_ENDPOINT_H */
@@ -0,0 +1,191 @@
+/**
+ * @file zcl_codec.c
+ * @brief ZCL attribute value codec implementation
+ *
+ * Type classes follow the ZCL type numbering: the low three bits of the
+ * data, bitmap, unsigned and signed integer ranges give the size in bytes
+ * minus one. Every length is taken from the type or the length prefix and
+ * checked against the size before a byte is read.
+ */
+
+#include "zcl_codec.h"
+#include "esp_zigbee_core.h"
+#include <string.h>
+
+/* =============================================================================
+ * Private Constants and Variables
+ * ============================================================================= */
+
+/** Longest short string, 0xFF marks an invalid one */
+#define ZCL_CODEC_STRING_MAX        0xFE
+
+/** Length prefix value of a long string meaning "no value" */
+#define ZCL_CODEC_LONG_STRING_INVALID   0xFFFF
+
+/* =============================================================================
+ * Private Function Declarations
+ * ============================================================================= */
+
+static size_t zcl_codec_string_prefix(uint8_t type);
+static uint16_t zcl_codec_string_len(const uint8_t *value, size_t prefix);
+static bool zcl_codec_is_uint(uint8_t type);
+
+/* =============================================================================
+ * Private Function Implementations
+ * ============================================================================= */
+
+/** Size of the length prefix of a string type, 0 for other types */
+static size_t zcl_codec_string_prefix(uint8_t type)
+{
+    switch (type) {
+        case ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING:
+        case ESP_ZB_ZCL_ATTR_TYPE_CHAR_STRING:
+            return 1;
+        case ESP_ZB_ZCL_ATTR_TYPE_LONG_OCTET_STRING:
+        case ESP_ZB_ZCL_ATTR_TYPE_LONG_CHAR_STRING:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+/** Number of string bytes, invalid strings are empty */
+static uint16_t zcl_codec_string_len(const uint8_t *value, size_t prefix)
+{
+    if (prefix == 1) {
+        return value[0] == ZCL_CODEC_STRING_INVALID ? 0 : value[0];
+    }
+
+    uint16_t len = (uint16_t)(value[0] | (value[1] << 8));
+    return len == ZCL_CODEC_LONG_STRING_INVALID ? 0 : len;
+}
+
+/** Types read by zcl_codec_read_uint() */
+static bool zcl_codec_is_uint(uint8_t type)
+{
+    return type == ESP_ZB_ZCL_ATTR_TYPE_BOOL ||
+           (type >= ESP_ZB_ZCL_ATTR_TYPE_8BIT && type <= ESP_ZB_ZCL_ATTR_TYPE_64BIT) ||
+           (type >= ESP_ZB_ZCL_ATTR_TYPE_8BITMAP && type <= ESP_ZB_ZCL_ATTR_TYPE_64BITMAP) ||
+           (type >= ESP_ZB_ZCL_ATTR_TYPE_U8 && type <= ESP_ZB_ZCL_ATTR_TYPE_U64) ||
+           type == ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM || type == ESP_ZB_ZCL_ATTR_TYPE_16BIT_ENUM ||
+           type == ESP_ZB_ZCL_ATTR_TYPE_UTC_TIME;
+}
+
+/* =============================================================================
+ * Public Function Implementations
+ * ============================================================================= */
+
+size_t zcl_codec_fixed_size(uint8_t type)
+{
+    if ((type >= ESP_ZB_ZCL_ATTR_TYPE_8BIT && type <= ESP_ZB_ZCL_ATTR_TYPE_64BIT) ||
+        (type >= ESP_ZB_ZCL_ATTR_TYPE_8BITMAP && type <= ESP_ZB_ZCL_ATTR_TYPE_64BITMAP) ||
+        (type >= ESP_ZB_ZCL_ATTR_TYPE_U8 && type <= ESP_ZB_ZCL_ATTR_TYPE_S64)) {
+        return (type & 0x07) + 1;
+    }
+
+    switch (type) {
+        case ESP_ZB_ZCL_ATTR_TYPE_BOOL:
+        case ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM:
+            return 1;
+        case ESP_ZB_ZCL_ATTR_TYPE_16BIT_ENUM:
+        case ESP_ZB_ZCL_ATTR_TYPE_SEMI:
+        case ESP_ZB_ZCL_ATTR_TYPE_CLUSTER_ID:
+        case ESP_ZB_ZCL_ATTR_TYPE_ATTRIBUTE_ID:
+            return 2;
+        case ESP_ZB_ZCL_ATTR_TYPE_SINGLE:
+        case ESP_ZB_ZCL_ATTR_TYPE_TIME_OF_DAY:
+        case ESP_ZB_ZCL_ATTR_TYPE_DATE:
+        case ESP_ZB_ZCL_ATTR_TYPE_UTC_TIME:
+        case ESP_ZB_ZCL_ATTR_TYPE_BACNET_OID:
+            return 4;
+        case ESP_ZB_ZCL_ATTR_TYPE_DOUBLE:
+        case ESP_ZB_ZCL_ATTR_TYPE_IEEE_ADDR:
+            return 8;
+        case ESP_ZB_ZCL_ATTR_TYPE_128_BIT_KEY:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+esp_err_t zcl_codec_validate(uint8_t type, const void *value, uint16_t size)
+{
+    const uint8_t *bytes = value;
+
+    if (!bytes) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t fixed = zcl_codec_fixed_size(type);
+    if (fixed) {
+        if (size < fixed) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (type == ESP_ZB_ZCL_ATTR_TYPE_BOOL && bytes[0] > 1) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return ESP_OK;
+    }
+
+    size_t prefix = zcl_codec_string_prefix(type);
+    if (!prefix) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (size < prefix || prefix + zcl_codec_string_len(bytes, prefix) > size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t zcl_codec_read_uint(uint8_t type, const void *value, uint32_t *out)
+{
+    const uint8_t *bytes = value;
+    size_t size = zcl_codec_fixed_size(type);
+
+    if (!bytes || !out || !zcl_codec_is_uint(type) || size > sizeof(*out)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t result = 0;
+    for (size_t i = 0; i < size; i++) {
+        result |= (uint32_t)bytes[i] << (8 * i);
+    }
+    *out = result;
+    return ESP_OK;
+}
+
+esp_err_t zcl_codec_read_bool(uint8_t type, const void *value, bool *out)
+{
+    const uint8_t *bytes = value;
+
+    if (!bytes || !out || type != ESP_ZB_ZCL_ATTR_TYPE_BOOL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = bytes[0] != 0;
+    return ESP_OK;
+}
+
+esp_err_t zcl_codec_read_string(uint8_t type, const void *value, const uint8_t **data, uint16_t *len)
+{
+    const uint8_t *bytes = value;
+    size_t prefix = zcl_codec_string_prefix(type);
+
+    if (!bytes || !data || !len || !prefix) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *data = bytes + prefix;
+    *len = zcl_codec_string_len(bytes, prefix);
+    return ESP_OK;
+}
+
+size_t zcl_codec_write_octets(uint8_t *buf, size_t buf_size, const void *data, size_t len)
+{
+    if (!buf || (!data && len > 0) || len > ZCL_CODEC_STRING_MAX || 1 + len > buf_size) {
+        return 0;
+    }
+    buf[0] = (uint8_t)len;
+    if (len > 0) {
+        memcpy(&buf[1], data, len);
+    }
+    return 1 + len;
+}
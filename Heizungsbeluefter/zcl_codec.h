@@ -0,0 +1,114 @@
+/**
+ * @file zcl_codec.h
+ * @brief ZCL attribute value codec for ESP32-C6 Zigbee Fan Switch
+ *
+ * Values written by the network reach the application as a type, a pointer
+ * into stack memory and a size. zcl_codec_validate() checks such a value
+ * before anybody reads it: the pointer is set, the type is one the
+ * application can handle, the size covers the type, a string's length
+ * prefix stays inside the size and a boolean is 0 or 1. The readers then
+ * decode byte by byte (little endian, no alignment needed) and check the
+ * type class, so a subscriber never casts a stack pointer to a wider type.
+ *
+ * Nothing is allocated and no function logs; all functions may be called
+ * from any task.
+ */
+
+#ifndef ZCL_CODEC_H
+#define ZCL_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =============================================================================
+ * Configuration Constants
+ * ============================================================================= */
+
+/** @brief Length prefix value of a short string meaning "no value" */
+#define ZCL_CODEC_STRING_INVALID    0xFF
+
+/* =============================================================================
+ * Public Functions
+ * ============================================================================= */
+
+/**
+ * @brief Size of a fixed-size type
+ *
+ * @param type esp_zb_zcl_attr_type_t
+ * @return Size in bytes, 0 for strings, collections and unknown types
+ */
+size_t zcl_codec_fixed_size(uint8_t type);
+
+/**
+ * @brief Check a value before it is decoded
+ *
+ * Collections (array, structure, set, bag) are not used by the application
+ * and are rejected.
+ *
+ * @param type esp_zb_zcl_attr_type_t
+ * @param value Value in ZCL encoding
+ * @param size Size of the value as reported by the stack
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a missing pointer or a boolean
+ *         other than 0/1, ESP_ERR_NOT_SUPPORTED for an unknown type,
+ *         ESP_ERR_INVALID_SIZE if the size does not cover the value
+ */
+esp_err_t zcl_codec_validate(uint8_t type, const void *value, uint16_t size);
+
+/**
+ * @brief Read an unsigned value of up to 32 bits
+ *
+ * Accepts boolean, data, bitmap, unsigned integer and enumeration types of
+ * 1 to 4 bytes, and UTC time (seconds since 2000-01-01).
+ *
+ * @param type esp_zb_zcl_attr_type_t
+ * @param value Validated value
+ * @param[out] out Decoded value
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for any other type
+ */
+esp_err_t zcl_codec_read_uint(uint8_t type, const void *value, uint32_t *out);
+
+/**
+ * @brief Read a boolean
+ *
+ * @param type esp_zb_zcl_attr_type_t, must be boolean
+ * @param value Validated value
+ * @param[out] out Decoded value
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for any other type
+ */
+esp_err_t zcl_codec_read_bool(uint8_t type, const void *value, bool *out);
+
+/**
+ * @brief Locate the bytes of an octet or character string
+ *
+ * An invalid short string (length 0xFF) is read as empty.
+ *
+ * @param type esp_zb_zcl_attr_type_t, a short or long string type
+ * @param value Validated value
+ * @param[out] data First byte after the length prefix
+ * @param[out] len Number of bytes
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for any other type
+ */
+esp_err_t zcl_codec_read_string(uint8_t type, const void *value, const uint8_t **data, uint16_t *len);
+
+/**
+ * @brief Encode a short octet string
+ *
+ * @param[out] buf Destination, length prefix and bytes
+ * @param buf_size Size of @p buf
+ * @param data Bytes to encode
+ * @param len Number of bytes, at most 254
+ * @return Encoded size, or 0 if it does not fit
+ */
+size_t zcl_codec_write_octets(uint8_t *buf, size_t buf_size, const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZCL_CODEC_H */
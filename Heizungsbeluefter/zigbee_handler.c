@@ -5,15 +5,37 @@
  * This module implements:
  *   - Zigbee stack initialization for End Device role
  *   - On/Off Light endpoint creation with standard HA clusters
- *   - Attribute change callbacks for relay control
+ *   - Attribute change events for relay control, attribute updates for
+ *     local relay changes (see app_event.h)
  *   - ZDO signal handling for network events
  */
 
 #include "zigbee_handler.h"
+#include "app_event.h"
+#include "zb_endpoint.h"
+#include "relay_settings.h"
+#include "time_sync.h"
+#include "schedule.h"
+#include "scenes.h"
+#include "network.h"
+#include "hw_profile.h"
+#include "status_led.h"
+#include "current_sense.h"
+#include "telemetry.h"
+#include "diagnostics.h"
+#include "capture.h"
+#include "metrics.h"
+#include "event_trace.h"
+#include "perf_trace.h"
+#include "zcl_codec.h"
 #include "esp_zigbee_core.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "ha/esp_zigbee_ha_standard.h"
-#include "esp_log.h"
+#define APP_LOG_MODULE_LEVEL    ZIGBEE_LOG_LEVEL
+#include "app_log.h"
 #include "esp_check.h"
+#include "esp_cpu.h"
 #include <string.h>
 
 /* Compatibility defaults for Zigbee platform config (missing in some Arduino SDK releases) */
@@ -37,90 +59,176 @@
 
 static const char *TAG = "ZIGBEE";
 
-/** Callback function for On/Off commands from Zigbee network */
-static zigbee_on_off_callback_t s_on_off_callback = NULL;
+/** Task running the Zigbee main loop, NULL before zigbee_handler_start() */
+static TaskHandle_t s_zb_task = NULL;
+
+#if ZIGBEE_EP_STATIC_TABLES
+
+/* -----------------------------------------------------------------------------
+ * Endpoint description (flash-resident, see zb_endpoint.h)
+ * ----------------------------------------------------------------------------- */
+
+static const uint8_t s_zcl_version = ESP_ZB_ZCL_BASIC_ZCL_VERSION_DEFAULT_VALUE;
+static const uint8_t s_power_source = 0x01;        /* Mains single phase */
+static const uint8_t s_zero_u8 = 0;
+static const uint16_t s_zero_u16 = 0;
+static const bool s_false = false;
+
+/** Basic cluster (mandatory) - Contains manufacturer info */
+static const zb_ep_attr_desc_t s_basic_attrs[] = {
+    { ESP_ZB_ZCL_ATTR_BASIC_ZCL_VERSION_ID, ESP_ZB_ZCL_ATTR_TYPE_U8,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zcl_version },
+    { ESP_ZB_ZCL_ATTR_BASIC_POWER_SOURCE_ID, ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_power_source },
+    { ESP_ZB_ZCL_ATTR_BASIC_MANUFACTURER_NAME_ID, ESP_ZB_ZCL_ATTR_TYPE_CHAR_STRING,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, MANUFACTURER_NAME },
+    { ESP_ZB_ZCL_ATTR_BASIC_MODEL_IDENTIFIER_ID, ESP_ZB_ZCL_ATTR_TYPE_CHAR_STRING,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, MODEL_IDENTIFIER },
+};
+
+/** Identify cluster */
+static const zb_ep_attr_desc_t s_identify_attrs[] = {
+    { ESP_ZB_ZCL_ATTR_IDENTIFY_IDENTIFY_TIME_ID, ESP_ZB_ZCL_ATTR_TYPE_U16,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &s_zero_u16 },
+};
+
+/** Groups cluster */
+static const zb_ep_attr_desc_t s_groups_attrs[] = {
+    { ESP_ZB_ZCL_ATTR_GROUPS_NAME_SUPPORT_ID, ESP_ZB_ZCL_ATTR_TYPE_8BITMAP,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u8 },
+};
+
+/** Scenes cluster */
+static const zb_ep_attr_desc_t s_scenes_attrs[] = {
+    { ESP_ZB_ZCL_ATTR_SCENES_SCENE_COUNT_ID, ESP_ZB_ZCL_ATTR_TYPE_U8,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u8 },
+    { ESP_ZB_ZCL_ATTR_SCENES_CURRENT_SCENE_ID, ESP_ZB_ZCL_ATTR_TYPE_U8,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u8 },
+    { ESP_ZB_ZCL_ATTR_SCENES_CURRENT_GROUP_ID, ESP_ZB_ZCL_ATTR_TYPE_U16,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u16 },
+    { ESP_ZB_ZCL_ATTR_SCENES_SCENE_VALID_ID, ESP_ZB_ZCL_ATTR_TYPE_BOOL,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_false },
+    { ESP_ZB_ZCL_ATTR_SCENES_NAME_SUPPORT_ID, ESP_ZB_ZCL_ATTR_TYPE_8BITMAP,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_zero_u8 },
+};
+
+/** On/Off cluster (main functionality) - Initial state: OFF (failsafe) */
+static const zb_ep_attr_desc_t s_on_off_attrs[] = {
+    { ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID, ESP_ZB_ZCL_ATTR_TYPE_BOOL,
+      ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING |
+      ESP_ZB_ZCL_ATTR_ACCESS_SCENE, &s_false },
+};
+
+/** All server clusters of the fan endpoint */
+static const zb_ep_cluster_desc_t s_fan_clusters[] = {
+    { ESP_ZB_ZCL_CLUSTER_ID_BASIC, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_basic_cluster, s_basic_attrs, ZB_EP_TABLE_LEN(s_basic_attrs) },
+    { ESP_ZB_ZCL_CLUSTER_ID_IDENTIFY, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_identify_cluster, s_identify_attrs, ZB_EP_TABLE_LEN(s_identify_attrs) },
+    { ESP_ZB_ZCL_CLUSTER_ID_GROUPS, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_groups_cluster, s_groups_attrs, ZB_EP_TABLE_LEN(s_groups_attrs) },
+    { ESP_ZB_ZCL_CLUSTER_ID_SCENES, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_scenes_cluster, s_scenes_attrs, ZB_EP_TABLE_LEN(s_scenes_attrs) },
+    { ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_on_off_cluster, s_on_off_attrs, ZB_EP_TABLE_LEN(s_on_off_attrs) },
+};
+
+#endif /* ZIGBEE_EP_STATIC_TABLES */
+
+/** Application-specific clusters, added in both construction modes */
+static const zb_ep_cluster_desc_t s_app_clusters[] = {
+    { RELAY_SETTINGS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_custom_cluster, relay_settings_zcl_attrs, RELAY_SETTINGS_ZCL_ATTR_COUNT },
+    { SCHEDULE_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_custom_cluster, schedule_zcl_attrs, SCHEDULE_ZCL_ATTR_COUNT },
+    { HW_PROFILE_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_custom_cluster, hw_profile_zcl_attrs, HW_PROFILE_ZCL_ATTR_COUNT },
+    /* Client only, reads the wall clock from the coordinator (time_sync.c) */
+    { ESP_ZB_ZCL_CLUSTER_ID_TIME, ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE,
+      esp_zb_cluster_list_add_time_cluster, NULL, 0 },
+#if CURRENT_SENSE_ENABLE
+    { ESP_ZB_ZCL_CLUSTER_ID_ELECTRICAL_MEASUREMENT, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_electrical_meas_cluster, current_sense_elec_attrs, CURRENT_SENSE_ELEC_ATTR_COUNT },
+    { ESP_ZB_ZCL_CLUSTER_ID_METERING, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_metering_cluster, current_sense_meter_attrs, CURRENT_SENSE_METER_ATTR_COUNT },
+#endif
+#if ZIGBEE_DIAG_CLUSTERS
+    { ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_diagnostics_cluster, diagnostics_zcl_attrs, DIAGNOSTICS_ZCL_ATTR_COUNT },
+    { TELEMETRY_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_custom_cluster, telemetry_zcl_attrs, TELEMETRY_ZCL_ATTR_COUNT },
+    { METRICS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+      esp_zb_cluster_list_add_custom_cluster, metrics_zcl_attrs, METRICS_ZCL_ATTR_COUNT },
+#endif
+};
 
 /* =============================================================================
  * Private Function Declarations
  * ============================================================================= */
 
+static bool zb_lock(void);
+static void zb_unlock(bool locked);
 static void zb_zdo_signal_handler(esp_zb_app_signal_t *signal_struct);
+static bool zb_aps_indication_handler(esp_zb_apsde_data_ind_t ind);
+static void zb_aps_confirm_handler(esp_zb_apsde_data_confirm_t confirm);
+static esp_err_t zb_attribute_decode(const esp_zb_zcl_set_attr_value_message_t *message,
+                                     app_event_t *written, app_event_t *command);
 static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t *message);
 static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message);
+static void zb_on_relay_changed(const app_event_t *event, void *ctx);
 
 /* =============================================================================
  * Private Function Implementations
  * ============================================================================= */
 
+/**
+ * @brief Take the Zigbee lock unless called from the Zigbee task
+ * 
+ * The Zigbee task already holds the stack; other tasks must lock it before
+ * calling esp_zb_* functions.
+ * 
+ * @return true if the lock was taken and must be released with zb_unlock()
+ */
+static bool zb_lock(void)
+{
+    if (xTaskGetCurrentTaskHandle() == s_zb_task) {
+        return false;
+    }
+    esp_zb_lock_acquire(portMAX_DELAY);
+    return true;
+}
+
+static void zb_unlock(bool locked)
+{
+    if (locked) {
+        esp_zb_lock_release();
+    }
+}
+
 /**
  * @brief Handle Zigbee Device Object (ZDO) signals
  * 
- * This function processes network-related events such as:
- *   - Stack initialization
- *   - Network steering (joining)
- *   - Device announcements
+ * Network signals (startup, steering, leave, parent loss) drive the state
+ * machine in network.c; the rest is only logged.
  * 
  * @param signal_struct Signal information from Zigbee stack
  */
 static void zb_zdo_signal_handler(esp_zb_app_signal_t *signal_struct)
 {
+    PERF_TRACE_SCOPE("zb_zdo_signal");
     uint32_t *p_sg_p = signal_struct->p_app_signal;
     esp_err_t err_status = signal_struct->esp_err_status;
     esp_zb_app_signal_type_t sig_type = *p_sg_p;
     
-    switch (sig_type) {
-        case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
-            ESP_LOGI(TAG, "Zigbee stack initialized");
-            /* Start network steering (join network) */
-            esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
-            break;
-            
-        case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
-        case ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT:
-            if (err_status == ESP_OK) {
-                ESP_LOGI(TAG, "Device started up in %s mode",
-                         sig_type == ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START ? 
-                         "factory-reset" : "non factory-reset");
-                         
-                if (esp_zb_bdb_is_factory_new()) {
-                    ESP_LOGI(TAG, "Start network steering (searching for coordinator)");
-                    esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
-                } else {
-                    ESP_LOGI(TAG, "Device already commissioned, rejoining network");
-                }
-            } else {
-                ESP_LOGW(TAG, "Device startup failed, status: %s, retrying...", 
-                         esp_err_to_name(err_status));
-                esp_zb_scheduler_alarm((esp_zb_callback_t)esp_zb_bdb_start_top_level_commissioning,
-                                       ESP_ZB_BDB_MODE_NETWORK_STEERING, 1000);
-            }
-            break;
-            
-        case ESP_ZB_BDB_SIGNAL_STEERING:
-            if (err_status == ESP_OK) {
-                esp_zb_ieee_addr_t extended_pan_id;
-                esp_zb_get_extended_pan_id(extended_pan_id);
-                ESP_LOGI(TAG, "Joined network successfully!");
-                ESP_LOGI(TAG, "  Extended PAN ID: %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x",
-                         extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4],
-                         extended_pan_id[3], extended_pan_id[2], extended_pan_id[1], extended_pan_id[0]);
-                ESP_LOGI(TAG, "  PAN ID: 0x%04x", esp_zb_get_pan_id());
-                ESP_LOGI(TAG, "  Channel: %d", esp_zb_get_current_channel());
-                ESP_LOGI(TAG, "  Short Address: 0x%04x", esp_zb_get_short_address());
-            } else {
-                ESP_LOGW(TAG, "Network steering failed, status: %s", esp_err_to_name(err_status));
-                /* Retry steering after delay */
-                esp_zb_scheduler_alarm((esp_zb_callback_t)esp_zb_bdb_start_top_level_commissioning,
-                                       ESP_ZB_BDB_MODE_NETWORK_STEERING, 2000);
-            }
-            break;
-            
-        default:
-            ESP_LOGD(TAG, "ZDO signal: %s (0x%x), status: %s",
-                     esp_zb_zdo_signal_to_string(sig_type), sig_type,
-                     esp_err_to_name(err_status));
-            break;
+    event_trace_log(EVT_ZDO_SIGNAL, (uint8_t)sig_type, (uint16_t)err_status);
+    
+    /* Commissioning, leave and rejoin (network.c) */
+    if (network_on_signal(sig_type, err_status, esp_zb_app_signal_get_params(p_sg_p))) {
+        return;
     }
+    
+    APP_LOGD("ZDO signal: %s (0x%x), status: %s",
+             esp_zb_zdo_signal_to_string(sig_type), sig_type, esp_err_to_name(err_status));
 }
 
 /**
@@ -129,54 +237,161 @@ static void zb_zdo_signal_handler(esp_zb_app_signal_t *signal_struct)
 void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
 {
     if (!signal_struct) {
-        ESP_LOGW(TAG, "Received null Zigbee signal struct");
+        APP_LOGW("Received null Zigbee signal struct");
         return;
     }
     zb_zdo_signal_handler(signal_struct);
 }
 
+/**
+ * @brief Observe incoming APS data frames
+ * 
+ * @param ind APS data indication
+ * @return false so that the stack processes the frame as usual
+ */
+static bool zb_aps_indication_handler(esp_zb_apsde_data_ind_t ind)
+{
+    PERF_TRACE_INSTANT("zb_aps_rx");
+    metrics_count(METRIC_APS_RX);
+    diagnostics_on_aps_indication(&ind);
+    network_on_aps_indication(ind.dst_short_addr);
+    scenes_on_aps_indication(&ind);
+    capture_on_aps_indication(&ind);
+    return false;
+}
+
+/**
+ * @brief Observe confirmations of transmitted APS data frames
+ * 
+ * Only frames sent with esp_zb_aps_data_request() are confirmed here, not
+ * the reports and responses the stack sends.
+ * 
+ * @param confirm APS data confirm
+ */
+static void zb_aps_confirm_handler(esp_zb_apsde_data_confirm_t confirm)
+{
+    capture_on_aps_confirm(&confirm);
+}
+
+/**
+ * @brief Validate an attribute message and build the events it publishes
+ * 
+ * Neither logs, traces nor counts anything, so the command path benchmark
+ * can run it as often as it likes.
+ * 
+ * @param message Attribute change message with cluster/attribute info
+ * @param[out] written APP_EVENT_ZB_ATTR_WRITTEN event for the message
+ * @param[out] command APP_EVENT_ZB_ON_OFF_CMD event, or type
+ *                     APP_EVENT_TYPE_COUNT if the message is no On/Off command
+ * @return ESP_OK, or the zcl_codec error of a malformed value
+ */
+static esp_err_t zb_attribute_decode(const esp_zb_zcl_set_attr_value_message_t *message,
+                                     app_event_t *written, app_event_t *command)
+{
+    bool on_off_value;
+    
+    /* Subscribers decode the value, so nothing malformed gets past here */
+    esp_err_t ret = zcl_codec_validate(message->attribute.data.type, message->attribute.data.value,
+                                       message->attribute.data.size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    *written = (app_event_t) {
+        .type = APP_EVENT_ZB_ATTR_WRITTEN,
+        .source = APP_EVENT_SRC_ZIGBEE,
+        .zcl = {
+            .cluster = message->info.cluster,
+            .attr_id = message->attribute.id,
+            .attr_type = message->attribute.data.type,
+            .value = message->attribute.data.value,
+        },
+    };
+    
+    *command = *written;
+    command->type = APP_EVENT_TYPE_COUNT;
+    if (message->info.dst_endpoint == ZIGBEE_ENDPOINT &&
+        message->info.cluster == ESP_ZB_ZCL_CLUSTER_ID_ON_OFF &&
+        message->attribute.id == ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID &&
+        zcl_codec_read_bool(message->attribute.data.type, message->attribute.data.value,
+                            &on_off_value) == ESP_OK) {
+        command->type = APP_EVENT_ZB_ON_OFF_CMD;
+        command->relay.on = on_off_value;
+    }
+    
+    return ESP_OK;
+}
+
 /**
  * @brief Handle attribute value changes from Zigbee network
  * 
  * Called when an On/Off command is received and the attribute is updated.
+ * The value is validated (zcl_codec.h) before it is published; malformed
+ * values are logged and dropped.
  * 
  * @param message Attribute change message with cluster/attribute info
  * @return ESP_OK on success
  */
 static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t *message)
 {
-    esp_err_t ret = ESP_OK;
+    PERF_TRACE_SCOPE("zb_attribute");
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    app_event_t written;
+    app_event_t command;
     
     ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
     ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG,
                         TAG, "Received message: error status(%d)", message->info.status);
     
-    ESP_LOGI(TAG, "Received message: endpoint(%d), cluster(0x%x), attribute(0x%x), data size(%d)",
+    esp_err_t ret = zb_attribute_decode(message, &written, &command);
+    event_trace_log(EVT_ZCL_ATTR,
+                    ret == ESP_OK ? *(const uint8_t *)message->attribute.data.value : 0,
+                    message->info.cluster);
+    if (ret != ESP_OK) {
+        APP_LOGW("Rejected attribute 0x%x of cluster 0x%x: type 0x%02x, size %d: %s",
+                 message->attribute.id, message->info.cluster, message->attribute.data.type,
+                 message->attribute.data.size, esp_err_to_name(ret));
+        metrics_count(METRIC_ZCL_REJECTED);
+        return ret;
+    }
+    
+    APP_LOGI("Received message: endpoint(%d), cluster(0x%x), attribute(0x%x), data size(%d)",
              message->info.dst_endpoint, message->info.cluster,
              message->attribute.id, message->attribute.data.size);
+    app_event_publish(&written);
     
-    /* Handle On/Off cluster */
-    if (message->info.dst_endpoint == ZIGBEE_ENDPOINT) {
-        if (message->info.cluster == ESP_ZB_ZCL_CLUSTER_ID_ON_OFF) {
-            if (message->attribute.id == ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID &&
-                message->attribute.data.type == ESP_ZB_ZCL_ATTR_TYPE_BOOL) {
-                
-                bool on_off_value = message->attribute.data.value ? 
-                                    *(bool *)message->attribute.data.value : false;
-                
-                ESP_LOGI(TAG, "On/Off command received: %s", on_off_value ? "ON" : "OFF");
-                
-                /* Invoke callback to control relay */
-                if (s_on_off_callback) {
-                    s_on_off_callback(on_off_value);
-                }
-            }
-        }
+    if (command.type == APP_EVENT_ZB_ON_OFF_CMD) {
+        APP_LOGI("On/Off command received: %s", command.relay.on ? "ON" : "OFF");
+        
+        /* Subscribers switch the relay */
+        app_event_publish(&command);
     }
     
+    metrics_count(METRIC_ZCL_WRITES);
+    metrics_record(METRIC_ZCL_WRITE_CYCLES, esp_cpu_get_cycle_count() - start);
     return ret;
 }
 
+/**
+ * @brief Mirror local relay changes into the On/Off attribute
+ * 
+ * The attribute holds the desired state, which differs from the relay while
+ * a transition is deferred by the short-cycle protection. Changes that came
+ * from the network are already in the attribute. Local changes are written
+ * and reported right away instead of waiting for the next configured
+ * reporting interval.
+ */
+static void zb_on_relay_changed(const app_event_t *event, void *ctx)
+{
+    (void)ctx;
+    
+    if (event->source != APP_EVENT_SRC_ZIGBEE) {
+        if (zigbee_handler_set_on_off_attribute(event->relay.on) == ESP_OK) {
+            zigbee_handler_report_on_off();
+        }
+    }
+}
+
 /**
  * @brief Central action handler for Zigbee core callbacks
  * 
@@ -188,6 +403,7 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
  */
 static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message)
 {
+    PERF_TRACE_SCOPE("zb_action");
     esp_err_t ret = ESP_OK;
     
     switch (callback_id) {
@@ -195,8 +411,24 @@ static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id,
             ret = zb_attribute_handler((esp_zb_zcl_set_attr_value_message_t *)message);
             break;
             
+        case ESP_ZB_CORE_SCENES_STORE_SCENE_CB_ID:
+            ret = scenes_on_store((esp_zb_zcl_store_scene_message_t *)message);
+            break;
+            
+        case ESP_ZB_CORE_SCENES_RECALL_SCENE_CB_ID:
+            ret = scenes_on_recall((esp_zb_zcl_recall_scene_message_t *)message);
+            break;
+            
+        case ESP_ZB_CORE_IDENTIFY_EFFECT_CB_ID:
+            ret = status_led_on_identify_effect((esp_zb_zcl_identify_effect_message_t *)message);
+            break;
+            
+        case ESP_ZB_CORE_CMD_READ_ATTR_RESP_CB_ID:
+            time_sync_on_read_attr_resp((esp_zb_zcl_cmd_read_attr_resp_message_t *)message);
+            break;
+            
         default:
-            ESP_LOGW(TAG, "Receive Zigbee action(0x%x) callback", callback_id);
+            APP_LOGW("Receive Zigbee action(0x%x) callback", callback_id);
             break;
     }
     
@@ -212,14 +444,31 @@ static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id,
  *   - Groups cluster
  *   - Scenes cluster
  *   - On/Off cluster (main functionality)
+ *   - Application clusters from s_app_clusters (Relay Settings, Schedule,
+ *     Time client, plus Diagnostics, Telemetry and Metrics unless
+ *     ZIGBEE_DIAG_CLUSTERS is 0)
+ * 
+ * With ZIGBEE_EP_STATIC_TABLES the standard clusters are taken from the
+ * constant tables above, otherwise they are created one by one.
  * 
  * @return Endpoint list ready for device registration
  */
 static esp_zb_ep_list_t *create_on_off_light_ep(void)
 {
+    /* Create endpoint configuration */
+    esp_zb_endpoint_config_t endpoint_config = {
+        .endpoint = ZIGBEE_ENDPOINT,
+        .app_profile_id = ESP_ZB_AF_HA_PROFILE_ID,
+        .app_device_id = ESP_ZB_HA_ON_OFF_LIGHT_DEVICE_ID,  /* On/Off Light for best Z2M compatibility */
+        .app_device_version = 0,
+    };
+    
     /* Create cluster list for this endpoint */
     esp_zb_cluster_list_t *cluster_list = esp_zb_zcl_cluster_list_create();
     
+#if ZIGBEE_EP_STATIC_TABLES
+    zb_endpoint_add_clusters(cluster_list, s_fan_clusters, ZB_EP_TABLE_LEN(s_fan_clusters));
+#else
     /* Basic cluster (mandatory) - Contains manufacturer info */
     esp_zb_basic_cluster_cfg_t basic_cfg = {
         .zcl_version = ESP_ZB_ZCL_BASIC_ZCL_VERSION_DEFAULT_VALUE,
@@ -267,14 +516,10 @@ static esp_zb_ep_list_t *create_on_off_light_ep(void)
     esp_zb_cluster_list_add_on_off_cluster(cluster_list,
                                             esp_zb_on_off_cluster_create(&on_off_cfg),
                                             ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+#endif
     
-    /* Create endpoint configuration */
-    esp_zb_endpoint_config_t endpoint_config = {
-        .endpoint = ZIGBEE_ENDPOINT,
-        .app_profile_id = ESP_ZB_AF_HA_PROFILE_ID,
-        .app_device_id = ESP_ZB_HA_ON_OFF_LIGHT_DEVICE_ID,  /* On/Off Light for best Z2M compatibility */
-        .app_device_version = 0,
-    };
+    /* Application-specific clusters */
+    zb_endpoint_add_clusters(cluster_list, s_app_clusters, ZB_EP_TABLE_LEN(s_app_clusters));
     
     /* Create endpoint list and add this endpoint */
     esp_zb_ep_list_t *ep_list = esp_zb_ep_list_create();
@@ -289,7 +534,7 @@ static esp_zb_ep_list_t *create_on_off_light_ep(void)
 
 esp_err_t zigbee_handler_init(void)
 {
-    ESP_LOGI(TAG, "Initializing Zigbee stack");
+    APP_LOGI("Initializing Zigbee stack");
     
     /* Configure Zigbee platform */
     esp_zb_platform_config_t platform_config = {
@@ -313,39 +558,73 @@ esp_err_t zigbee_handler_init(void)
     /* Initialize Zigbee stack */
     esp_zb_init(&zb_nwk_cfg);
     
-    /* Create and register the On/Off Light endpoint */
+    /* Create and register the On/Off Light endpoint, measuring the heap cost */
+    zb_heap_snapshot_t heap_before, heap_after;
+    zb_heap_snapshot(&heap_before);
+    
     esp_zb_ep_list_t *ep_list = create_on_off_light_ep();
+    ESP_RETURN_ON_FALSE(ep_list, ESP_FAIL, TAG, "Failed to create endpoint");
     esp_zb_device_register(ep_list);
     
+    zb_heap_snapshot(&heap_after);
+    zb_heap_report("endpoint construction", &heap_before, &heap_after);
+    
     /* Register action handler for attribute changes */
     esp_zb_core_action_handler_register(zb_action_handler);
     
+    /* Identify Time runs in the stack, the LED shows it */
+    esp_zb_identify_notify_handler_register(ZIGBEE_ENDPOINT, status_led_identify);
+    
+    /* Follow local relay changes */
+    ESP_RETURN_ON_ERROR(app_event_subscribe(APP_EVENT_MASK(APP_EVENT_RELAY_CHANGED) |
+                                            APP_EVENT_MASK(APP_EVENT_RELAY_DESIRED),
+                                            zb_on_relay_changed, NULL),
+                        TAG, "Failed to subscribe to relay events");
+    
+    /* Observe APS traffic for the Diagnostics cluster */
+    esp_zb_aps_data_indication_handler_register(zb_aps_indication_handler);
+    esp_zb_aps_data_confirm_handler_register(zb_aps_confirm_handler);
+    
     /* Set primary channel mask (all channels) */
     esp_zb_set_primary_network_channel_set(ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK);
     
-    ESP_LOGI(TAG, "Zigbee stack initialized successfully");
-    ESP_LOGI(TAG, "  Device Type: End Device");
-    ESP_LOGI(TAG, "  Endpoint: %d", ZIGBEE_ENDPOINT);
-    ESP_LOGI(TAG, "  Device ID: On/Off Light (0x%04x)", ESP_ZB_HA_ON_OFF_LIGHT_DEVICE_ID);
+    APP_LOGI("Zigbee stack initialized successfully");
+    APP_LOGI("  Device Type: End Device");
+    APP_LOGI("  Endpoint: %d", ZIGBEE_ENDPOINT);
+    APP_LOGI("  Device ID: On/Off Light (0x%04x)", ESP_ZB_HA_ON_OFF_LIGHT_DEVICE_ID);
     
     return ESP_OK;
 }
 
 void zigbee_handler_start(void)
 {
-    ESP_LOGI(TAG, "Starting Zigbee stack");
+    APP_LOGI("Starting Zigbee stack");
     
     /* Start Zigbee stack (does not return on success) */
     ESP_ERROR_CHECK(esp_zb_start(false));
     
+    s_zb_task = xTaskGetCurrentTaskHandle();
+    schedule_start();
+    scenes_start();
+    
+#if ZIGBEE_DIAG_CLUSTERS
+    /* This task runs the Zigbee main loop from here on */
+    telemetry_register_task(s_zb_task, true);
+    telemetry_start();
+    diagnostics_start();
+    metrics_start();
+#endif
+    
     /* Enter main loop - this is blocking and does not return */
     esp_zb_stack_main_loop();
 }
 
 esp_err_t zigbee_handler_set_on_off_attribute(bool on)
 {
-    ESP_LOGI(TAG, "Setting On/Off attribute to: %s", on ? "ON" : "OFF");
+    PERF_TRACE_SCOPE("zb_set_on_off_attr");
+    APP_LOGI("Setting On/Off attribute to: %s", on ? "ON" : "OFF");
     
+    bool locked = zb_lock();
     esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(
         ZIGBEE_ENDPOINT,
         ESP_ZB_ZCL_CLUSTER_ID_ON_OFF,
@@ -355,16 +634,124 @@ esp_err_t zigbee_handler_set_on_off_attribute(bool on)
         false  /* Don't check access */
     );
     
+    zb_unlock(locked);
+    
     if (status == ESP_ZB_ZCL_STATUS_SUCCESS) {
         return ESP_OK;
     }
     
-    ESP_LOGE(TAG, "Failed to set On/Off attribute, status: 0x%x", status);
+    APP_LOGE("Failed to set On/Off attribute, status: 0x%x", status);
     return ESP_FAIL;
 }
 
-void zigbee_handler_register_on_off_callback(zigbee_on_off_callback_t callback)
+esp_err_t zigbee_handler_report_on_off(void)
+{
+    esp_zb_zcl_report_attr_cmd_t report_cmd = {
+        .zcl_basic_cmd = {
+            .src_endpoint = ZIGBEE_ENDPOINT,
+        },
+        .address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT,  /* Bound devices */
+        .clusterID = ESP_ZB_ZCL_CLUSTER_ID_ON_OFF,
+        .attributeID = ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+        .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI,
+    };
+    
+    bool locked = zb_lock();
+    esp_err_t ret = esp_zb_zcl_report_attr_cmd_req(&report_cmd);
+    zb_unlock(locked);
+    
+    if (ret != ESP_OK) {
+        APP_LOGD("On/Off report not sent: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+void zigbee_handler_get_network_info(zigbee_handler_net_info_t *info)
+{
+    bool locked = zb_lock();
+    info->joined = esp_zb_bdb_dev_joined();
+    info->channel = esp_zb_get_current_channel();
+    info->pan_id = esp_zb_get_pan_id();
+    info->short_addr = esp_zb_get_short_address();
+    esp_zb_get_extended_pan_id(info->extended_pan_id);
+    esp_zb_get_long_address(info->ieee_addr);
+    zb_unlock(locked);
+}
+
+bool zigbee_handler_lock(void)
+{
+    return zb_lock();
+}
+
+void zigbee_handler_unlock(bool locked)
 {
-    s_on_off_callback = callback;
-    ESP_LOGI(TAG, "On/Off callback registered");
+    zb_unlock(locked);
+}
+
+esp_err_t zigbee_handler_inject_write(uint16_t cluster, uint16_t attr_id, uint8_t type,
+                                      void *value, uint16_t size)
+{
+    esp_zb_zcl_set_attr_value_message_t message = {
+        .info = {
+            .status = ESP_ZB_ZCL_STATUS_SUCCESS,
+            .dst_endpoint = ZIGBEE_ENDPOINT,
+            .cluster = cluster,
+        },
+        .attribute = {
+            .id = attr_id,
+            .data = {
+                .type = type,
+                .size = size,
+                .value = value,
+            },
+        },
+    };
+    
+    bool locked = zb_lock();
+    if (zcl_codec_validate(type, value, size) == ESP_OK) {
+        esp_zb_zcl_set_attribute_val(ZIGBEE_ENDPOINT, cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                     attr_id, value, false);
+    }
+    esp_err_t ret = zb_attribute_handler(&message);
+    zb_unlock(locked);
+    
+    return ret;
+}
+
+uint32_t zigbee_handler_bench_command_path(uint32_t iterations)
+{
+    bool value = false;
+    esp_zb_zcl_set_attr_value_message_t message = {
+        .info = {
+            .status = ESP_ZB_ZCL_STATUS_SUCCESS,
+            .dst_endpoint = ZIGBEE_ENDPOINT,
+            .cluster = ESP_ZB_ZCL_CLUSTER_ID_ON_OFF,
+        },
+        .attribute = {
+            .id = ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+            .data = {
+                .type = ESP_ZB_ZCL_ATTR_TYPE_BOOL,
+                .size = sizeof(value),
+                .value = &value,
+            },
+        },
+    };
+    
+    if (iterations == 0) {
+        return 0;
+    }
+    
+    app_event_t written;
+    app_event_t command;
+    volatile bool sink = false;
+    
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < iterations; i++) {
+        zb_attribute_decode(&message, &written, &command);
+        sink = command.relay.on;
+    }
+    esp_cpu_cycle_count_t cycles = esp_cpu_get_cycle_count() - start;
+    (void)sink;
+    
+    return cycles / iterations;
 }
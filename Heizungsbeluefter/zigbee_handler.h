@@ -11,7 +11,11 @@
  *   - Profile: Home Automation (HA)
  *   - Device ID: On/Off Light (for best Zigbee2MQTT compatibility)
  *   - Endpoint: 10 (configurable)
- *   - Clusters: Basic, Identify, Groups, Scenes, On/Off
+ *   - Clusters: Basic, Identify, Groups, Scenes, On/Off, Diagnostics,
+ *               Telemetry, Relay Settings, Schedule and Hardware Profile
+ *               (manufacturer-specific),
+ *               Time (client); Electrical Measurement and Metering with
+ *               CURRENT_SENSE_ENABLE (see current_sense.h)
  */
 
 #ifndef ZIGBEE_HANDLER_H
@@ -19,6 +23,7 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +53,45 @@ extern "C" {
  */
 #define MODEL_IDENTIFIER        "\x10""ESP32C6_FAN_SWITCH"
 
+/**
+ * @brief Build the endpoint from constant tables (see zb_endpoint.h)
+ *
+ * Set to 1 to describe the endpoint in flash-resident tables and build it in
+ * a single pass. Set to 0 to use the per-cluster esp_zb_*_cluster_create()
+ * calls instead.
+ */
+#ifndef ZIGBEE_EP_STATIC_TABLES
+#define ZIGBEE_EP_STATIC_TABLES 1
+#endif
+
+/**
+ * @brief Include the Diagnostics, Telemetry and Metrics clusters
+ *
+ * Set to 0 for size-optimized builds (see profiles/size_optimized). The
+ * device then only exposes the standard On/Off Light clusters, the Relay
+ * Settings, Schedule and Hardware Profile clusters and the Time client; the
+ * event trace is still kept in RTC memory and printed after abnormal resets.
+ */
+#ifndef ZIGBEE_DIAG_CLUSTERS
+#define ZIGBEE_DIAG_CLUSTERS    1
+#endif
+
+/* =============================================================================
+ * Types
+ * ============================================================================= */
+
+/**
+ * @brief Network parameters of the device, see zigbee_handler_get_network_info()
+ */
+typedef struct {
+    bool joined;                    /**< Part of a network */
+    uint8_t channel;
+    uint16_t pan_id;
+    uint16_t short_addr;
+    uint8_t extended_pan_id[8];     /**< Little endian, as used by the stack */
+    uint8_t ieee_addr[8];           /**< Little endian */
+} zigbee_handler_net_info_t;
+
 /* =============================================================================
  * Public Functions
  * ============================================================================= */
@@ -59,7 +103,10 @@ extern "C" {
  *   - Configures the Zigbee platform (radio and host)
  *   - Sets up the device as an End Device
  *   - Creates the On/Off Light endpoint with required clusters
- *   - Registers action callbacks for handling On/Off commands
+ *   - Registers action callbacks; On/Off commands are published as
+ *     APP_EVENT_ZB_ON_OFF_CMD (see app_event.h)
+ *   - Subscribes to APP_EVENT_RELAY_CHANGED to mirror local relay changes
+ *     into the On/Off attribute
  * 
  * Must be called after NVS initialization and before esp_zb_start().
  * 
@@ -81,8 +128,9 @@ void zigbee_handler_start(void);
 /**
  * @brief Update the On/Off attribute in the Zigbee cluster
  * 
- * Call this function when the relay state is changed locally (e.g., by a
- * physical button) to keep the Zigbee attribute in sync.
+ * Local relay changes reach the attribute automatically through the
+ * APP_EVENT_RELAY_CHANGED subscription, so this is only needed to force the
+ * attribute to a value. Takes the Zigbee lock when called from another task.
  * 
  * @param on true = ON, false = OFF
  * @return ESP_OK on success, error code otherwise
@@ -90,23 +138,73 @@ void zigbee_handler_start(void);
 esp_err_t zigbee_handler_set_on_off_attribute(bool on);
 
 /**
- * @brief Callback type for relay control from Zigbee
+ * @brief Send the On/Off attribute to bound devices now
+ * 
+ * Used for local changes so the coordinator does not have to wait for the
+ * next reporting interval. Safe to call from any task.
+ * 
+ * @return ESP_OK if the report was queued
+ */
+esp_err_t zigbee_handler_report_on_off(void);
+
+/**
+ * @brief Read the current network parameters
+ * 
+ * Takes the Zigbee lock for a few stack calls. Safe to call from any task.
+ * 
+ * @param[out] info Network parameters
+ */
+void zigbee_handler_get_network_info(zigbee_handler_net_info_t *info);
+
+/**
+ * @brief Take the Zigbee lock unless called from the Zigbee task
+ * 
+ * For code outside the Zigbee task (e.g. timer wheel callbacks) that calls
+ * esp_zb_* functions. Holding the lock also serializes with all Zigbee
+ * callbacks and event handlers running in the Zigbee task.
+ * 
+ * @return Value to pass to zigbee_handler_unlock()
+ */
+bool zigbee_handler_lock(void);
+
+/**
+ * @brief Release the lock taken by zigbee_handler_lock()
+ * 
+ * @param locked Return value of zigbee_handler_lock()
+ */
+void zigbee_handler_unlock(bool locked);
+
+/**
+ * @brief Measure the cost of decoding an On/Off command
  * 
- * This callback is invoked when a Zigbee On/Off command is received.
+ * Runs a synthetic "On/Off = OFF" attribute message through the validation
+ * and decoding of the attribute handler. Nothing is logged, traced, counted
+ * or published, so the relay, the field history and the metrics are left
+ * alone and the Zigbee lock is not needed. The cost of the subscribers is
+ * measured from real traffic (metric event_dispatch_cycles).
  * 
- * @param on true = turn ON, false = turn OFF
+ * @param iterations Number of messages to process
+ * @return Average CPU cycles per message
  */
-typedef void (*zigbee_on_off_callback_t)(bool on);
+uint32_t zigbee_handler_bench_command_path(uint32_t iterations);
 
 /**
- * @brief Register callback for Zigbee On/Off commands
+ * @brief Feed an attribute write through the handler as if it came from
+ *        the network
  * 
- * The registered callback will be invoked whenever an On/Off command
- * is received from the Zigbee network.
+ * Like the stack, a valid value is stored in the attribute before the
+ * handler runs; a malformed one only reaches the handler, which must drop
+ * it. Takes the Zigbee lock. Used by the soak test.
  * 
- * @param callback Function to call when On/Off command is received
+ * @param cluster Cluster ID (server role, fan endpoint)
+ * @param attr_id Attribute ID
+ * @param type Attribute type (esp_zb_zcl_attr_type_t)
+ * @param value Value in ZCL encoding
+ * @param size Size of the value
+ * @return Result of the attribute handler
  */
-void zigbee_handler_register_on_off_callback(zigbee_on_off_callback_t callback);
+esp_err_t zigbee_handler_inject_write(uint16_t cluster, uint16_t attr_id, uint8_t type,
+                                      void *value, uint16_t size);
 
 #ifdef __cplusplus
 }
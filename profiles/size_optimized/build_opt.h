@@ -0,0 +1 @@
+-Os -flto -ffat-lto-objects -ffunction-sections -fdata-sections -DAPP_LOG_LEVEL_DEFAULT=APP_LOG_WARN -DZIGBEE_DIAG_CLUSTERS=0 -DPERF_TRACE_ENABLE=0 -DCAPTURE_ENABLE=0 -DSOAK_ENABLE=0 -DCONSOLE_BENCH_AT_BOOT=0 -DCONSOLE_ENABLE=0
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Convert a frame capture from the serial log into a pcap file.
+
+The firmware (built with CAPTURE_ENABLE=1, console command "capture")
+prints one line per frame:
+
+    CAP <timestamp_us> <R|T> <status> <dst_addr_mode> <src> <dst>
+        <src_ep> <dst_ep> <profile> <cluster> <lqi> <rssi> <length> <hex|->
+
+The device only sees APS frames, so the MAC, NWK and APS headers are built
+here from the recorded fields around the (unencrypted) APS payload:
+
+    MAC  data frame, PAN ID compression, short addresses = NWK addresses
+    NWK  data frame, protocol version 2, no security, radius 30
+    APS  data frame, unicast / group / broadcast from the address mode
+
+MAC and NWK sequence numbers are counted up per frame. Sent frames carry no
+profile and cluster in the confirm (0xffff); they are written with the Home
+Automation profile and cluster 0xffff, so Wireshark decodes the ZCL header
+and the general commands only. Payloads cut on the device are marked with
+a shorter captured length.
+
+Any log prefix before "CAP" is ignored, so a raw serial log can be used as
+input. Timestamps are microseconds since boot (64 bit, no wrap). A log
+with several dumps of the ring repeats frames; each frame is written once.
+The output uses link type 230 (IEEE 802.15.4 without FCS) and opens in
+Wireshark.
+
+Usage:
+    capture_to_pcap.py serial.log -o capture.pcap
+    capture_to_pcap.py < serial.log > capture.pcap
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LINE_RE = re.compile(
+    r"\bCAP (\d+) ([RT]) ([0-9a-f]{2}) (\d+) ([0-9a-f]{4}) ([0-9a-f]{4}) (\d+) (\d+) "
+    r"([0-9a-f]{4}) ([0-9a-f]{4}) (\d+) (-?\d+) (\d+) ([0-9a-f]+|-)\s*$")
+
+LINKTYPE_IEEE802_15_4_NOFCS = 230
+
+PROFILE_HA = 0x0104
+UNKNOWN_ID = 0xFFFF
+
+# esp_zb_aps_address_mode_t
+ADDR_MODE_GROUP = 1
+
+BROADCAST_ADDR_MIN = 0xFFF8
+
+# MAC frame control: data frame, PAN ID compression, short dst and src
+MAC_FCF = 0x0001 | 0x0040 | (2 << 10) | (2 << 14)
+
+# NWK frame control: data frame, protocol version 2, no security
+NWK_FCF = 0x0002 << 2
+NWK_RADIUS = 30
+
+# APS frame control: data frame plus the delivery mode
+APS_DELIVERY_UNICAST = 0x00
+APS_DELIVERY_BROADCAST = 0x08
+APS_DELIVERY_GROUP = 0x0C
+
+
+def parse(lines):
+    """Yield one dict per CAP line, skipping frames an earlier dump printed."""
+    seen = set()
+    for line in lines:
+        match = LINE_RE.search(line)
+        if not match:
+            continue
+        g = match.groups()
+        if g in seen:
+            continue
+        seen.add(g)
+        yield {
+            "timestamp_us": int(g[0]),
+            "direction": g[1],
+            "status": int(g[2], 16),
+            "addr_mode": int(g[3]),
+            "src": int(g[4], 16),
+            "dst": int(g[5], 16),
+            "src_ep": int(g[6]),
+            "dst_ep": int(g[7]),
+            "profile": int(g[8], 16),
+            "cluster": int(g[9], 16),
+            "lqi": int(g[10]),
+            "rssi": int(g[11]),
+            "length": int(g[12]),
+            "data": b"" if g[13] == "-" else bytes.fromhex(g[13]),
+        }
+
+
+def build_frame(frame, seq, pan_id):
+    """Return (header bytes, payload bytes) of one synthesized frame."""
+    src, dst = frame["src"], frame["dst"]
+    profile = frame["profile"]
+    if profile == UNKNOWN_ID:
+        profile = PROFILE_HA
+    group = frame["addr_mode"] == ADDR_MODE_GROUP
+
+    mac_dst = 0xFFFF if group or dst >= BROADCAST_ADDR_MIN else dst
+    mac = struct.pack("<HBHHH", MAC_FCF, seq & 0xFF, pan_id, mac_dst, src)
+    nwk_dst = 0xFFFD if group else dst
+    nwk = struct.pack("<HHHBB", NWK_FCF, nwk_dst, src, NWK_RADIUS, seq & 0xFF)
+
+    if group:
+        aps = struct.pack("<BHHHBB", APS_DELIVERY_GROUP, dst, frame["cluster"], profile,
+                          frame["src_ep"], seq & 0xFF)
+    else:
+        delivery = APS_DELIVERY_BROADCAST if dst >= BROADCAST_ADDR_MIN else APS_DELIVERY_UNICAST
+        aps = struct.pack("<BBHHBB", delivery, frame["dst_ep"], frame["cluster"], profile,
+                          frame["src_ep"], seq & 0xFF)
+
+    return mac + nwk + aps, frame["data"]
+
+
+def write_pcap(frames, out, pan_id):
+    """Write the frames as pcap records, return (frames, cut frames)."""
+    out.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535, LINKTYPE_IEEE802_15_4_NOFCS))
+    count = 0
+    cut = 0
+    for seq, frame in enumerate(frames):
+        header, payload = build_frame(frame, seq, pan_id)
+        captured = header + payload
+        original = len(header) + max(frame["length"], len(payload))
+        if original > len(captured):
+            cut += 1
+        ts = frame["timestamp_us"]
+        out.write(struct.pack("<IIII", ts // 1000000, ts % 1000000, len(captured), original))
+        out.write(captured)
+        count += 1
+    return count, cut
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("-o", "--output", help="pcap file (default: stdout)")
+    parser.add_argument("--pan", type=lambda v: int(v, 0), default=0xFFFF,
+                        help="PAN ID written into the MAC header (default: 0xffff)")
+    args = parser.parse_args()
+
+    source = open(args.log, encoding="utf-8", errors="replace") if args.log else sys.stdin
+    with source:
+        frames = list(parse(source))
+
+    if args.output:
+        with open(args.output, "wb") as out:
+            count, cut = write_pcap(frames, out, args.pan)
+    else:
+        count, cut = write_pcap(frames, sys.stdout.buffer, args.pan)
+
+    print(f"{count} frames written, {cut} with cut payload", file=sys.stderr)
+    return 0 if count else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Convert a perf trace capture from the serial log into Chrome trace JSON.
+
+The firmware (built with PERF_TRACE_ENABLE=1) prints one line per event:
+
+    PT <timestamp_us> <B|E|i> <task_handle> <task_name> <event_name>
+
+Any log prefix before "PT" is ignored, so a raw serial log can be used as
+input. If the log holds several dumps, only the last one is converted. The
+output loads in https://ui.perfetto.dev and chrome://tracing.
+
+Usage:
+    perf_trace_to_json.py serial.log > trace.json
+    perf_trace_to_json.py < serial.log > trace.json
+"""
+
+import argparse
+import json
+import re
+import sys
+
+LINE_RE = re.compile(r"\bPT (\d+) ([BEi]) (\S+) (\S+) (.+?)\s*$")
+
+# Printed by perf_trace_dump() before the PT lines of a dump
+HEADER_RE = re.compile(r"---- perf trace: \d+ events ----")
+
+# Timestamps are the low 32 bits of a microsecond counter
+WRAP_US = 1 << 32
+
+# Only a drop by more than half the range is a wrap, smaller drops are kept
+WRAP_DROP_MIN_US = 1 << 31
+
+
+def parse(lines):
+    """Return (timestamp_us, phase, task_handle, task_name, name) tuples of the last dump."""
+    events = []
+    last_raw = None
+    offset = 0
+    for line in lines:
+        if HEADER_RE.search(line):
+            # A new dump: earlier events and the unwrap state belong to another capture
+            events = []
+            last_raw = None
+            offset = 0
+            continue
+        match = LINE_RE.search(line)
+        if not match:
+            continue
+        raw = int(match.group(1))
+        if last_raw is not None and last_raw - raw > WRAP_DROP_MIN_US:
+            offset += WRAP_US
+        last_raw = raw
+        events.append((raw + offset, match.group(2), match.group(3), match.group(4), match.group(5)))
+    return events
+
+
+def convert(events):
+    """Build the Chrome trace event list, one thread per recording task."""
+    trace = []
+    tids = {}
+    for ts, phase, handle, task_name, name in events:
+        if handle not in tids:
+            tid = len(tids) + 1
+            tids[handle] = tid
+            trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+                          "args": {"name": task_name}})
+        event = {"name": name, "ph": phase, "ts": ts, "pid": 1, "tid": tids[handle]}
+        if phase == "i":
+            event["s"] = "t"
+        trace.append(event)
+    trace.insert(0, {"name": "process_name", "ph": "M", "pid": 1,
+                     "args": {"name": "ESP32-C6 Fan Switch"}})
+    return trace
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r"), default=sys.stdin,
+                        help="serial log containing PT lines (default: stdin)")
+    parser.add_argument("-o", "--output", type=argparse.FileType("w"), default=sys.stdout,
+                        help="output JSON file (default: stdout)")
+    args = parser.parse_args()
+
+    trace = convert(parse(args.log))
+    if len(trace) <= 1:
+        sys.exit("no PT lines found in input")
+
+    json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, args.output, indent=1)
+    args.output.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""Firmware size and benchmark report for the ESP32-C6 Fan Switch sketch.
+
+compare
+    Compare two builds, typically the same sketch with different log
+    thresholds (see Heizungsbeluefter/app_log.h):
+
+        size_report.py compare base.elf cand.elf \\
+            --baseline-log base_boot.log --candidate-log cand_boot.log
+
+    Flash and RAM usage are taken from the section headers of the ELF files.
+    If serial boot logs of builds with -DCONSOLE_BENCH_AT_BOOT=1 are given,
+    the "BENCH <name>=<value>" lines are compared as well.
+
+breakdown
+    Per-object and per-symbol size breakdown of one build, checked against a
+    budget file (default: tools/size_budget.json):
+
+        size_report.py breakdown Heizungsbeluefter.ino.elf \\
+            --map Heizungsbeluefter.ino.map [--bin Heizungsbeluefter.ino.bin]
+
+    Exits with status 1 if the image or a group exceeds its budget.
+
+    With LTO the linker map only lists the link-time partitions
+    (*.ltrans.o), which belong to no group. Take the map from a build of
+    the same sketch without -flto; the image size still comes from the
+    ELF/bin given, which may be the LTO build.
+
+The ELF file is in the Arduino build directory (arduino-cli compile
+--build-path <dir>, or the temporary directory shown with verbose output).
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+from collections import defaultdict
+
+DEFAULT_SIZE_TOOL = "riscv32-esp-elf-size"
+DEFAULT_NM_TOOL = "riscv32-esp-elf-nm"
+DEFAULT_BUDGET = os.path.join(os.path.dirname(os.path.abspath(__file__)), "size_budget.json")
+
+# Sections that occupy flash: everything mapped from flash plus the initial
+# contents of the RAM sections that the bootloader copies from flash.
+FLASH_PREFIXES = (".flash.", ".iram0.text", ".iram0.vectors", ".dram0.data", ".rtc.text",
+                  ".rtc.data", ".rtc.force_fast", ".lp.")
+# Sections that occupy internal SRAM (IRAM and DRAM share it on the ESP32-C6).
+RAM_PREFIXES = (".iram0.", ".dram0.", ".noinit")
+# Sections that occupy RTC/LP memory.
+RTC_PREFIXES = (".rtc", ".lp.")
+
+BENCH_RE = re.compile(r"\bBENCH (\w+)=(\d+)")
+
+# Size groups for the breakdown, first match wins. Patterns match the object
+# path as printed in the linker map (archive(member) for libraries).
+GROUPS = (
+    ("relay", re.compile(r"(^|/)relay\.c\.o$")),
+    ("zigbee_handler", re.compile(r"(^|/)zigbee_handler\.c\.o$")),
+    ("app", re.compile(r"(^|/)sketch/.*\.o$|\.ino\.cpp\.o$")),
+    ("zigbee_lib", re.compile(r"lib(esp_zb_api|zboss|esp_zigbee)[^/]*\.a\(")),
+    ("ieee802154", re.compile(r"libieee802154\.a\(")),
+    ("arduino_core", re.compile(r"(^|/)(core\.a|libarduino[^/]*\.a)\(|/cores/")),
+    ("libc", re.compile(r"lib(c|m|gcc|stdc\+\+|nosys)(_nano)?\.a\(")),
+)
+OTHER_GROUP = "esp_idf_other"
+
+# Objects of the link-time optimizer, the map of an LTO build
+LTRANS_RE = re.compile(r"\.ltrans\d*\.ltrans\.o$|\.ltrans\.o$")
+
+# Input sections holding string literals (mostly log format strings)
+STRING_SECTION_RE = re.compile(r"^\.rodata\.str|\.rodata\..*\.str1\.")
+
+# Output sections that are not part of the image
+IGNORED_OUTPUT_RE = re.compile(r"^\.(debug|comment|riscv\.attributes|xt\.|note|stab)")
+
+
+def read_sections(elf, size_tool):
+    """Return {section_name: size} from `size -A`."""
+    try:
+        out = subprocess.run([size_tool, "-A", elf], check=True, capture_output=True,
+                             text=True).stdout
+    except FileNotFoundError:
+        sys.exit(f"{size_tool} not found, pass --size-tool (it ships with the ESP32 Arduino core)")
+    sections = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[0].startswith(".") and parts[1].isdigit():
+            sections[parts[0]] = int(parts[1])
+    return sections
+
+
+def summarize(sections):
+    """Group section sizes into flash, RAM and RTC memory."""
+    def total(prefixes):
+        return sum(size for name, size in sections.items() if name.startswith(prefixes))
+    return {
+        "flash": total(FLASH_PREFIXES),
+        "ram": total(RAM_PREFIXES),
+        "rtc": total(RTC_PREFIXES),
+        "rodata": total((".flash.rodata",)),
+        "text": total((".flash.text",)),
+    }
+
+
+def read_bench(log):
+    """Return {name: value} from BENCH lines of a serial log."""
+    values = {}
+    if log:
+        with open(log, errors="replace") as f:
+            for line in f:
+                match = BENCH_RE.search(line)
+                if match:
+                    values[match.group(1)] = int(match.group(2))
+    return values
+
+
+def print_row(name, base, cand, unit):
+    delta = cand - base
+    pct = f"{100.0 * delta / base:+.1f}%" if base else "n/a"
+    print(f"  {name:<22} {base:>10} {cand:>10} {delta:>+10} {unit:<6} {pct:>8}")
+
+
+def group_of(obj):
+    """Return the size group of an object path from the linker map."""
+    for name, pattern in GROUPS:
+        if pattern.search(obj):
+            return name
+    return OTHER_GROUP
+
+
+def parse_map(map_file):
+    """Return [(output_section, input_section, size, object)] from a GNU ld map."""
+    entries = []
+    in_map = False
+    output = None
+    pending = None
+    input_re = re.compile(r"^ (\S+)?\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+    with open(map_file, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+            if line.startswith(".") and not line.startswith(" "):
+                output = line.split()[0]
+                pending = None
+                continue
+            if output is None or IGNORED_OUTPUT_RE.match(output):
+                continue
+            match = input_re.match(line)
+            if match:
+                name = match.group(1) or pending
+                pending = None
+                if name and not name.startswith("*"):
+                    entries.append((output, name, int(match.group(2), 16), match.group(3)))
+                continue
+            stripped = line.strip()
+            # Long input section names are printed on a line of their own
+            if line.startswith(" .") and len(stripped.split()) == 1:
+                pending = stripped
+    return entries
+
+
+def top_symbols(elf, nm_tool, count):
+    """Return the largest symbols as [(size, type, name)]."""
+    try:
+        out = subprocess.run([nm_tool, "-S", "--size-sort", "-C", elf], check=True,
+                             capture_output=True, text=True).stdout
+    except FileNotFoundError:
+        print(f"  ({nm_tool} not found, skipping per-symbol breakdown)")
+        return []
+    symbols = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4:
+            symbols.append((int(parts[1], 16), parts[2], parts[3]))
+    return list(reversed(symbols))[:count]
+
+
+def cmd_breakdown(args):
+    with open(args.budget) as f:
+        budget = json.load(f)
+
+    sections = read_sections(args.elf, args.size_tool)
+    totals = summarize(sections)
+    image = os.path.getsize(args.bin) if args.bin else totals["flash"]
+
+    failures = []
+    partition = budget["app_partition_bytes"]
+    limit = partition * (100 - budget.get("min_free_percent", 0)) // 100
+
+    print(f"Image: {image} bytes of {partition} ({100.0 * image / partition:.1f}%), "
+          f"limit {limit} ({'.bin' if args.bin else 'estimated from ELF'})")
+    print(f"Internal RAM (static): {totals['ram']} bytes, RTC memory: {totals['rtc']} bytes")
+    if image > limit:
+        failures.append(f"image {image} > {limit}")
+
+    if args.map:
+        entries = parse_map(args.map)
+        if any(LTRANS_RE.search(obj) for _, _, _, obj in entries):
+            sys.exit(f"{args.map} is from an LTO build, its objects belong to no group; "
+                     "pass the map of a build without -flto")
+        flash = defaultdict(int)
+        ram = defaultdict(int)
+        objects = defaultdict(int)
+        strings = defaultdict(int)
+        for output, name, size, obj in entries:
+            group = group_of(obj)
+            if output.startswith(FLASH_PREFIXES):
+                flash[group] += size
+                objects[obj] += size
+                if STRING_SECTION_RE.search(name):
+                    strings[group] += size
+            if output.startswith(RAM_PREFIXES):
+                ram[group] += size
+
+        print()
+        print(f"  {'group':<16} {'flash':>9} {'strings':>9} {'ram':>9} {'budget':>9}")
+        group_budgets = budget.get("groups", {})
+        for group in sorted(set(flash) | set(ram), key=lambda g: -flash[g]):
+            limit = group_budgets.get(group)
+            mark = ""
+            if limit is not None and flash[group] > limit:
+                failures.append(f"{group} {flash[group]} > {limit}")
+                mark = "  OVER"
+            print(f"  {group:<16} {flash[group]:>9} {strings[group]:>9} {ram[group]:>9} "
+                  f"{limit if limit is not None else '-':>9}{mark}")
+
+        print()
+        print(f"  Largest {args.top} objects (flash):")
+        for obj, size in sorted(objects.items(), key=lambda kv: -kv[1])[:args.top]:
+            print(f"  {size:>9}  {obj}")
+
+    symbols = top_symbols(args.elf, args.nm_tool, args.top)
+    if symbols:
+        print()
+        print(f"  Largest {args.top} symbols:")
+        for size, kind, name in symbols:
+            print(f"  {size:>9}  {kind}  {name}")
+
+    if failures:
+        print()
+        print("Size budget exceeded: " + "; ".join(failures))
+        sys.exit(1)
+    print()
+    print("Size budget OK")
+
+
+def cmd_compare(args):
+    base = summarize(read_sections(args.baseline, args.size_tool))
+    cand = summarize(read_sections(args.candidate, args.size_tool))
+
+    print(f"Baseline:  {args.baseline}")
+    print(f"Candidate: {args.candidate}")
+    print(f"  {'':<22} {'baseline':>10} {'candidate':>10} {'delta':>10}")
+    for key, label in (("flash", "Flash total"), ("text", "  code (.flash.text)"),
+                       ("rodata", "  rodata (strings)"), ("ram", "Internal RAM"),
+                       ("rtc", "RTC memory")):
+        print_row(label, base[key], cand[key], "bytes")
+
+    base_bench = read_bench(args.baseline_log)
+    cand_bench = read_bench(args.candidate_log)
+    for name in sorted(set(base_bench) & set(cand_bench)):
+        print_row(name, base_bench[name], cand_bench[name], "")
+    missing = set(base_bench) ^ set(cand_bench)
+    if missing:
+        print(f"  (benchmarks only in one log: {', '.join(sorted(missing))})")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0],
+                                     formatter_class=argparse.RawDescriptionHelpFormatter,
+                                     epilog=__doc__.split("\n", 2)[2])
+    parser.add_argument("--size-tool", default=DEFAULT_SIZE_TOOL,
+                        help=f"binutils size for the target (default: {DEFAULT_SIZE_TOOL})")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    compare = sub.add_parser("compare", help="compare two builds")
+    compare.add_argument("baseline", help="baseline ELF")
+    compare.add_argument("candidate", help="candidate ELF")
+    compare.add_argument("--baseline-log", help="serial boot log of the baseline (BENCH lines)")
+    compare.add_argument("--candidate-log", help="serial boot log of the candidate (BENCH lines)")
+    compare.set_defaults(func=cmd_compare)
+
+    breakdown = sub.add_parser("breakdown", help="size breakdown and budget check")
+    breakdown.add_argument("elf", help="firmware ELF")
+    breakdown.add_argument("--map", help="linker map file for the per-object breakdown "
+                                         "(of a build without -flto)")
+    breakdown.add_argument("--bin", help="flashable .bin for the exact image size")
+    breakdown.add_argument("--budget", default=DEFAULT_BUDGET,
+                           help="budget file (default: tools/size_budget.json)")
+    breakdown.add_argument("--top", type=int, default=20, help="number of objects/symbols listed")
+    breakdown.add_argument("--nm-tool", default=DEFAULT_NM_TOOL,
+                           help=f"binutils nm for the target (default: {DEFAULT_NM_TOOL})")
+    breakdown.set_defaults(func=cmd_breakdown)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()